@@ -15,8 +15,10 @@
 #include <ew/cameraController.h>
 #include <ew/texture.h>
 
+#include <jameslib/benchmark.h>
+
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
-GLFWwindow* initWindow(const char* title, int width, int height);
+GLFWwindow* initWindow(const char* title, int width, int height, bool hidden);
 void drawUI();
 
 //Global state
@@ -37,8 +39,19 @@ struct Material {
 	float Shininess = 128;
 }material;
 
-int main() {
-	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight);
+int main(int argc, char** argv) {
+	//--benchmark plays a scripted camera path at a fixed size and writes a report instead of taking input
+	jameslib::BenchmarkSettings benchmarkSettings;
+	if (!jameslib::parseBenchmarkArgs(argc, argv, &benchmarkSettings)) {
+		return 1;
+	}
+	jameslib::BenchmarkRunner benchmark("assignment0", benchmarkSettings);
+	if (benchmark.isEnabled()) {
+		screenWidth = benchmarkSettings.width;
+		screenHeight = benchmarkSettings.height;
+	}
+	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight, benchmark.isEnabled());
+	benchmark.start();
 
 	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
 	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");
@@ -48,6 +61,7 @@ int main() {
 	camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
 	camera.aspectRatio = (float)screenWidth / screenHeight;
 	camera.fov = 60.0f;
+	jameslib::CameraPath benchmarkPath = jameslib::createOrbitPath(camera.target, glm::length(camera.position - camera.target), 0.0f, 2.5f);
 
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
@@ -57,10 +71,11 @@ int main() {
 
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
-	while (!glfwWindowShouldClose(window)) {
+	while (!glfwWindowShouldClose(window) && !benchmark.isFinished()) {
+		benchmark.beginFrame();
 		glfwPollEvents();
 
-		float time = (float)glfwGetTime();
+		float time = benchmark.isEnabled() ? benchmark.getTime() : (float)glfwGetTime();
 		deltaTime = time - prevFrameTime;
 		prevFrameTime = time;
 
@@ -68,7 +83,12 @@ int main() {
 		glClearColor(0.6f,0.8f,0.92f,1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-		cameraController.move(window, &camera, deltaTime);
+		if (benchmark.isEnabled()) {
+			benchmark.updateCamera(benchmarkPath, &camera);
+		}
+		else {
+			cameraController.move(window, &camera, deltaTime);
+		}
 
 		monkeyTransform.rotation = glm::rotate(monkeyTransform.rotation, deltaTime, glm::vec3(0.0, 1.0, 0.0));
 
@@ -87,9 +107,12 @@ int main() {
 
 		drawUI();
 
+		benchmark.endFrame(screenWidth, screenHeight);
 		glfwSwapBuffers(window);
 	}
+	bool reportWritten = !benchmark.isEnabled() || benchmark.writeReport();
 	printf("Shutting down...");
+	return reportWritten ? 0 : 1;
 }
 
 void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
@@ -133,14 +156,19 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 /// <param name="title">Window title</param>
 /// <param name="width">Window width</param>
 /// <param name="height">Window height</param>
+/// <param name="hidden">Creates the window invisible with vsync off, for benchmarks</param>
 /// <returns>Returns window handle on success or null on fail</returns>
-GLFWwindow* initWindow(const char* title, int width, int height) {
+GLFWwindow* initWindow(const char* title, int width, int height, bool hidden) {
 	printf("Initializing...");
 	if (!glfwInit()) {
 		printf("GLFW failed to init!");
 		return nullptr;
 	}
 
+	//Benchmarks run unseen and unthrottled
+	if (hidden) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 	GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
 	if (window == NULL) {
 		printf("GLFW failed to create window");
@@ -152,6 +180,9 @@ GLFWwindow* initWindow(const char* title, int width, int height) {
 		printf("GLAD Failed to load GL headers");
 		return nullptr;
 	}
+	if (hidden) {
+		glfwSwapInterval(0);
+	}
 
 	//Initialize ImGUI
 	IMGUI_CHECKVERSION();
@@ -16,11 +16,13 @@
 #include <ew/cameraController.h>
 #include <ew/texture.h>
 
+#include <jameslib/benchmark.h>
 #include <jameslib/framebuffer.h>
+#include <jameslib/renderTargetPool.h>
 
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
-GLFWwindow* initWindow(const char* title, int width, int height);
+GLFWwindow* initWindow(const char* title, int width, int height, bool hidden);
 void drawUI();
 
 //Global state
@@ -44,11 +46,27 @@ struct Material {
 	float Shininess = 128;
 }material;
 
-int main() {
-	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight);
+int main(int argc, char** argv) {
+	//--benchmark plays a scripted camera path at a fixed size and writes a report instead of taking input
+	jameslib::BenchmarkSettings benchmarkSettings;
+	if (!jameslib::parseBenchmarkArgs(argc, argv, &benchmarkSettings)) {
+		return 1;
+	}
+	jameslib::BenchmarkRunner benchmark("assignment1", benchmarkSettings);
+	if (benchmark.isEnabled()) {
+		screenWidth = benchmarkSettings.width;
+		screenHeight = benchmarkSettings.height;
+	}
+	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight, benchmark.isEnabled());
+	benchmark.start();
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
-	jameslib::Framebuffer framebuffer = jameslib::createFramebuffer(screenWidth, screenHeight, GL_RGB16F);
+	//The scene target is acquired every frame at the current window size
+	jameslib::RenderTargetPool renderTargets;
+	jameslib::FramebufferDesc sceneTargetDesc;
+	sceneTargetDesc.colorFormats[0] = GL_RGB16F;
+	sceneTargetDesc.numColorBuffers = 1;
+	sceneTargetDesc.depthFormat = GL_DEPTH_COMPONENT24;
 
 	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
 	ew::Shader ppShader = ew::Shader("assets/postprocess.vert", "assets/postprocess.frag");
@@ -59,6 +77,7 @@ int main() {
 	camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
 	camera.aspectRatio = (float)screenWidth / screenHeight;
 	camera.fov = 60.0f;
+	jameslib::CameraPath benchmarkPath = jameslib::createOrbitPath(camera.target, glm::length(camera.position - camera.target), 0.0f, 2.5f);
 
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
@@ -67,13 +86,24 @@ int main() {
 	unsigned int dummyVAO;
 	glCreateVertexArrays(1, &dummyVAO);
 
-	while (!glfwWindowShouldClose(window)) {
+	while (!glfwWindowShouldClose(window) && !benchmark.isFinished()) {
+		benchmark.beginFrame();
 		glfwPollEvents();
 
-		float time = (float)glfwGetTime();
+		float time = benchmark.isEnabled() ? benchmark.getTime() : (float)glfwGetTime();
 		deltaTime = time - prevFrameTime;
 		prevFrameTime = time;
 
+		if (benchmark.isEnabled()) {
+			benchmark.updateCamera(benchmarkPath, &camera);
+		}
+
+		renderTargets.beginFrame();
+		sceneTargetDesc.width = screenWidth;
+		sceneTargetDesc.height = screenHeight;
+		jameslib::Framebuffer framebuffer = renderTargets.acquireFramebuffer(sceneTargetDesc);
+		camera.aspectRatio = (float)framebuffer.width / framebuffer.height;
+
 		//RENDER
 		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
 		glViewport(0, 0, framebuffer.width, framebuffer.height);
@@ -95,7 +125,7 @@ int main() {
 		monkeyModel.draw();
 
 		glBindFramebuffer(GL_FRAMEBUFFER, 0); 
-		glViewport(0, 0, framebuffer.width, framebuffer.height);
+		glViewport(0, 0, screenWidth, screenHeight);
 		glClearColor(1.0f,1.0f,1.0f,1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
@@ -104,17 +134,20 @@ int main() {
 		ppShader.setFloat("_BlurStrength", blurStrength);
 
 		glBindVertexArray(dummyVAO);
-		glBindTextureUnit(0, framebuffer.colorBuffer);
+		glBindTextureUnit(0, framebuffer.colorBuffers[0]);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
+		renderTargets.releaseFramebuffer(framebuffer);
 
 		drawUI();
 
+		benchmark.endFrame(screenWidth, screenHeight);
 		glfwSwapBuffers(window);
 	}
+	bool reportWritten = !benchmark.isEnabled() || benchmark.writeReport();
 
-	glDeleteFramebuffers(1, &framebuffer.fbo);
 
 	printf("Shutting down...");
+	return reportWritten ? 0 : 1;
 }
 
 void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
@@ -162,14 +195,19 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 /// <param name="title">Window title</param>
 /// <param name="width">Window width</param>
 /// <param name="height">Window height</param>
+/// <param name="hidden">Creates the window invisible with vsync off, for benchmarks</param>
 /// <returns>Returns window handle on success or null on fail</returns>
-GLFWwindow* initWindow(const char* title, int width, int height) {
+GLFWwindow* initWindow(const char* title, int width, int height, bool hidden) {
 	printf("Initializing...");
 	if (!glfwInit()) {
 		printf("GLFW failed to init!");
 		return nullptr;
 	}
 
+	//Benchmarks run unseen and unthrottled
+	if (hidden) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 	GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
 	if (window == NULL) {
 		printf("GLFW failed to create window");
@@ -181,6 +219,9 @@ GLFWwindow* initWindow(const char* title, int width, int height) {
 		printf("GLAD Failed to load GL headers");
 		return nullptr;
 	}
+	if (hidden) {
+		glfwSwapInterval(0);
+	}
 
 	//Initialize ImGUI
 	IMGUI_CHECKVERSION();
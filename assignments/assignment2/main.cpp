@@ -17,11 +17,13 @@
 #include <ew/texture.h>
 #include <ew/procGen.h>
 
+#include <jameslib/benchmark.h>
 #include <jameslib/framebuffer.h>
+#include <jameslib/renderTargetPool.h>
 
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
-GLFWwindow* initWindow(const char* title, int width, int height);
+GLFWwindow* initWindow(const char* title, int width, int height, bool hidden);
 void drawUI(jameslib::Framebuffer shadowFBO);
 
 //Global state
@@ -50,12 +52,28 @@ struct Material {
 	float Shininess = 128;
 }material;
 
-int main() {
-	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight);
+int main(int argc, char** argv) {
+	//--benchmark plays a scripted camera path at a fixed size and writes a report instead of taking input
+	jameslib::BenchmarkSettings benchmarkSettings;
+	if (!jameslib::parseBenchmarkArgs(argc, argv, &benchmarkSettings)) {
+		return 1;
+	}
+	jameslib::BenchmarkRunner benchmark("assignment2", benchmarkSettings);
+	if (benchmark.isEnabled()) {
+		screenWidth = benchmarkSettings.width;
+		screenHeight = benchmarkSettings.height;
+	}
+	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight, benchmark.isEnabled());
+	benchmark.start();
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
-	jameslib::Framebuffer framebuffer = jameslib::createFramebuffer(screenWidth, screenHeight, GL_RGB16F);
-	jameslib::Framebuffer shadowFBO = jameslib::createFramebuffer(1024, 1024, GL_RGB16F);
+	//The scene target is acquired every frame at the current window size
+	jameslib::RenderTargetPool renderTargets;
+	jameslib::FramebufferDesc sceneTargetDesc;
+	sceneTargetDesc.colorFormats[0] = GL_RGB16F;
+	sceneTargetDesc.numColorBuffers = 1;
+	sceneTargetDesc.depthFormat = GL_DEPTH_COMPONENT24;
+	jameslib::Framebuffer shadowFBO = jameslib::createDepthFramebuffer(1024, 1024);
 
 	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
 	ew::Shader ppShader = ew::Shader("assets/postprocess.vert", "assets/postprocess.frag");
@@ -69,6 +87,7 @@ int main() {
 	camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
 	camera.aspectRatio = (float)screenWidth / screenHeight;
 	camera.fov = 60.0f;
+	jameslib::CameraPath benchmarkPath = jameslib::createOrbitPath(camera.target, glm::length(camera.position - camera.target), 0.0f, 2.5f);
 
 	directionalLight.target = glm::vec3(0, -3, 0);
 	directionalLight.orthographic = true;
@@ -85,14 +104,26 @@ int main() {
 	unsigned int dummyVAO;
 	glCreateVertexArrays(1, &dummyVAO);
 
-	while (!glfwWindowShouldClose(window)) {
+	while (!glfwWindowShouldClose(window) && !benchmark.isFinished()) {
+		benchmark.beginFrame();
 		glfwPollEvents();
 
-		float time = (float)glfwGetTime();
+		float time = benchmark.isEnabled() ? benchmark.getTime() : (float)glfwGetTime();
 		deltaTime = time - prevFrameTime;
 		prevFrameTime = time;
 
-		cameraController.move(window, &camera, deltaTime);
+		renderTargets.beginFrame();
+		sceneTargetDesc.width = screenWidth;
+		sceneTargetDesc.height = screenHeight;
+		jameslib::Framebuffer framebuffer = renderTargets.acquireFramebuffer(sceneTargetDesc);
+		camera.aspectRatio = (float)framebuffer.width / framebuffer.height;
+
+		if (benchmark.isEnabled()) {
+			benchmark.updateCamera(benchmarkPath, &camera);
+		}
+		else {
+			cameraController.move(window, &camera, deltaTime);
+		}
 
 		//RENDER
 
@@ -147,18 +178,21 @@ int main() {
 		ppShader.setFloat("_BlurStrength", blurStrength);
 
 		glBindVertexArray(dummyVAO);
-		glBindTextureUnit(0, framebuffer.colorBuffer);
+		glBindTextureUnit(0, framebuffer.colorBuffers[0]);
 		glDrawArrays(GL_TRIANGLES, 0, 6);
+		renderTargets.releaseFramebuffer(framebuffer);
 
 		drawUI(shadowFBO);
 
+		benchmark.endFrame(screenWidth, screenHeight);
 		glfwSwapBuffers(window);
 	}
+	bool reportWritten = !benchmark.isEnabled() || benchmark.writeReport();
 
-	glDeleteFramebuffers(1, &framebuffer.fbo);
-	glDeleteFramebuffers(1, &shadowFBO.fbo);
+	jameslib::destroyFramebuffer(shadowFBO);
 
 	printf("Shutting down...");
+	return reportWritten ? 0 : 1;
 }
 
 void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
@@ -220,14 +254,19 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 /// <param name="title">Window title</param>
 /// <param name="width">Window width</param>
 /// <param name="height">Window height</param>
+/// <param name="hidden">Creates the window invisible with vsync off, for benchmarks</param>
 /// <returns>Returns window handle on success or null on fail</returns>
-GLFWwindow* initWindow(const char* title, int width, int height) {
+GLFWwindow* initWindow(const char* title, int width, int height, bool hidden) {
 	printf("Initializing...");
 	if (!glfwInit()) {
 		printf("GLFW failed to init!");
 		return nullptr;
 	}
 
+	//Benchmarks run unseen and unthrottled
+	if (hidden) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 	GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
 	if (window == NULL) {
 		printf("GLFW failed to create window");
@@ -239,6 +278,9 @@ GLFWwindow* initWindow(const char* title, int width, int height) {
 		printf("GLAD Failed to load GL headers");
 		return nullptr;
 	}
+	if (hidden) {
+		glfwSwapInterval(0);
+	}
 
 	//Initialize ImGUI
 	IMGUI_CHECKVERSION();
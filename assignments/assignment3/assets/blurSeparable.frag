@@ -0,0 +1,26 @@
+#version 450
+
+out vec4 FragColor;
+
+in vec2 UV;
+
+//Mirrors jameslib::MAX_BLUR_TAPS. Tap 0 is the center, the rest are mirrored
+//and already placed between texel pairs so each fetch returns two weighted texels.
+#define MAX_BLUR_TAPS 16
+
+uniform sampler2D _Source;
+uniform vec2 _Direction; //One texel along the blur axis in UV units
+uniform float _Offsets[MAX_BLUR_TAPS];
+uniform float _Weights[MAX_BLUR_TAPS];
+uniform int _NumTaps;
+
+void main(){
+    vec3 color = texture(_Source,UV).rgb * _Weights[0];
+    for(int i = 1; i < _NumTaps; i++)
+    {
+        vec2 offset = _Direction * _Offsets[i];
+        color += texture(_Source,UV + offset).rgb * _Weights[i];
+        color += texture(_Source,UV - offset).rgb * _Weights[i];
+    }
+    FragColor = vec4(color,1.0);
+}
@@ -0,0 +1,117 @@
+#version 450
+
+out vec4 FragColor;
+
+in vec2 UV;
+
+#include "frameData.glsl"
+
+//Matches jameslib::LIGHT_TILE_SIZE
+const uint TILE_SIZE = 16u;
+
+struct Light{
+	vec4 PositionRadius; //World position, range
+	vec4 Color; //Color * intensity, cos of the spot inner angle
+	vec4 Direction; //Spot direction, cos of the spot outer angle. Point lights never fall off.
+};
+layout(std430, binding = 1) readonly buffer Lights { Light _Lights[]; };
+layout(std430, binding = 2) readonly buffer TileLights { uint _TileLights[]; };
+layout(std430, binding = 3) readonly buffer TileRanges { uvec2 _TileRanges[]; };
+
+#ifdef GBUFFER_COMPACT
+uniform sampler2D _gNormals; //Octahedral
+uniform sampler2D _gAlbedo;
+uniform sampler2D _gMaterial;
+uniform sampler2D _gDepth;
+uniform mat4 _InverseViewProjection;
+#else
+uniform sampler2D _gPositions;
+uniform sampler2D _gNormals;
+uniform sampler2D _gAlbedo;
+#endif
+uniform int _NumTilesX;
+uniform bool _ShowLightTiles;
+uniform vec3 _LightColor = vec3(1.0);
+
+struct Material{
+	float Ka; //Ambient coefficient (0-1)
+	float Kd; //Diffuse coefficient (0-1)
+	float Ks; //Specular coefficient (0-1)
+	float Shininess; //Affects size of specular highlight
+};
+uniform Material _Material;
+
+#ifdef GBUFFER_COMPACT
+vec3 decodeNormal(vec2 e){
+	e = e * 2.0 - 1.0;
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+	return normalize(n);
+}
+#endif
+
+#include "shadows.glsl"
+
+//Blinn-phong from one point or spot light, windowed so it reaches exactly zero at the light's range
+vec3 calcLocalLight(Light light, Material material, vec3 worldPos, vec3 normal, vec3 toEye)
+{
+	vec3 toLight = light.PositionRadius.xyz - worldPos;
+	float dist = length(toLight);
+	toLight /= dist;
+	float window = clamp(1.0 - pow(dist / light.PositionRadius.w, 4.0), 0.0, 1.0);
+	float attenuation = window * window / (dist * dist + 1.0);
+	attenuation *= smoothstep(light.Direction.w, light.Color.w, dot(-toLight, light.Direction.xyz));
+	float diffuseFactor = max(dot(normal,toLight),0.0);
+	vec3 h = normalize(toLight + toEye);
+	float specularFactor = pow(max(dot(normal,h),0.0),material.Shininess);
+	return light.Color.rgb * attenuation * (material.Kd * diffuseFactor + material.Ks * specularFactor);
+}
+
+void main()
+{
+	ivec2 pixel = ivec2(gl_FragCoord.xy);
+#ifdef GBUFFER_COMPACT
+	float depth = texelFetch(_gDepth, pixel, 0).r;
+	//Background keeps the clear color
+	if (depth == 1.0) {
+		discard;
+	}
+	vec4 worldPos4 = _InverseViewProjection * vec4(vec3(UV, depth) * 2.0 - 1.0, 1.0);
+	vec3 worldPos = worldPos4.xyz / worldPos4.w;
+	vec3 normal = decodeNormal(texelFetch(_gNormals, pixel, 0).xy);
+	vec3 albedo = texelFetch(_gAlbedo, pixel, 0).rgb;
+	vec4 packedMaterial = texelFetch(_gMaterial, pixel, 0);
+	Material material = Material(packedMaterial.x, packedMaterial.y, packedMaterial.z, exp2(packedMaterial.w * 10.0));
+#else
+	vec3 normal = texelFetch(_gNormals, pixel, 0).xyz;
+	//Background keeps the clear color
+	if (dot(normal,normal) == 0.0) {
+		discard;
+	}
+	normal = normalize(normal);
+	vec3 worldPos = texelFetch(_gPositions, pixel, 0).xyz;
+	vec3 albedo = texelFetch(_gAlbedo, pixel, 0).rgb;
+	Material material = _Material;
+#endif
+
+	//Directional light, same model as the forward lit pass
+	float shadow = calcShadow(worldPos, normal);
+	vec3 light = (material.Ka * 0.15) + ((material.Kd + material.Ks) * _LightColor) * (1.0 - shadow);
+
+	//Only the lights binned into this pixel's tile
+	uvec2 tile = uvec2(pixel) / TILE_SIZE;
+	uvec2 range = _TileRanges[tile.y * uint(_NumTilesX) + tile.x];
+	vec3 toEye = normalize(_EyePos - worldPos);
+	for (uint i = 0u; i < range.y; i++) {
+		light += calcLocalLight(_Lights[_TileLights[range.x + i]], material, worldPos, normal, toEye);
+	}
+
+	vec3 color = albedo * light;
+	if (_ShowLightTiles) {
+		//Blue to red as the tile approaches 64 lights
+		float heat = clamp(float(range.y) / 64.0, 0.0, 1.0);
+		color = mix(color, vec3(heat, 0.2, 1.0 - heat), 0.5);
+	}
+	FragColor = vec4(color,1.0);
+}
@@ -0,0 +1,18 @@
+#version 450
+
+//Stand-in while the real programs compile: flat grey with a single N.L term, no textures or shadows
+out vec4 FragColor;
+
+in Surface{
+	vec3 WorldPos;
+	vec3 WorldNormal;
+	vec2 TexCoord;
+}fs_in;
+
+#include "frameData.glsl"
+
+void main(){
+	vec3 normal = normalize(fs_in.WorldNormal);
+	float diffuse = max(dot(normal, -normalize(_LightDirection)), 0.0);
+	FragColor = vec4(vec3(0.3 + 0.6 * diffuse), 1.0);
+}
@@ -0,0 +1,10 @@
+//Per frame uniforms, written once a frame by jameslib::writeFrameUniforms. Matches jameslib::FrameData.
+layout(std140, binding = 0) uniform FrameData {
+	mat4 _ViewProjection;
+	mat4 _CascadeViewProj[4]; //Matches jameslib::MAX_SHADOW_CASCADES
+	vec4 _CascadeSplits; //View space far distance of each cascade
+	vec3 _EyePos;
+	vec3 _ViewForward;
+	vec3 _LightDirection; //Direction the light travels
+	int _NumCascades;
+};
@@ -1,19 +1,51 @@
 #version 450 core
 
-layout(location = 0) out vec3 gPosition; //Worldspace position
-layout(location = 1) out vec3 gNormal; //Worldspace normal 
-layout(location = 2) out vec3 gAlbedo;
-
 in Surface{
 	vec3 WorldPos; 
-	vec2 TexCoord;
 	vec3 WorldNormal;
+	vec2 TexCoord;
 }fs_in;
 
 uniform sampler2D _MainTex;
 
+#ifdef GBUFFER_COMPACT
+//Position comes back from depth in the lighting pass
+layout(location = 0) out vec2 gNormal; //Octahedral worldspace normal
+layout(location = 1) out vec4 gAlbedo;
+layout(location = 2) out vec4 gMaterial; //Ka, Kd, Ks, log2(Shininess) / 10
+
+struct Material{
+	float Ka;
+	float Kd;
+	float Ks;
+	float Shininess;
+};
+uniform Material _Material;
+
+vec2 octWrap(vec2 v){
+	return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+//Projects the unit sphere onto an octahedron and unfolds it into [0,1]^2
+vec2 encodeNormal(vec3 n){
+	n /= abs(n.x) + abs(n.y) + abs(n.z);
+	vec2 e = n.z >= 0.0 ? n.xy : octWrap(n.xy);
+	return e * 0.5 + 0.5;
+}
+
+void main(){
+	gNormal = encodeNormal(normalize(fs_in.WorldNormal));
+	gAlbedo = vec4(texture(_MainTex,fs_in.TexCoord).rgb, 1.0);
+	gMaterial = vec4(_Material.Ka, _Material.Kd, _Material.Ks, log2(_Material.Shininess) / 10.0);
+}
+#else
+layout(location = 0) out vec3 gPosition; //Worldspace position
+layout(location = 1) out vec3 gNormal; //Worldspace normal 
+layout(location = 2) out vec3 gAlbedo;
+
 void main(){
 	gPosition = fs_in.WorldPos;
 	gAlbedo = texture(_MainTex,fs_in.TexCoord).rgb;
 	gNormal = normalize(fs_in.WorldNormal);
 }
+#endif
@@ -4,8 +4,14 @@ layout(location = 0) in vec3 vPos;
 layout(location = 1) in vec3 vNormal;
 layout(location = 2) in vec2 vTexCoord;
 
-uniform mat4 _Model;
-uniform mat4 _ViewProjection;
+//Per-mesh position dequantization set by ew::Mesh::draw. Identity for full float meshes.
+layout(location = 7) in vec3 vPosOffset;
+layout(location = 8) in vec3 vPosScale;
+
+//Per-instance model matrix from the instance stream. Constant (ew::setModelMatrix) for single draws.
+layout(location = 3) in mat4 _Model;
+
+#include "frameData.glsl"
 
 out Surface{
 	vec3 WorldPos;
@@ -15,9 +21,10 @@ out Surface{
 
 void main()
 {
-	vs_out.WorldPos = vec3(_Model * vec4(vPos,1.0));
+	vec3 pos = vPosOffset + vPos * vPosScale;
+	vs_out.WorldPos = vec3(_Model * vec4(pos,1.0));
 	vs_out.WorldNormal = transpose(inverse(mat3(_Model))) * vNormal;
 	vs_out.TexCoord = vTexCoord;
 
-	gl_Position = _ViewProjection * _Model * vec4(vPos,1.0);
+	gl_Position = _ViewProjection * _Model * vec4(pos,1.0);
 }
\ No newline at end of file
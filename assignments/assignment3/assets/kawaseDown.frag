@@ -0,0 +1,18 @@
+#version 450
+
+out vec4 FragColor;
+
+in vec2 UV;
+
+uniform sampler2D _Source;
+uniform vec2 _HalfTexel; //Half a texel of _Source
+
+//Dual Kawase downsample: the center plus the four diagonal corners, 5 bilinear fetches covering a 4x4 footprint
+void main(){
+    vec3 color = texture(_Source,UV).rgb * 4.0;
+    color += texture(_Source,UV + vec2(-_HalfTexel.x,-_HalfTexel.y)).rgb;
+    color += texture(_Source,UV + vec2( _HalfTexel.x,-_HalfTexel.y)).rgb;
+    color += texture(_Source,UV + vec2(-_HalfTexel.x, _HalfTexel.y)).rgb;
+    color += texture(_Source,UV + vec2( _HalfTexel.x, _HalfTexel.y)).rgb;
+    FragColor = vec4(color / 8.0,1.0);
+}
@@ -0,0 +1,21 @@
+#version 450
+
+out vec4 FragColor;
+
+in vec2 UV;
+
+uniform sampler2D _Source;
+uniform vec2 _HalfTexel; //Half a texel of _Source, the lower resolution level
+
+//Dual Kawase upsample: a tent of 8 bilinear fetches, the edges at one texel and the diagonals at half a texel doubled
+void main(){
+    vec3 color = texture(_Source,UV + vec2(-_HalfTexel.x * 2.0,0.0)).rgb;
+    color += texture(_Source,UV + vec2( _HalfTexel.x * 2.0,0.0)).rgb;
+    color += texture(_Source,UV + vec2(0.0,-_HalfTexel.y * 2.0)).rgb;
+    color += texture(_Source,UV + vec2(0.0, _HalfTexel.y * 2.0)).rgb;
+    color += texture(_Source,UV + vec2(-_HalfTexel.x,-_HalfTexel.y)).rgb * 2.0;
+    color += texture(_Source,UV + vec2( _HalfTexel.x,-_HalfTexel.y)).rgb * 2.0;
+    color += texture(_Source,UV + vec2(-_HalfTexel.x, _HalfTexel.y)).rgb * 2.0;
+    color += texture(_Source,UV + vec2( _HalfTexel.x, _HalfTexel.y)).rgb * 2.0;
+    FragColor = vec4(color / 12.0,1.0);
+}
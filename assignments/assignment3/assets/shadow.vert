@@ -1,10 +1,19 @@
-#version 330 core
+#version 450 core
 layout (location = 0) in vec3 vPos;
 
-uniform mat4 _ViewProjection;
-uniform mat4 _Model;
+//Per-mesh position dequantization set by ew::Mesh::draw. Identity for full float meshes.
+layout(location = 7) in vec3 vPosOffset;
+layout(location = 8) in vec3 vPosScale;
+
+//Per-instance model matrix from the instance stream. Constant (ew::setModelMatrix) for single draws.
+layout(location = 3) in mat4 _Model;
+
+#include "frameData.glsl"
+
+uniform int _Cascade; //Layer of the shadow map being rendered
 
 void main()
 {
-    gl_Position = _ViewProjection * _Model * vec4(vPos, 1.0);
+    vec3 pos = vPosOffset + vPos * vPosScale;
+    gl_Position = _CascadeViewProj[_Cascade] * _Model * vec4(pos, 1.0);
 }  
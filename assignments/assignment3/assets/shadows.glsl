@@ -0,0 +1,23 @@
+//Cascaded shadow lookup shared by the forward and deferred lighting passes. Include after frameData.glsl.
+uniform sampler2DArray _ShadowMap; //One layer per cascade
+uniform float _ShadowBiasMin;
+uniform float _ShadowBiasMax;
+
+//Cascade covering this view depth. Past the last split nothing is shadowed.
+float calcShadow(vec3 worldPos, vec3 normal)
+{
+	float viewDepth = dot(worldPos - _EyePos, _ViewForward);
+	int cascade = 0;
+	while (cascade < _NumCascades && viewDepth > _CascadeSplits[cascade]) {
+		cascade++;
+	}
+	if (cascade == _NumCascades) {
+		return 0.0;
+	}
+	vec4 lightSpacePos = _CascadeViewProj[cascade] * vec4(worldPos, 1.0);
+	vec3 sampleCoord = lightSpacePos.xyz / lightSpacePos.w;
+	sampleCoord = sampleCoord * 0.5 + 0.5;
+	float bias = max(_ShadowBiasMax * (1.0 - dot(normal,-_LightDirection)),_ShadowBiasMin);
+	float shadowMapDepth = texture(_ShadowMap, vec3(sampleCoord.xy, cascade)).r;
+	return step(shadowMapDepth,sampleCoord.z - bias);
+}
@@ -1,5 +1,8 @@
 #include <stdio.h>
 #include <math.h>
+#include <float.h>
+#include <random>
+#include <chrono>
 
 #include <ew/external/glad.h>
 
@@ -17,12 +20,82 @@
 #include <ew/texture.h>
 #include <ew/procGen.h>
 
+#include <jameslib/benchmark.h>
+#include <jameslib/frameGraph.h>
 #include <jameslib/framebuffer.h>
+#include <jameslib/postProcess.h>
+#include <jameslib/profiler.h>
+#include <jameslib/renderTargetPool.h>
+#include <jameslib/shaderBatch.h>
+#include <jameslib/shaderCache.h>
+#include <jameslib/shaderWatcher.h>
+#include <jameslib/frameUniforms.h>
+#include <jameslib/assetLoader.h>
+#include <jameslib/geometryArena.h>
+#include <jameslib/meshOptimizer.h>
+#include <jameslib/meshSimplifier.h>
+#include <jameslib/culling.h>
+#include <jameslib/instanceBuffer.h>
+#include <jameslib/renderQueue.h>
+#include <jameslib/scene.h>
+#include <jameslib/tiledLighting.h>
 
 
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
-GLFWwindow* initWindow(const char* title, int width, int height);
-void drawUI(jameslib::Framebuffer shadowFBO, jameslib::Framebuffer gBuffer);
+GLFWwindow* initWindow(const char* title, int width, int height, bool hidden);
+void drawUI(uint32_t materialId, jameslib::Framebuffer gBuffer, const jameslib::RenderTargetStats& renderTargetStats, const jameslib::FrameGraph& frameGraph);
+void drawProfiler(jameslib::Profiler& profiler);
+
+//Visible instances of one model for one pass, sorted by LOD so every level is a single instanced draw
+const int MAX_LODS = 4;
+struct InstanceGroups {
+	jameslib::InstanceBuffer buffer;
+	int lodStart[MAX_LODS + 1] = {};
+};
+void uploadInstanceGroups(const std::vector<glm::mat4>& modelMatrices, const jameslib::CullingBounds& bounds, const jameslib::Frustum& frustum, int numLods, float lodBias, InstanceGroups* groups);
+
+//Sort key pass ids, in execution order. Each shadow cascade is its own pass.
+enum RenderPass {
+	PASS_GBUFFER = 0,
+	PASS_SHADOW = 1,
+	PASS_LIT = PASS_SHADOW + jameslib::MAX_SHADOW_CASCADES
+};
+void submitMesh(jameslib::RenderQueue& queue, unsigned int pass, const ew::Shader& shader, const ew::Mesh& mesh, const glm::mat4& modelMatrix, const unsigned int* textures, int numTextures, float depth01);
+void submitModel(jameslib::RenderQueue& queue, unsigned int pass, const ew::Shader& shader, const ew::Model& model, int lod, const glm::mat4& modelMatrix, const unsigned int* textures, int numTextures, float depth01);
+void submitInstanceGroups(jameslib::RenderQueue& queue, unsigned int pass, const ew::Shader& shader, const ew::Model& model, const InstanceGroups& groups, const unsigned int* textures, int numTextures);
+void submitEntities(jameslib::RenderQueue& queue, unsigned int pass, const ew::Shader& shader, jameslib::Scene& scene, const std::vector<jameslib::Entity>& entities, size_t count, unsigned int shadowMap, float passLodBias);
+
+//Lit pass uniforms. The first NUM_LIT_SAMPLERS are samplers bound to units 0, 1, ..., the rest are floats.
+enum LitUniform {
+	LIT_MAIN_TEX,
+	LIT_SHADOW_MAP,
+	LIT_KA,
+	LIT_KD,
+	LIT_KS,
+	LIT_SHININESS,
+	LIT_SHADOW_BIAS_MIN,
+	LIT_SHADOW_BIAS_MAX,
+	NUM_LIT_UNIFORMS
+};
+const int NUM_LIT_SAMPLERS = 2;
+const char* const LIT_UNIFORM_NAMES[NUM_LIT_UNIFORMS] = {
+	"_MainTex", "_ShadowMap", "_Material.Ka", "_Material.Kd", "_Material.Ks", "_Material.Shininess", "_ShadowBiasMin", "_ShadowBiasMax"
+};
+//Uniform locations for the lit pass, only valid for the program they were resolved from
+struct LitUniforms {
+	unsigned int program = 0;
+	ew::UniformHandle handles[NUM_LIT_UNIFORMS];
+};
+LitUniforms getLitUniforms(const ew::Shader& shader);
+
+//Ways of setting the lit pass uniforms, compared in the Performance panel
+enum UniformPath {
+	UNIFORM_PATH_HANDLES, //Precomputed UniformHandles
+	UNIFORM_PATH_CACHED_NAMES, //Setters by name, looked up in the shader's uniform cache
+	UNIFORM_PATH_DRIVER_LOOKUP, //glGetUniformLocation with a std::string per call, as before the cache
+	NUM_UNIFORM_PATHS
+};
+void setLitUniforms(const ew::Shader& shader, const LitUniforms& litUniforms, int path, const float* values);
 
 //Global state
 int screenWidth = 1080;
@@ -30,55 +103,239 @@ int screenHeight = 720;
 float prevFrameTime;
 float deltaTime;
 
-ew::Transform monkeyTransform;
-ew::Transform planeTransform;
+//Scene objects, their transforms, materials and bounds. World data is resolved once per frame and shared by every pass
+jameslib::Scene scene;
+jameslib::Entity monkeyEntity;
+jameslib::Entity planeEntity;
 
 ew::Camera camera;
+//Only position and target are used, for the light direction
 ew::Camera directionalLight;
 ew::CameraController cameraController;
 
-int boxBlurEnabled = 0;
+//BOX_5X5 runs in postprocess.frag, scaled by blurStrength. The other modes go through the post process chain.
+jameslib::BlurSettings blurSettings;
 float blurStrength = 1.0f;
 
 float shadowBiasMin = 0.001f;
 float shadowBiasMax = 0.010f;
 
-struct Material {
-	float Ka = 1.0;
-	float Kd = 0.5;
-	float Ks = 0.5;
-	float Shininess = 128;
-}material;
+//Cascaded shadow maps, one layer of the shadow map array per cascade
+const unsigned int SHADOW_RESOLUTION = 2048;
+int numShadowCascades = 3;
+float cascadeSplitLambda = 0.75f;
+float shadowDistance = 40.0f;
+unsigned int shadowCascadeViews[jameslib::MAX_SHADOW_CASCADES]; //2D views of each layer for the UI
+
+int uniformPath = UNIFORM_PATH_HANDLES;
+int numBatchedObjects = 0;
+//Merge queued draws of arena backed meshes into multi-draws
+bool batchArenaDraws = true;
+float cpuFrameTimeMs;
+//Rolling averages while each uniform path was selected: whole frame and the lit uniform uploads alone
+float uniformPathFrameMs[NUM_UNIFORM_PATHS];
+float uniformPathUploadUs[NUM_UNIFORM_PATHS];
+
+//Shadow maps are low resolution, so the shadow pass can drop detail sooner than the main view
+float lodBias = 0.0f;
+float shadowLodBias = 1.0f;
+int monkeyLod;
+int monkeyShadowLod;
+
+bool frustumCulling = true;
+int numVisibleBatched;
+
+int numInstancedMonkeys = 0;
+int numVisibleMonkeys;
+//Scratch for instance culling and sorting, reused every frame
+std::vector<uint32_t> visibleInstances;
+std::vector<glm::mat4> sortedInstances;
+
+jameslib::StateCacheStats stateCacheStats;
+int numQueuedDraws;
+//Scratch for scene culling, reused every frame
+std::vector<jameslib::Entity> visibleEntities;
+std::vector<jameslib::Entity> shadowCasters[jameslib::MAX_SHADOW_CASCADES];
+
+//Deferred lighting from the G-buffer with point and spot lights binned into screen tiles
+bool deferredLighting = true;
+int gBufferLayout = (int)jameslib::GBufferLayout::COMPACT;
+//The G-buffer view keeps the G-buffer pass alive under forward lighting
+bool showGBuffers = false;
+bool computeLightBinning = true;
+bool showLightTiles = false;
+int numLocalLights = 512;
+float lightBinningMs;
+
+//Scene programs build in the background. Until they are ready everything draws forward with the fallback program.
+jameslib::ShaderBatch shaderBatch;
+//Edits to the shaders in the source tree are rebuilt and swapped in while running
+bool hotReloadShaders = true;
+int numShaderReloads;
+int numShaderReloadErrors;
+
+//CPU zones and GPU timer queries for every frame graph pass, charted in the Profiler window
+bool showProfiler = false;
+bool profilerShowGpu = false;
+//Per light orbit around the scene: (radius, start angle, angular speed, height)
+std::vector<glm::vec4> lightOrbits;
+std::vector<jameslib::Light> localLights;
+void updateLocalLights(float time);
 
-int main() {
-	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight);
+int main(int argc, char** argv) {
+	//--benchmark plays a scripted camera path at a fixed size and writes a report instead of taking input
+	jameslib::BenchmarkSettings benchmarkSettings;
+	if (!jameslib::parseBenchmarkArgs(argc, argv, &benchmarkSettings)) {
+		return 1;
+	}
+	jameslib::BenchmarkRunner benchmark("assignment3", benchmarkSettings);
+	if (benchmark.isEnabled()) {
+		screenWidth = benchmarkSettings.width;
+		screenHeight = benchmarkSettings.height;
+	}
+	GLFWwindow* window = initWindow("Assignment 0", screenWidth, screenHeight, benchmark.isEnabled());
+	benchmark.start();
 	glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
 
-	jameslib::Framebuffer framebuffer = jameslib::createFramebuffer(screenWidth, screenHeight, GL_RGB16F);
-	jameslib::Framebuffer shadowFBO = jameslib::createFramebuffer(1024, 1024, GL_RGB16F);
-	jameslib::Framebuffer gBuffer = jameslib::createGBuffer(screenWidth, screenHeight);
+	jameslib::Framebuffer shadowFBO = jameslib::createDepthFramebuffer(SHADOW_RESOLUTION, SHADOW_RESOLUTION, jameslib::MAX_SHADOW_CASCADES);
+	for (int i = 0; i < jameslib::MAX_SHADOW_CASCADES; i++)
+	{
+		glGenTextures(1, &shadowCascadeViews[i]);
+		glTextureView(shadowCascadeViews[i], GL_TEXTURE_2D, shadowFBO.depthBuffer, GL_DEPTH_COMPONENT24, 0, 1, i, 1);
+	}
+	jameslib::FrameUniforms frameUniforms = jameslib::createFrameUniforms();
+	//Screen sized targets are declared every frame at the current size, so resizes and G-buffer layout changes just work
+	jameslib::RenderTargetPool renderTargets;
+	jameslib::FrameGraph frameGraph(renderTargets);
+	jameslib::PostProcessChain postProcess(renderTargets, "assets/");
 
-	ew::Shader shader = ew::Shader("assets/lit.vert", "assets/lit.frag");
+	//Tiny programs built up front. The fallback lights with N.L only and stands in for every scene program until the batch finishes.
+	ew::Shader fallbackShader = ew::Shader("assets/lit.vert", "assets/fallback.frag");
 	ew::Shader ppShader = ew::Shader("assets/postprocess.vert", "assets/postprocess.frag");
-	ew::Shader shadowShader = ew::Shader("assets/shadow.vert", "assets/shadow.frag");
-	ew::Shader geomPassShader = ew::Shader("assets/geometry.vert", "assets/geometry.frag");
+	ew::Shader shader = fallbackShader;
+	ew::Shader shadowShader = fallbackShader;
+	//Indexed by GBufferLayout
+	const std::vector<std::string> compactDefines = { "GBUFFER_COMPACT" };
+	ew::Shader geomPassShaders[2] = { fallbackShader, fallbackShader };
+	ew::Shader deferredShaders[2] = { fallbackShader, fallbackShader };
+	ew::Shader lightBinShader = fallbackShader;
+	shaderBatch.add(&shader, "assets/lit.vert", "assets/lit.frag");
+	shaderBatch.add(&shadowShader, "assets/shadow.vert", "assets/shadow.frag");
+	shaderBatch.add(&geomPassShaders[0], "assets/geometry.vert", "assets/geometry.frag");
+	shaderBatch.add(&geomPassShaders[1], "assets/geometry.vert", "assets/geometry.frag", compactDefines);
+	shaderBatch.add(&deferredShaders[0], "assets/postprocess.vert", "assets/deferredLit.frag");
+	shaderBatch.add(&deferredShaders[1], "assets/postprocess.vert", "assets/deferredLit.frag", compactDefines);
+
+	//Software and older drivers without compute shaders bin on the CPU instead
+	bool computeBinningSupported = jameslib::isComputeBinningSupported();
+	computeLightBinning = computeBinningSupported;
+	if (computeBinningSupported) {
+		shaderBatch.addCompute(&lightBinShader, "assets/tiledLights.comp");
+	}
+	shaderBatch.submit();
+	//Measured frames must use the real programs
+	if (benchmark.isEnabled()) {
+		shaderBatch.finish();
+	}
+	bool shadersReady = false;
+
+	//The build copies assets next to the executable, so edits are picked up from the source tree instead
+#ifdef SHADER_SOURCE_DIR
+	const std::string shaderSourceDir = SHADER_SOURCE_DIR;
+#else
+	const std::string shaderSourceDir = "assets/";
+#endif
+	jameslib::ShaderWatcher shaderWatcher;
+	shaderWatcher.watch(&shader, shaderSourceDir + "lit.vert", shaderSourceDir + "lit.frag");
+	shaderWatcher.watch(&shadowShader, shaderSourceDir + "shadow.vert", shaderSourceDir + "shadow.frag");
+	shaderWatcher.watch(&geomPassShaders[0], shaderSourceDir + "geometry.vert", shaderSourceDir + "geometry.frag");
+	shaderWatcher.watch(&geomPassShaders[1], shaderSourceDir + "geometry.vert", shaderSourceDir + "geometry.frag", compactDefines);
+	shaderWatcher.watch(&deferredShaders[0], shaderSourceDir + "postprocess.vert", shaderSourceDir + "deferredLit.frag");
+	shaderWatcher.watch(&deferredShaders[1], shaderSourceDir + "postprocess.vert", shaderSourceDir + "deferredLit.frag", compactDefines);
+	shaderWatcher.watch(&ppShader, shaderSourceDir + "postprocess.vert", shaderSourceDir + "postprocess.frag");
+	if (computeBinningSupported) {
+		shaderWatcher.watchCompute(&lightBinShader, shaderSourceDir + "tiledLights.comp");
+	}
+	hotReloadShaders = hotReloadShaders && !benchmark.isEnabled();
+
+	LitUniforms litUniforms = getLitUniforms(shader);
+
+	//Full float meshes share one vertex/index arena so queued draws can merge into multi-draws.
+	//Declared before anything allocating from it so it is destroyed last.
+	jameslib::GeometryArena geometryArena(1 << 18, 1 << 20);
+	jameslib::DrawBatch sceneBatch;
+
+	//Model and texture decode on worker threads and pop in once uploaded
+	jameslib::AssetLoader assetLoader;
+	ew::Model monkeyModel;
+	monkeyModel.setGeometryArena(&geometryArena);
+	assetLoader.loadModel("assets/Suzanne.obj", &monkeyModel, MAX_LODS);
+	ew::MeshData planeMeshData = ew::createPlane(10, 10, 5);
+	jameslib::optimizeMesh(&planeMeshData);
+	ew::Mesh planeMesh = ew::Mesh(planeMeshData, ew::VertexFormat::PACKED);
+	GLuint brickTexture = assetLoader.loadTexture("assets/brick_color.jpg");
 
-	ew::Model monkeyModel = ew::Model("assets/suzanne.obj");
-	ew::Mesh planeMesh = ew::Mesh(ew::createPlane(10, 10, 5));
-	GLuint brickTexture = ew::loadTexture("assets/brick_color.jpg");
+	//Stress test objects draw with one multi-draw call straight from the arena
+	ew::MeshData arenaMeshData[3] = {
+		ew::createSphere(0.5f, 16),
+		ew::createCube(0.8f),
+		ew::createCylinder(0.4f, 1.0f, 16)
+	};
+	jameslib::ArenaMesh arenaMeshes[3];
+	ew::Bounds arenaBounds[3];
+	for (size_t i = 0; i < 3; i++)
+	{
+		jameslib::optimizeMesh(&arenaMeshData[i]);
+		geometryArena.allocate(arenaMeshData[i], &arenaMeshes[i]);
+		arenaBounds[i] = ew::computeBounds(arenaMeshData[i].vertices.data(), arenaMeshData[i].vertices.size());
+	}
+	jameslib::DrawBatch drawBatch;
+	jameslib::CullingBounds batchedBounds;
+	std::vector<glm::mat4> batchedTransforms;
+	std::vector<uint32_t> visibleBatched;
+
+	//Grid of monkey instances behind the main one, rebuilt when the count changes
+	std::vector<glm::mat4> monkeyInstances;
+	jameslib::CullingBounds monkeyInstanceBounds;
+	InstanceGroups cameraMonkeys;
+	InstanceGroups lightMonkeys[jameslib::MAX_SHADOW_CASCADES];
+
+	jameslib::RenderQueue renderQueue;
+	jameslib::GLStateCache stateCache;
+	jameslib::TiledLighting tiledLighting(screenWidth, screenHeight);
 
 	camera.position = glm::vec3(0.0f, 0.0f, 5.0f);
 	camera.target = glm::vec3(0.0f, 0.0f, 0.0f);
 	camera.aspectRatio = (float)screenWidth / screenHeight;
 	camera.fov = 60.0f;
+	jameslib::CameraPath benchmarkPath = jameslib::createOrbitPath(camera.target, glm::length(camera.position - camera.target), 0.0f, 2.5f);
 
 	directionalLight.target = glm::vec3(0, -3, 0);
-	directionalLight.orthographic = true;
 	directionalLight.position = glm::vec3(10, 10, 10);
-	directionalLight.orthoHeight = 10;
-	directionalLight.aspectRatio = 1;
 
-	planeTransform.position += glm::vec3(0, -3, 0);
+	jameslib::Material brickMaterial;
+	brickMaterial.texture = brickTexture;
+	uint32_t brickMaterialId = scene.addMaterial(brickMaterial);
+
+	//Monkey bounds are added once its async load finishes
+	monkeyEntity = scene.createEntity();
+	scene.addTransform(monkeyEntity);
+	jameslib::RenderComponent monkeyRenderable;
+	monkeyRenderable.model = &monkeyModel;
+	monkeyRenderable.material = brickMaterialId;
+	scene.getRenderables().add(monkeyEntity, monkeyRenderable);
+
+	planeEntity = scene.createEntity();
+	ew::Transform planeTransform;
+	planeTransform.position = glm::vec3(0, -3, 0);
+	scene.addTransform(planeEntity, planeTransform);
+	jameslib::RenderComponent planeRenderable;
+	planeRenderable.mesh = &planeMesh;
+	planeRenderable.material = brickMaterialId;
+	scene.getRenderables().add(planeEntity, planeRenderable);
+	jameslib::BoundsComponent planeBounds;
+	planeBounds.local = planeMesh.getBounds();
+	scene.getBounds().add(planeEntity, planeBounds);
 
 	glEnable(GL_CULL_FACE);
 	glCullFace(GL_BACK);
@@ -87,96 +344,448 @@ int main() {
 	unsigned int dummyVAO;
 	glCreateVertexArrays(1, &dummyVAO);
 
-	while (!glfwWindowShouldClose(window)) {
+	jameslib::Profiler& profiler = jameslib::getProfiler();
+	while (!glfwWindowShouldClose(window) && !benchmark.isFinished()) {
+		profiler.beginFrame();
+		benchmark.beginFrame();
 		glfwPollEvents();
 
-		float time = (float)glfwGetTime();
+		float time = benchmark.isEnabled() ? benchmark.getTime() : (float)glfwGetTime();
 		deltaTime = time - prevFrameTime;
 		prevFrameTime = time;
 
-		cameraController.move(window, &camera, deltaTime);
+		renderTargets.beginFrame();
+		//Minimized windows report a size of 0
+		unsigned int targetWidth = screenWidth > 0 ? screenWidth : 1;
+		unsigned int targetHeight = screenHeight > 0 ? screenHeight : 1;
+		tiledLighting.resize(targetWidth, targetHeight);
+		camera.aspectRatio = (float)targetWidth / targetHeight;
+		const ew::Shader& geomPassShader = geomPassShaders[gBufferLayout];
+		const ew::Shader& deferredShader = deferredShaders[gBufferLayout];
+		bool compactGBuffer = gBufferLayout == (int)jameslib::GBufferLayout::COMPACT;
+		//Every scene object shares the brick material for now
+		const jameslib::Material& material = scene.getMaterials()[brickMaterialId];
+
+		if (benchmark.isEnabled()) {
+			benchmark.updateCamera(benchmarkPath, &camera);
+		}
+		else {
+			cameraController.move(window, &camera, deltaTime);
+		}
+
+		{
+			PROFILE_ZONE("Asset Uploads");
+			assetLoader.processUploads(2.0);
+		}
+		if (!shadersReady && shaderBatch.poll()) {
+			shadersReady = true;
+			//A warm start loads every program from the binary cache instead of compiling
+			const jameslib::ShaderCacheStats& shaderCacheStats = jameslib::getShaderCacheStats();
+			printf("Built %d shader programs in %.1f ms (%s): %u cached, %u compiled, %d failed\n", shaderBatch.getNumPrograms(),
+				shaderBatch.getElapsedMs(), shaderBatch.isParallel() ? "parallel" : "serial", shaderCacheStats.hits,
+				shaderCacheStats.misses, shaderBatch.getNumFailed());
+		}
+		//Reloads only start once the batch is done, so they never race it for the same shader
+		if (shadersReady && hotReloadShaders != shaderWatcher.isRunning()) {
+			if (hotReloadShaders) {
+				shaderWatcher.start();
+			}
+			else {
+				shaderWatcher.stop();
+			}
+		}
+		if (shadersReady) {
+			shaderWatcher.update();
+		}
+		//The batch and the watcher swap each program in as soon as it links, so re-resolve on any change
+		if (litUniforms.program != shader.getProgram()) {
+			litUniforms = getLitUniforms(shader);
+		}
+		numShaderReloads = shaderWatcher.getNumReloads();
+		numShaderReloadErrors = shaderWatcher.getNumErrors();
+		//The fallback only has a forward path
+		bool useDeferred = deferredLighting && shadersReady;
+
+		double cpuFrameStart = glfwGetTime();
+
+		//Camera and light data shared by every pass, uploaded once
+		jameslib::FrameData frameData;
+		frameData.viewProjection = camera.projectionMatrix() * camera.viewMatrix();
+		frameData.lightDirection = glm::normalize(directionalLight.target - directionalLight.position);
+		jameslib::ShadowCascades cascades = jameslib::fitShadowCascades(camera, frameData.lightDirection, numShadowCascades,
+			cascadeSplitLambda, shadowDistance, SHADOW_RESOLUTION);
+		frameData.numCascades = cascades.numCascades;
+		for (int i = 0; i < jameslib::MAX_SHADOW_CASCADES; i++)
+		{
+			frameData.cascadeViewProj[i] = cascades.viewProjections[i];
+			frameData.cascadeSplits[i] = cascades.splitDistances[i];
+		}
+		frameData.viewForward = glm::vec4(glm::normalize(camera.target - camera.position), 0.0f);
+		frameData.eyePos = glm::vec4(camera.position, 1.0f);
+		jameslib::writeFrameUniforms(frameUniforms, frameData);
+
+		//Visibility against the main camera and the light's orthographic volume
+		jameslib::Frustum cameraFrustum = jameslib::extractFrustum(frameData.viewProjection);
+		jameslib::Frustum cascadeFrustums[jameslib::MAX_SHADOW_CASCADES];
+		for (int i = 0; i < cascades.numCascades; i++)
+		{
+			cascadeFrustums[i] = jameslib::extractFrustum(cascades.viewProjections[i]);
+		}
+		if (monkeyModel.isLoaded() && !scene.getBounds().has(monkeyEntity)) {
+			jameslib::BoundsComponent monkeyBounds;
+			monkeyBounds.local = monkeyModel.getBounds();
+			scene.getBounds().add(monkeyEntity, monkeyBounds);
+		}
+		scene.updateTransforms();
+		scene.updateBounds();
+		size_t numVisibleEntities;
+		size_t numShadowCasters[jameslib::MAX_SHADOW_CASCADES];
+		const char* cascadeCullNames[jameslib::MAX_SHADOW_CASCADES] = { "Cull Cascade 0", "Cull Cascade 1", "Cull Cascade 2", "Cull Cascade 3" };
+		if (frustumCulling) {
+			numVisibleEntities = scene.cull(cameraFrustum, &visibleEntities, "Cull Camera");
+			for (int i = 0; i < cascades.numCascades; i++)
+			{
+				numShadowCasters[i] = scene.cull(cascadeFrustums[i], &shadowCasters[i], cascadeCullNames[i]);
+			}
+		}
+		else {
+			numVisibleEntities = scene.getAll(&visibleEntities);
+			for (int i = 0; i < cascades.numCascades; i++)
+			{
+				numShadowCasters[i] = scene.getAll(&shadowCasters[i]);
+			}
+		}
+
+		//Detail level from how large the monkey appears to the main camera
+		if (scene.getBounds().has(monkeyEntity)) {
+			glm::vec4 monkeySphere = scene.getWorldSphere(monkeyEntity);
+			float monkeyCoverage = jameslib::computeScreenCoverage(camera, glm::vec3(monkeySphere), monkeySphere.w);
+			monkeyLod = jameslib::selectLod(monkeyCoverage, monkeyModel.getNumLods(), lodBias);
+			monkeyShadowLod = jameslib::selectLod(monkeyCoverage, monkeyModel.getNumLods(), lodBias + shadowLodBias);
+		}
+
+		{
+			PROFILE_ZONE("Instance Culling");
+			if (numInstancedMonkeys > 0 && monkeyModel.isLoaded()) {
+				if ((int)monkeyInstances.size() != numInstancedMonkeys) {
+					int columns = (int)ceilf(sqrtf((float)numInstancedMonkeys));
+					monkeyInstances.resize(numInstancedMonkeys);
+					monkeyInstanceBounds.clear();
+					monkeyInstanceBounds.reserve(numInstancedMonkeys);
+					for (int i = 0; i < numInstancedMonkeys; i++)
+					{
+						glm::vec3 position = glm::vec3((i % columns - columns * 0.5f) * 3.0f, 0.0f, -5.0f - (i / columns) * 3.0f);
+						monkeyInstances[i] = glm::translate(glm::mat4(1.0f), position);
+						monkeyInstanceBounds.add(jameslib::transformBounds(monkeyModel.getBounds(), monkeyInstances[i]));
+					}
+				}
+				uploadInstanceGroups(monkeyInstances, monkeyInstanceBounds, cameraFrustum, monkeyModel.getNumLods(), lodBias, &cameraMonkeys);
+				for (int i = 0; i < cascades.numCascades; i++)
+				{
+					uploadInstanceGroups(monkeyInstances, monkeyInstanceBounds, cascadeFrustums[i], monkeyModel.getNumLods(), lodBias + shadowLodBias, &lightMonkeys[i]);
+				}
+				numVisibleMonkeys = cameraMonkeys.lodStart[MAX_LODS];
+			}
+			else {
+				monkeyInstances.clear();
+				for (int i = 0; i <= MAX_LODS; i++)
+				{
+					cameraMonkeys.lodStart[i] = 0;
+					for (int c = 0; c < jameslib::MAX_SHADOW_CASCADES; c++)
+					{
+						lightMonkeys[c].lodStart[i] = 0;
+					}
+				}
+				numVisibleMonkeys = 0;
+			}
+		}
+
+		//Every scene draw for the frame goes through the queue, sorted by pass then state
+		unsigned int litTextures[2] = { brickTexture, shadowFBO.depthBuffer };
+		{
+			jameslib::ScopedSystemTimer timer(scene.getTiming("Submit"));
+			renderQueue.clear();
+			//The fallback can't write shadow depth or G-buffer layouts, so those passes stay empty until the batch is done
+			if (shadersReady) {
+				submitEntities(renderQueue, PASS_GBUFFER, geomPassShader, scene, visibleEntities, numVisibleEntities, 0, lodBias);
+				for (int i = 0; i < cascades.numCascades; i++)
+				{
+					submitEntities(renderQueue, PASS_SHADOW + i, shadowShader, scene, shadowCasters[i], numShadowCasters[i], 0, lodBias + shadowLodBias);
+					submitInstanceGroups(renderQueue, PASS_SHADOW + i, shadowShader, monkeyModel, lightMonkeys[i], NULL, 0);
+				}
+				submitInstanceGroups(renderQueue, PASS_GBUFFER, geomPassShader, monkeyModel, cameraMonkeys, litTextures, 1);
+			}
+			if (!useDeferred) {
+				submitEntities(renderQueue, PASS_LIT, shader, scene, visibleEntities, numVisibleEntities, shadowFBO.depthBuffer, lodBias);
+				submitInstanceGroups(renderQueue, PASS_LIT, shader, monkeyModel, cameraMonkeys, litTextures, 2);
+			}
+		}
+		{
+			jameslib::ScopedSystemTimer timer(scene.getTiming("Sort"));
+			renderQueue.sort();
+		}
+
+		//ImGui and the post pass bind behind the cache's back every frame
+		stateCache.invalidate();
+		stateCache.resetStats();
+
+		//Every pass declares what it reads and writes. Passes nothing consumes are culled, e.g. the G-buffer
+		//under forward lighting with the G-buffer view hidden.
+		frameGraph.reset();
+		jameslib::FramebufferDesc gBufferDesc = jameslib::getGBufferDesc(targetWidth, targetHeight, (jameslib::GBufferLayout)gBufferLayout);
+		const char* gBufferNames[3] = { "G-Buffer 0", "G-Buffer 1", "G-Buffer 2" };
+		jameslib::FrameGraphResource gBufferTargets[3];
+		for (int i = 0; i < 3; i++)
+		{
+			gBufferTargets[i] = frameGraph.createTexture(gBufferNames[i], targetWidth, targetHeight, gBufferDesc.colorFormats[i]);
+		}
+		jameslib::FrameGraphResource gDepth = frameGraph.createTexture("G-Buffer Depth", targetWidth, targetHeight, gBufferDesc.depthFormat);
+		jameslib::FrameGraphResource sceneColor = frameGraph.createTexture("Scene Color", targetWidth, targetHeight, GL_RGB16F);
+		jameslib::FrameGraphResource sceneDepth = frameGraph.createTexture("Scene Depth", targetWidth, targetHeight, GL_DEPTH_COMPONENT24);
+		jameslib::FrameGraphResource shadowMap = frameGraph.importFramebuffer("Shadow Map", shadowFBO);
+		jameslib::FrameGraphResource lightTiles = frameGraph.importBuffer("Light Tiles", tiledLighting.getTileRangeBuffer());
+		jameslib::FrameGraphResource blurred = frameGraph.importTexture("Blurred", 0, targetWidth, targetHeight);
+		jameslib::Framebuffer windowTarget;
+		windowTarget.width = targetWidth;
+		windowTarget.height = targetHeight;
+		jameslib::FrameGraphResource backbuffer = frameGraph.importFramebuffer("Backbuffer", windowTarget);
+		frameGraph.markOutput(backbuffer);
 
 		//RENDER SCENE TO G-BUFFER
 
-		glBindFramebuffer(GL_FRAMEBUFFER, gBuffer.fbo);
-		glViewport(0, 0, gBuffer.width, gBuffer.height);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		jameslib::FrameGraphPass gBufferPass = frameGraph.addPass("G-Buffer", [&]() {
+			stateCache.useProgram(geomPassShader.getProgram());
+			geomPassShader.setInt("_MainTex", 0);
+			if (compactGBuffer) {
+				geomPassShader.setFloat("_Material.Ka", material.ka);
+				geomPassShader.setFloat("_Material.Kd", material.kd);
+				geomPassShader.setFloat("_Material.Ks", material.ks);
+				geomPassShader.setFloat("_Material.Shininess", material.shininess);
+			}
+			renderQueue.execute(PASS_GBUFFER, stateCache, batchArenaDraws ? &sceneBatch : nullptr);
+		});
+		for (int i = 0; i < 3; i++)
+		{
+			frameGraph.write(gBufferPass, gBufferTargets[i]);
+		}
+		frameGraph.write(gBufferPass, gDepth);
+		frameGraph.setClear(gBufferPass, glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), true, true);
 
-		geomPassShader.use();
-		geomPassShader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
-		geomPassShader.setInt("_MainTex", 0);
+		//BIN LIGHTS INTO SCREEN TILES
 
-		geomPassShader.setMat4("_Model", monkeyTransform.modelMatrix());
-		monkeyModel.draw();
-		geomPassShader.setMat4("_Model", planeTransform.modelMatrix());
-		planeMesh.draw();
+		if (useDeferred) {
+			jameslib::FrameGraphPass binPass = frameGraph.addPass("Light Binning", [&]() {
+				updateLocalLights(time);
+				tiledLighting.uploadLights(localLights.data(), localLights.size());
+				if (computeLightBinning) {
+					tiledLighting.binCompute(lightBinShader, frameGraph.getTexture(gDepth));
+					//Binding changed behind the cache
+					stateCache.invalidate();
+				}
+				else {
+					double binStart = glfwGetTime();
+					tiledLighting.binCpu(frameData.viewProjection);
+					lightBinningMs = (float)((glfwGetTime() - binStart) * 1000.0);
+				}
+			});
+			if (computeLightBinning) {
+				frameGraph.read(binPass, gDepth);
+				frameGraph.write(binPass, lightTiles, jameslib::FrameGraphAccess::STORAGE);
+			}
+			else {
+				frameGraph.write(binPass, lightTiles, jameslib::FrameGraphAccess::CUSTOM);
+			}
+		}
 
 		//RENDER
 
-		glCullFace(GL_FRONT);
-		glBindFramebuffer(GL_FRAMEBUFFER, shadowFBO.fbo);
-		glViewport(0, 0, 1024, 1024);
-		glClear(GL_DEPTH_BUFFER_BIT);
-		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-
-		shadowShader.use();
-		shadowShader.setMat4("_ViewProjection", directionalLight.projectionMatrix() * directionalLight.viewMatrix());
-
-		shadowShader.setMat4("_Model", monkeyTransform.modelMatrix());
-		monkeyModel.draw();
-		shadowShader.setMat4("_Model", planeTransform.modelMatrix());
-		planeMesh.draw();
-
-		glCullFace(GL_BACK);
-		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
-		glViewport(0, 0, framebuffer.width, framebuffer.height);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-
-		glBindTextureUnit(0, brickTexture);
-		glBindTextureUnit(1, shadowFBO.depthBuffer);
-		shader.use();
-		shader.setInt("_MainTex", 0);
-		shader.setInt("_ShadowMap", 1);
-		shader.setMat4("_Model", glm::mat4(1.0f));
-		shader.setMat4("_ViewProjection", camera.projectionMatrix() * camera.viewMatrix());
-		shader.setMat4("_LightViewProj", directionalLight.projectionMatrix() * directionalLight.viewMatrix());
-		shader.setVec3("_EyePos", camera.position);
-		shader.setFloat("_Material.Ka", material.Ka);
-		shader.setFloat("_Material.Kd", material.Kd);
-		shader.setFloat("_Material.Ks", material.Ks);
-		shader.setFloat("_Material.Shininess", material.Shininess);
-		shader.setFloat("_ShadowBiasMin", shadowBiasMin);
-		shader.setFloat("_ShadowBiasMin", shadowBiasMax);
-
-		shader.setMat4("_Model", monkeyTransform.modelMatrix());
-		monkeyModel.draw();
-		shader.setMat4("_Model", planeTransform.modelMatrix());
-		planeMesh.draw();
-
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glViewport(0, 0, screenWidth, screenHeight);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-		glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
-
-		ppShader.use();
-		ppShader.setInt("_BlurEnabled", boxBlurEnabled);
-		ppShader.setFloat("_BlurStrength", blurStrength);
-
-		glBindVertexArray(dummyVAO);
-		glBindTextureUnit(0, framebuffer.colorBuffers[0]);
-		glDrawArrays(GL_TRIANGLES, 0, 6);
-
-		drawUI(shadowFBO, gBuffer);
-
-		glfwSwapBuffers(window);
-	}
-
-	glDeleteFramebuffers(1, &framebuffer.fbo);
-	glDeleteFramebuffers(1, &shadowFBO.fbo);
+		jameslib::FrameGraphPass shadowPass = frameGraph.addPass("Shadows", [&]() {
+			glCullFace(GL_FRONT);
+			stateCache.useProgram(shadowShader.getProgram());
+			for (int i = 0; i < cascades.numCascades; i++)
+			{
+				glNamedFramebufferTextureLayer(shadowFBO.fbo, GL_DEPTH_ATTACHMENT, shadowFBO.depthBuffer, 0, i);
+				glClear(GL_DEPTH_BUFFER_BIT);
+				shadowShader.setInt("_Cascade", i);
+				renderQueue.execute(PASS_SHADOW + i, stateCache, batchArenaDraws ? &sceneBatch : nullptr);
+			}
+			glCullFace(GL_BACK);
+		});
+		frameGraph.write(shadowPass, shadowMap);
+
+		if (useDeferred) {
+			jameslib::FrameGraphPass deferredPass = frameGraph.addPass("Deferred Lighting", [&]() {
+				stateCache.useProgram(deferredShader.getProgram());
+				deferredShader.setInt(compactGBuffer ? "_gNormals" : "_gPositions", 0);
+				deferredShader.setInt(compactGBuffer ? "_gAlbedo" : "_gNormals", 1);
+				deferredShader.setInt(compactGBuffer ? "_gMaterial" : "_gAlbedo", 2);
+				deferredShader.setInt("_ShadowMap", 3);
+				deferredShader.setInt("_gDepth", 4);
+				deferredShader.setMat4("_InverseViewProjection", glm::inverse(frameData.viewProjection));
+				deferredShader.setInt("_NumTilesX", (int)tiledLighting.getNumTilesX());
+				deferredShader.setInt("_ShowLightTiles", showLightTiles);
+				deferredShader.setFloat("_Material.Ka", material.ka);
+				deferredShader.setFloat("_Material.Kd", material.kd);
+				deferredShader.setFloat("_Material.Ks", material.ks);
+				deferredShader.setFloat("_Material.Shininess", material.shininess);
+				deferredShader.setFloat("_ShadowBiasMin", shadowBiasMin);
+				deferredShader.setFloat("_ShadowBiasMax", shadowBiasMax);
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					stateCache.bindTexture(i, frameGraph.getTexture(gBufferTargets[i]));
+				}
+				stateCache.bindTexture(3, shadowFBO.depthBuffer);
+				stateCache.bindTexture(4, frameGraph.getTexture(gDepth));
+				tiledLighting.bind();
+				stateCache.bindVertexArray(dummyVAO);
+				glDrawArrays(GL_TRIANGLES, 0, 6);
+
+				//Forward objects drawn after this depth test against the G-buffer's depth
+				jameslib::Framebuffer gBuffer = frameGraph.getFramebuffer(gBufferPass);
+				jameslib::Framebuffer target = frameGraph.getFramebuffer(deferredPass);
+				glBlitNamedFramebuffer(gBuffer.fbo, target.fbo, 0, 0, gBuffer.width, gBuffer.height,
+					0, 0, target.width, target.height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			});
+			for (int i = 0; i < 3; i++)
+			{
+				frameGraph.read(deferredPass, gBufferTargets[i]);
+			}
+			frameGraph.read(deferredPass, gDepth);
+			frameGraph.read(deferredPass, shadowMap);
+			frameGraph.read(deferredPass, lightTiles, jameslib::FrameGraphAccess::STORAGE);
+			frameGraph.write(deferredPass, sceneColor);
+			frameGraph.write(deferredPass, sceneDepth);
+			frameGraph.setClear(deferredPass, glm::vec4(1.0f), true, true);
+		}
+
+		jameslib::FrameGraphPass forwardPass = frameGraph.addPass("Forward", [&]() {
+			stateCache.bindTexture(0, brickTexture);
+			stateCache.bindTexture(1, shadowFBO.depthBuffer);
+			stateCache.useProgram(shader.getProgram());
+			const float litValues[NUM_LIT_UNIFORMS - NUM_LIT_SAMPLERS] = {
+				material.ka, material.kd, material.ks, material.shininess, shadowBiasMin, shadowBiasMax
+			};
+			std::chrono::steady_clock::time_point uploadStart = std::chrono::steady_clock::now();
+			setLitUniforms(shader, litUniforms, uniformPath, litValues);
+			std::chrono::duration<float, std::micro> uploadTime = std::chrono::steady_clock::now() - uploadStart;
+			uniformPathUploadUs[uniformPath] = uniformPathUploadUs[uniformPath] * 0.95f + uploadTime.count() * 0.05f;
+			renderQueue.execute(PASS_LIT, stateCache, batchArenaDraws ? &sceneBatch : nullptr);
+			stateCacheStats = stateCache.getStats();
+			numQueuedDraws = (int)renderQueue.getNumItems();
+
+			//The lit shader reads _Model from the arena's instance stream here
+			if (numBatchedObjects > 0) {
+				//Square grid of objects centered under the monkey
+				int columns = (int)ceilf(sqrtf((float)numBatchedObjects));
+				batchedTransforms.resize(numBatchedObjects);
+				batchedBounds.clear();
+				batchedBounds.reserve(numBatchedObjects);
+				for (int i = 0; i < numBatchedObjects; i++)
+				{
+					glm::vec3 position = glm::vec3((i % columns - columns * 0.5f) * 1.5f, -2.0f, (i / columns - columns * 0.5f) * 1.5f);
+					batchedTransforms[i] = glm::translate(glm::mat4(1.0f), position);
+					batchedBounds.add(jameslib::transformBounds(arenaBounds[i % 3], batchedTransforms[i]));
+				}
+				visibleBatched.resize(numBatchedObjects);
+				if (frustumCulling) {
+					numVisibleBatched = (int)jameslib::cullBoxes(cameraFrustum, batchedBounds, visibleBatched.data());
+				}
+				else {
+					numVisibleBatched = numBatchedObjects;
+					for (int i = 0; i < numBatchedObjects; i++)
+					{
+						visibleBatched[i] = i;
+					}
+				}
+
+				drawBatch.clear();
+				for (int i = 0; i < numVisibleBatched; i++)
+				{
+					uint32_t index = visibleBatched[i];
+					drawBatch.add(arenaMeshes[index % 3], batchedTransforms[index]);
+				}
+				drawBatch.draw(geometryArena);
+			}
+		});
+		frameGraph.read(forwardPass, shadowMap);
+		frameGraph.write(forwardPass, sceneColor);
+		frameGraph.write(forwardPass, sceneDepth);
+		if (!useDeferred) {
+			frameGraph.setClear(forwardPass, glm::vec4(1.0f), true, true);
+		}
+
+		//POST PROCESS
+
+		jameslib::FrameGraphPass blurPass = frameGraph.addPass("Blur", [&]() {
+			frameGraph.setTexture(blurred, postProcess.blur(frameGraph.getTexture(sceneColor), targetWidth, targetHeight, blurSettings));
+		});
+		frameGraph.read(blurPass, sceneColor);
+		frameGraph.write(blurPass, blurred, jameslib::FrameGraphAccess::CUSTOM);
+
+		jameslib::FrameGraphPass compositePass = frameGraph.addPass("Composite", [&]() {
+			ppShader.use();
+			ppShader.setInt("_BlurEnabled", blurSettings.mode == jameslib::BlurMode::BOX_5X5 ? 1 : 0);
+			ppShader.setFloat("_BlurStrength", blurStrength);
+
+			unsigned int postSource = frameGraph.getTexture(blurred);
+			//The chain's output comes from the pool unless it passed the scene through. It may be half resolution.
+			bool chainOutput = postSource != frameGraph.getTexture(sceneColor);
+			glBindVertexArray(dummyVAO);
+			glBindTextureUnit(0, postSource);
+			if (chainOutput) {
+				glBindSampler(0, postProcess.getLinearSampler());
+			}
+			glDrawArrays(GL_TRIANGLES, 0, 6);
+			if (chainOutput) {
+				glBindSampler(0, 0);
+				renderTargets.releaseTexture(postSource);
+			}
+
+			//Rolling average of CPU time spent issuing GL commands for the scene
+			float cpuMs = (float)((glfwGetTime() - cpuFrameStart) * 1000.0);
+			cpuFrameTimeMs = cpuFrameTimeMs * 0.95f + cpuMs * 0.05f;
+			uniformPathFrameMs[uniformPath] = uniformPathFrameMs[uniformPath] * 0.95f + cpuMs * 0.05f;
+		});
+		frameGraph.read(compositePass, blurred);
+		frameGraph.read(compositePass, sceneColor);
+		frameGraph.write(compositePass, backbuffer);
+		frameGraph.setClear(compositePass, glm::vec4(1.0f), true, true);
+
+		//The G-buffer view is the only reader of the G-buffer under forward lighting
+		jameslib::FrameGraphPass uiPass = frameGraph.addPass("UI", [&]() {
+			drawUI(brickMaterialId, showGBuffers ? frameGraph.getFramebuffer(gBufferPass) : jameslib::Framebuffer(), renderTargets.getStats(), frameGraph);
+		});
+		if (showGBuffers) {
+			for (int i = 0; i < 3; i++)
+			{
+				frameGraph.read(uiPass, gBufferTargets[i]);
+			}
+		}
+		frameGraph.write(uiPass, backbuffer);
+
+		{
+			PROFILE_ZONE("Frame Graph");
+			frameGraph.compile();
+			frameGraph.execute();
+		}
+		jameslib::fenceFrameUniforms(frameUniforms);
+
+		benchmark.endFrame(screenWidth, screenHeight);
+		{
+			//Blocks on vsync
+			PROFILE_ZONE("Swap Buffers");
+			glfwSwapBuffers(window);
+		}
+		profiler.endFrame();
+	}
+	bool reportWritten = !benchmark.isEnabled() || benchmark.writeReport();
+
+	jameslib::destroyFramebuffer(shadowFBO);
+	glDeleteTextures(jameslib::MAX_SHADOW_CASCADES, shadowCascadeViews);
+	jameslib::destroyFrameUniforms(frameUniforms);
 
 	printf("Shutting down...");
+	return reportWritten ? 0 : 1;
 }
 
 void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
@@ -186,7 +795,7 @@ void resetCamera(ew::Camera* camera, ew::CameraController* controller) {
 }
 
 
-void drawUI(jameslib::Framebuffer shadowFBO, jameslib::Framebuffer gBuffer) {
+void drawUI(uint32_t materialId, jameslib::Framebuffer gBuffer, const jameslib::RenderTargetStats& renderTargetStats, const jameslib::FrameGraph& frameGraph) {
 	ImGui_ImplGlfw_NewFrame();
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui::NewFrame();
@@ -195,20 +804,113 @@ void drawUI(jameslib::Framebuffer shadowFBO, jameslib::Framebuffer gBuffer) {
 	if (ImGui::Button("Reset Camera")) {
 		resetCamera(&camera, &cameraController);
 	}
+	if (ImGui::CollapsingHeader("Performance")) {
+		ImGui::Text("CPU frame time: %.3f ms", cpuFrameTimeMs);
+		ImGui::Checkbox("Show Profiler", &showProfiler);
+		const jameslib::ShaderCacheStats& shaderCacheStats = jameslib::getShaderCacheStats();
+		ImGui::Text("Shader programs: %u cached (%.1f ms), %u compiled (%.1f ms)", shaderCacheStats.hits, shaderCacheStats.loadMs,
+			shaderCacheStats.misses, shaderCacheStats.compileMs);
+		ImGui::Text("Shader batch: %d / %d ready, %d failed in %.1f ms (%s)", shaderBatch.getNumReady(), shaderBatch.getNumPrograms(),
+			shaderBatch.getNumFailed(), shaderBatch.getElapsedMs(), shaderBatch.isParallel() ? "parallel" : "serial");
+		ImGui::Checkbox("Hot Reload Shaders", &hotReloadShaders);
+		ImGui::Text("Shader reloads: %d (%d kept the last good program)", numShaderReloads, numShaderReloadErrors);
+		const char* uniformPaths[NUM_UNIFORM_PATHS] = { "Handles", "Cached Names", "glGetUniformLocation" };
+		ImGui::Combo("Uniform Path", &uniformPath, uniformPaths, NUM_UNIFORM_PATHS);
+		//Each row keeps the averages from the last time that path was selected
+		for (int i = 0; i < NUM_UNIFORM_PATHS; i++)
+		{
+			ImGui::Text("  %s: %.3f ms CPU frame, %.2f us lit uniforms", uniformPaths[i], uniformPathFrameMs[i], uniformPathUploadUs[i]);
+		}
+		ImGui::SliderInt("Batched Objects", &numBatchedObjects, 0, 10000);
+		ImGui::Checkbox("Multi-Draw Arena Meshes", &batchArenaDraws);
+		ImGui::Checkbox("Frustum Culling", &frustumCulling);
+		ImGui::Text("Visible batched objects: %d / %d (%s)", numVisibleBatched, numBatchedObjects, jameslib::getCullingKernelName());
+		ImGui::SliderInt("Instanced Monkeys", &numInstancedMonkeys, 0, 50000);
+		ImGui::Text("Visible monkey instances: %d / %d", numVisibleMonkeys, numInstancedMonkeys);
+		ImGui::Text("Monkey LOD: %d (shadow %d)", monkeyLod, monkeyShadowLod);
+		ImGui::Text("Queued draws: %d", numQueuedDraws);
+		ImGui::Text("Program binds: %d (%d elided)", stateCacheStats.programBinds, stateCacheStats.programBindsElided);
+		ImGui::Text("VAO binds: %d (%d elided)", stateCacheStats.vertexArrayBinds, stateCacheStats.vertexArrayBindsElided);
+		ImGui::Text("Texture binds: %d (%d elided)", stateCacheStats.textureBinds, stateCacheStats.textureBindsElided);
+		ImGui::SliderFloat("LOD Bias", &lodBias, -1.0f, 3.0f);
+		ImGui::SliderFloat("Shadow LOD Bias", &shadowLodBias, 0.0f, 3.0f);
+		ImGui::Text("Scene entities: %d", (int)scene.getNumEntities());
+		ImGui::Checkbox("Deferred Lighting", &deferredLighting);
+		const char* gBufferLayouts[2] = { "Wide", "Compact" };
+		ImGui::Combo("G-Buffer Layout", &gBufferLayout, gBufferLayouts, 2);
+		unsigned int gBufferBytes = jameslib::getGBufferBytesPerPixel((jameslib::GBufferLayout)gBufferLayout);
+		ImGui::Text("G-buffer: %u bytes/pixel (%.1f MB)", gBufferBytes, gBufferBytes * (float)screenWidth * screenHeight / (1024.0f * 1024.0f));
+		ImGui::Checkbox("Show G-Buffers", &showGBuffers);
+		ImGui::SliderInt("Point/Spot Lights", &numLocalLights, 0, 4096);
+		if (jameslib::isComputeBinningSupported()) {
+			ImGui::Checkbox("Compute Light Binning", &computeLightBinning);
+		}
+		if (!computeLightBinning) {
+			ImGui::Text("CPU light binning: %.3f ms", lightBinningMs);
+		}
+		ImGui::Checkbox("Show Light Tiles", &showLightTiles);
+		const std::deque<jameslib::SystemTiming>& timings = scene.getTimings();
+		for (size_t i = 0; i < timings.size(); i++)
+		{
+			ImGui::Text("%s: %.3f ms", timings[i].name.c_str(), timings[i].ms);
+		}
+	}
 	if (ImGui::CollapsingHeader("Material")) {
-		ImGui::SliderFloat("AmbientK", &material.Ka, 0.0f, 1.0f);
-		ImGui::SliderFloat("DiffuseK", &material.Kd, 0.0f, 1.0f);
-		ImGui::SliderFloat("SpecularK", &material.Ks, 0.0f, 1.0f);
-		ImGui::SliderFloat("Shininess", &material.Shininess, 2.0f, 1024.0f);
+		jameslib::Material& material = scene.getMaterials()[materialId];
+		ImGui::SliderFloat("AmbientK", &material.ka, 0.0f, 1.0f);
+		ImGui::SliderFloat("DiffuseK", &material.kd, 0.0f, 1.0f);
+		ImGui::SliderFloat("SpecularK", &material.ks, 0.0f, 1.0f);
+		ImGui::SliderFloat("Shininess", &material.shininess, 2.0f, 1024.0f);
 	}
 	if (ImGui::CollapsingHeader("Post Processing")) {
-		ImGui::SliderInt("Box Blur", &boxBlurEnabled, 0, 1);
-		ImGui::SliderFloat("Blur Strength", &blurStrength, 0.0f, 1.0f);
+		const char* blurModes[5] = { "None", "Box 5x5", "Separable Box", "Separable Gaussian", "Dual Kawase" };
+		int blurMode = (int)blurSettings.mode;
+		if (ImGui::Combo("Blur", &blurMode, blurModes, 5)) {
+			blurSettings.mode = (jameslib::BlurMode)blurMode;
+		}
+		if (blurSettings.mode == jameslib::BlurMode::BOX_5X5) {
+			ImGui::SliderFloat("Blur Strength", &blurStrength, 0.0f, 1.0f);
+		}
+		else if (blurSettings.mode == jameslib::BlurMode::DUAL_KAWASE) {
+			ImGui::SliderInt("Kawase Levels", &blurSettings.kawaseLevels, 1, jameslib::MAX_KAWASE_LEVELS);
+		}
+		else if (blurSettings.mode != jameslib::BlurMode::NONE) {
+			ImGui::SliderFloat("Blur Radius", &blurSettings.radius, 1.0f, 60.0f);
+			bool halfResolution = blurSettings.downsample > 1;
+			if (ImGui::Checkbox("Half Resolution", &halfResolution)) {
+				blurSettings.downsample = halfResolution ? 2 : 1;
+			}
+		}
+		ImGui::Text("Blur taps/pixel: %.2f", jameslib::getBlurTapsPerPixel(blurSettings));
+	}
+	if (ImGui::CollapsingHeader("Render Targets")) {
+		const float mb = 1.0f / (1024.0f * 1024.0f);
+		ImGui::Text("Textures: %d, framebuffers: %d", (int)renderTargetStats.numTextures, (int)renderTargetStats.numFramebuffers);
+		ImGui::Text("VRAM held: %.1f MB", renderTargetStats.allocatedBytes * mb);
+		ImGui::Text("Requested this frame: %.1f MB", renderTargetStats.requestedBytes * mb);
+		ImGui::Text("Peak in use: %.1f MB", renderTargetStats.peakBytesInUse * mb);
+		ImGui::Text("Textures created: %d", (int)renderTargetStats.texturesCreated);
+	}
+	if (ImGui::CollapsingHeader("Frame Graph")) {
+		ImGui::Text("Passes: %d (%d culled), barriers: %d", (int)frameGraph.getNumPasses(), (int)frameGraph.getNumCulledPasses(), (int)frameGraph.getNumBarriers());
+		const std::vector<jameslib::FrameGraphTiming>& passTimings = frameGraph.getTimings();
+		for (size_t i = 0; i < passTimings.size(); i++)
+		{
+			if (passTimings[i].culled) {
+				ImGui::TextDisabled("%-18s culled", passTimings[i].name.c_str());
+			}
+			else {
+				ImGui::Text("%-18s CPU %.3f ms  GPU %.3f ms", passTimings[i].name.c_str(), passTimings[i].cpuMs, passTimings[i].gpuMs);
+			}
+		}
 	}
 	if (ImGui::CollapsingHeader("Directional Light")) {
 		ImGui::SliderFloat3("Position", &directionalLight.position.x, -10.0f, 10.0f);
 		ImGui::SliderFloat("Shadow Bias Min", &shadowBiasMin, 0.001, 0.010);
 		ImGui::SliderFloat("Shadow Bias Max", &shadowBiasMax, 0.005, 0.030);
+		ImGui::SliderInt("Shadow Cascades", &numShadowCascades, 1, jameslib::MAX_SHADOW_CASCADES);
+		ImGui::SliderFloat("Cascade Split Lambda", &cascadeSplitLambda, 0.0f, 1.0f);
+		ImGui::SliderFloat("Shadow Distance", &shadowDistance, 5.0f, 100.0f);
 
 	}
 	ImGui::End();
@@ -216,11 +918,19 @@ void drawUI(jameslib::Framebuffer shadowFBO, jameslib::Framebuffer gBuffer) {
 	ImGui::Begin("Shadow Map");
 	ImGui::BeginChild("Shadow Map");
 	ImVec2 windowSize = ImGui::GetWindowSize();
-	ImGui::Image((ImTextureID)shadowFBO.depthBuffer, windowSize, ImVec2(0, 1), ImVec2(1, 0));
+	ImVec2 cascadeSize = ImVec2(windowSize.x * 0.5f, windowSize.y * 0.5f);
+	for (int i = 0; i < numShadowCascades; i++)
+	{
+		if (i % 2 == 1) {
+			ImGui::SameLine();
+		}
+		ImGui::Image((ImTextureID)shadowCascadeViews[i], cascadeSize, ImVec2(0, 1), ImVec2(1, 0));
+	}
 	ImGui::EndChild();
 	ImGui::End();
 
-	ImGui::Begin("GBuffers"); {
+	if (showGBuffers) {
+		ImGui::Begin("GBuffers");
 		ImVec2 texSize = ImVec2(gBuffer.width / 4, gBuffer.height / 4);
 		for (size_t i = 0; i < 3; i++)
 		{
@@ -229,10 +939,309 @@ void drawUI(jameslib::Framebuffer shadowFBO, jameslib::Framebuffer gBuffer) {
 		ImGui::End();
 	}
 
+	if (showProfiler) {
+		drawProfiler(jameslib::getProfiler());
+	}
+
 	ImGui::Render();
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+/// <summary>
+/// Flame chart of one recent frame with its GPU passes underneath, and a bar chart of every zone's
+/// rolling history. The chart shows the newest frame whose GPU timings have been read back.
+/// </summary>
+void drawProfiler(jameslib::Profiler& profiler) {
+	const ImU32 zoneColors[6] = {
+		IM_COL32(66, 135, 245, 255), IM_COL32(235, 110, 52, 255), IM_COL32(76, 175, 80, 255),
+		IM_COL32(171, 71, 188, 255), IM_COL32(0, 172, 193, 255), IM_COL32(192, 160, 0, 255)
+	};
+	const std::vector<jameslib::ProfilerZone>& zones = profiler.getZones();
+
+	ImGui::Begin("Profiler", &showProfiler);
+	if (ImGui::Button("Export Chrome Trace")) {
+		if (profiler.writeChromeTrace("profile.json")) {
+			printf("Wrote profile.json\n");
+		}
+	}
+
+	if (profiler.getFrameIndex() >= jameslib::PROFILER_QUERY_LATENCY) {
+		uint64_t frameIndex = profiler.getFrameIndex() - jameslib::PROFILER_QUERY_LATENCY;
+		const jameslib::ProfilerFrame& frame = profiler.getFrame((unsigned int)(frameIndex % jameslib::PROFILER_HISTORY_FRAMES));
+		double cpuMs = frame.endMs - frame.startMs;
+		double gpuMs = 0.0;
+		uint32_t maxDepth = 0;
+		for (size_t i = 0; i < frame.events.size(); i++)
+		{
+			gpuMs += frame.events[i].gpuMs > 0.0f ? frame.events[i].gpuMs : 0.0f;
+			maxDepth = frame.events[i].depth > maxDepth ? frame.events[i].depth : maxDepth;
+		}
+		ImGui::Text("Frame %llu: CPU %.3f ms, GPU %.3f ms", (unsigned long long)frame.index, cpuMs, gpuMs);
+
+		//CPU zones by depth, then the GPU zones laid end to end since elapsed queries have no start time
+		const float rowHeight = 18.0f;
+		ImDrawList* drawList = ImGui::GetWindowDrawList();
+		ImVec2 origin = ImGui::GetCursorScreenPos();
+		float width = ImGui::GetContentRegionAvail().x;
+		double chartMs = cpuMs > gpuMs ? cpuMs : gpuMs;
+		float pixelsPerMs = chartMs > 0.0 ? (float)(width / chartMs) : 0.0f;
+		float gpuY = origin.y + (maxDepth + 1) * rowHeight + 4.0f;
+		float gpuX = origin.x;
+		for (size_t i = 0; i < frame.events.size(); i++)
+		{
+			const jameslib::ProfilerEvent& e = frame.events[i];
+			const std::string& name = zones[e.zone].name;
+			ImVec2 min = ImVec2(origin.x + (float)(e.startMs - frame.startMs) * pixelsPerMs, origin.y + e.depth * rowHeight);
+			ImVec2 max = ImVec2(min.x + (float)(e.endMs - e.startMs) * pixelsPerMs, min.y + rowHeight - 1.0f);
+			max.x = max.x > min.x + 1.0f ? max.x : min.x + 1.0f;
+			drawList->AddRectFilled(min, max, zoneColors[e.zone % 6]);
+			if (max.x - min.x > name.size() * 7.0f + 4.0f) {
+				drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(255, 255, 255, 255), name.c_str());
+			}
+			if (ImGui::IsMouseHoveringRect(min, max)) {
+				ImGui::SetTooltip("%s\nCPU %.3f ms", name.c_str(), e.endMs - e.startMs);
+			}
+
+			if (e.gpuMs > 0.0f) {
+				ImVec2 gpuMin = ImVec2(gpuX, gpuY);
+				ImVec2 gpuMax = ImVec2(gpuX + e.gpuMs * pixelsPerMs, gpuY + rowHeight - 1.0f);
+				gpuMax.x = gpuMax.x > gpuMin.x + 1.0f ? gpuMax.x : gpuMin.x + 1.0f;
+				drawList->AddRectFilled(gpuMin, gpuMax, zoneColors[e.zone % 6]);
+				if (gpuMax.x - gpuMin.x > name.size() * 7.0f + 4.0f) {
+					drawList->AddText(ImVec2(gpuMin.x + 2.0f, gpuMin.y + 2.0f), IM_COL32(255, 255, 255, 255), name.c_str());
+				}
+				if (ImGui::IsMouseHoveringRect(gpuMin, gpuMax)) {
+					ImGui::SetTooltip("%s\nGPU %.3f ms", name.c_str(), e.gpuMs);
+				}
+				gpuX = gpuMax.x;
+			}
+		}
+		ImGui::Dummy(ImVec2(width, gpuY + rowHeight - origin.y));
+	}
+
+	//Bars run oldest to newest. The newest PROFILER_QUERY_LATENCY GPU bars are still in flight.
+	ImGui::Separator();
+	ImGui::Checkbox("GPU History", &profilerShowGpu);
+	int historyOffset = (int)((profiler.getLastFrameSlot() + 1) % jameslib::PROFILER_HISTORY_FRAMES);
+	for (size_t i = 0; i < zones.size(); i++)
+	{
+		const jameslib::ProfilerZone& zone = zones[i];
+		if (profilerShowGpu && !zone.hasGpu) {
+			continue;
+		}
+		char overlay[64];
+		snprintf(overlay, sizeof(overlay), "%.3f ms", profilerShowGpu ? zone.avgGpuMs : zone.avgCpuMs);
+		ImGui::PushID((int)i);
+		ImGui::Text("%s", zone.name.c_str());
+		ImGui::PlotHistogram("##History", profilerShowGpu ? zone.gpuMs : zone.cpuMs, (int)jameslib::PROFILER_HISTORY_FRAMES,
+			historyOffset, overlay, 0.0f, FLT_MAX, ImVec2(0.0f, 40.0f));
+		ImGui::PopID();
+	}
+	ImGui::End();
+}
+
+/// <summary>
+/// Culls instances against a frustum, buckets the survivors by screen size LOD and uploads them
+/// LOD by LOD so that groups->lodStart[i] is the first instance of level i.
+/// </summary>
+void uploadInstanceGroups(const std::vector<glm::mat4>& modelMatrices, const jameslib::CullingBounds& bounds, const jameslib::Frustum& frustum, int numLods, float lodBias, InstanceGroups* groups) {
+	visibleInstances.resize(bounds.count);
+	size_t numVisible = bounds.count;
+	if (frustumCulling) {
+		numVisible = jameslib::cullSpheres(frustum, bounds, visibleInstances.data());
+	}
+	else {
+		for (size_t i = 0; i < numVisible; i++)
+		{
+			visibleInstances[i] = (uint32_t)i;
+		}
+	}
+
+	//Counting sort by LOD
+	int lodCounts[MAX_LODS] = {};
+	std::vector<uint8_t> lods(numVisible);
+	for (size_t i = 0; i < numVisible; i++)
+	{
+		uint32_t index = visibleInstances[i];
+		glm::vec3 center = glm::vec3(bounds.centerX[index], bounds.centerY[index], bounds.centerZ[index]);
+		float coverage = jameslib::computeScreenCoverage(camera, center, bounds.radius[index]);
+		lods[i] = (uint8_t)jameslib::selectLod(coverage, glm::min(numLods, MAX_LODS), lodBias);
+		lodCounts[lods[i]]++;
+	}
+	groups->lodStart[0] = 0;
+	for (int i = 0; i < MAX_LODS; i++)
+	{
+		groups->lodStart[i + 1] = groups->lodStart[i] + lodCounts[i];
+	}
+	int next[MAX_LODS];
+	for (int i = 0; i < MAX_LODS; i++)
+	{
+		next[i] = groups->lodStart[i];
+	}
+	sortedInstances.resize(numVisible);
+	for (size_t i = 0; i < numVisible; i++)
+	{
+		sortedInstances[next[lods[i]]++] = modelMatrices[visibleInstances[i]];
+	}
+	groups->buffer.upload(sortedInstances.data(), numVisible);
+}
+
+LitUniforms getLitUniforms(const ew::Shader& shader) {
+	LitUniforms litUniforms;
+	litUniforms.program = shader.getProgram();
+	for (int i = 0; i < NUM_LIT_UNIFORMS; i++)
+	{
+		litUniforms.handles[i] = shader.getUniformHandle(LIT_UNIFORM_NAMES[i]);
+	}
+	return litUniforms;
+}
+
+/// <summary>
+/// Sets the lit pass uniforms through one of the UniformPaths. Samplers get their unit, the rest take values in order.
+/// </summary>
+void setLitUniforms(const ew::Shader& shader, const LitUniforms& litUniforms, int path, const float* values) {
+	for (int i = 0; i < NUM_LIT_UNIFORMS; i++)
+	{
+		bool isSampler = i < NUM_LIT_SAMPLERS;
+		float value = isSampler ? 0.0f : values[i - NUM_LIT_SAMPLERS];
+		if (path == UNIFORM_PATH_HANDLES) {
+			if (isSampler) {
+				shader.setInt(litUniforms.handles[i], i);
+			}
+			else {
+				shader.setFloat(litUniforms.handles[i], value);
+			}
+		}
+		else if (path == UNIFORM_PATH_CACHED_NAMES) {
+			if (isSampler) {
+				shader.setInt(LIT_UNIFORM_NAMES[i], i);
+			}
+			else {
+				shader.setFloat(LIT_UNIFORM_NAMES[i], value);
+			}
+		}
+		else {
+			std::string name = LIT_UNIFORM_NAMES[i];
+			int location = glGetUniformLocation(shader.getProgram(), name.c_str());
+			if (isSampler) {
+				glUniform1i(location, i);
+			}
+			else {
+				glUniform1f(location, value);
+			}
+		}
+	}
+}
+
+void submitMesh(jameslib::RenderQueue& queue, unsigned int pass, const ew::Shader& shader, const ew::Mesh& mesh, const glm::mat4& modelMatrix, const unsigned int* textures, int numTextures, float depth01) {
+	jameslib::DrawItem item = jameslib::makeDrawItem(mesh, shader.getProgram(), modelMatrix);
+	for (int i = 0; i < numTextures; i++)
+	{
+		item.textures[i] = textures[i];
+	}
+	item.key = jameslib::makeSortKey(pass, item.program, numTextures > 0 ? textures[0] : 0, item.vao, depth01);
+	queue.submit(item);
+}
+
+void submitModel(jameslib::RenderQueue& queue, unsigned int pass, const ew::Shader& shader, const ew::Model& model, int lod, const glm::mat4& modelMatrix, const unsigned int* textures, int numTextures, float depth01) {
+	if (!model.isLoaded()) {
+		return;
+	}
+	const std::vector<ew::Mesh>& meshes = model.getMeshes(lod);
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		submitMesh(queue, pass, shader, meshes[i], modelMatrix, textures, numTextures, depth01);
+	}
+}
+
+/// <summary>
+/// One instanced draw item per LOD range and submesh. Instances are already depth mixed, so they sort last.
+/// </summary>
+void submitInstanceGroups(jameslib::RenderQueue& queue, unsigned int pass, const ew::Shader& shader, const ew::Model& model, const InstanceGroups& groups, const unsigned int* textures, int numTextures) {
+	if (!model.isLoaded()) {
+		return;
+	}
+	for (int lod = 0; lod < MAX_LODS; lod++)
+	{
+		int count = groups.lodStart[lod + 1] - groups.lodStart[lod];
+		if (count <= 0) {
+			continue;
+		}
+		const std::vector<ew::Mesh>& meshes = model.getMeshes(lod);
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			jameslib::DrawItem item = jameslib::makeDrawItem(meshes[i], shader.getProgram(), glm::mat4(1.0f));
+			for (int t = 0; t < numTextures; t++)
+			{
+				item.textures[t] = textures[t];
+			}
+			item.instanceBuffer = groups.buffer.getBuffer();
+			item.instanceCount = count;
+			item.firstInstance = groups.lodStart[lod];
+			item.key = jameslib::makeSortKey(pass, item.program, numTextures > 0 ? textures[0] : 0, item.vao, 1.0f);
+			queue.submit(item);
+		}
+	}
+}
+
+/// <summary>
+/// Submits one draw per submesh for each renderable entity in the list. Models pick their LOD from screen coverage.
+/// A non-zero shadow map is bound after the material texture; the shadow pass skips entities that don't cast.
+/// </summary>
+void submitEntities(jameslib::RenderQueue& queue, unsigned int pass, const ew::Shader& shader, jameslib::Scene& scene, const std::vector<jameslib::Entity>& entities, size_t count, unsigned int shadowMap, float passLodBias) {
+	const std::vector<jameslib::Material>& materials = scene.getMaterials();
+	scene.forEachRenderable(entities, count, [&](jameslib::Entity entity, const jameslib::RenderComponent& renderable, const glm::mat4& worldMatrix) {
+		bool shadowPass = pass >= PASS_SHADOW && pass < PASS_LIT;
+		if (shadowPass && !renderable.castsShadow) {
+			return;
+		}
+		glm::vec4 sphere = scene.getWorldSphere(entity);
+		float depth01 = glm::length(glm::vec3(sphere) - camera.position) / camera.farPlane;
+		unsigned int textures[2] = { materials[renderable.material].texture, shadowMap };
+		int numTextures = shadowPass ? 0 : (shadowMap != 0 ? 2 : 1);
+		if (renderable.model) {
+			float coverage = jameslib::computeScreenCoverage(camera, glm::vec3(sphere), sphere.w);
+			int lod = jameslib::selectLod(coverage, renderable.model->getNumLods(), passLodBias);
+			submitModel(queue, pass, shader, *renderable.model, lod, worldMatrix, textures, numTextures, depth01);
+		}
+		else if (renderable.mesh) {
+			submitMesh(queue, pass, shader, *renderable.mesh, worldMatrix, textures, numTextures, depth01);
+		}
+	});
+}
+
+/// <summary>
+/// Regenerates the local lights when their count changes, then moves each along its orbit.
+/// Every fourth light is a spot pointing down at the floor.
+/// </summary>
+void updateLocalLights(float time) {
+	if ((int)lightOrbits.size() != numLocalLights) {
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+		lightOrbits.resize(numLocalLights);
+		localLights.resize(numLocalLights);
+		for (int i = 0; i < numLocalLights; i++)
+		{
+			lightOrbits[i] = glm::vec4(1.0f + unit(random) * 6.0f, unit(random) * 6.283f, 0.2f + unit(random) * 0.6f, -2.5f + unit(random) * 3.0f);
+			float hue = unit(random);
+			glm::vec3 color = glm::vec3(0.5f) + 0.5f * glm::vec3(cosf(6.283f * hue), cosf(6.283f * (hue + 0.33f)), cosf(6.283f * (hue + 0.67f)));
+			float radius = 1.5f + unit(random) * 1.5f;
+			if (i % 4 == 3) {
+				localLights[i] = jameslib::makeSpotLight(glm::vec3(0.0f), glm::vec3(0.0f, -1.0f, 0.0f), radius * 2.0f, color * 6.0f, 20.0f, 30.0f);
+			}
+			else {
+				localLights[i] = jameslib::makePointLight(glm::vec3(0.0f), radius, color * 4.0f);
+			}
+		}
+	}
+	for (int i = 0; i < numLocalLights; i++)
+	{
+		const glm::vec4& orbit = lightOrbits[i];
+		float angle = orbit.y + time * orbit.z;
+		localLights[i].positionRadius = glm::vec4(cosf(angle) * orbit.x, orbit.w, sinf(angle) * orbit.x, localLights[i].positionRadius.w);
+	}
+}
+
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
 	glViewport(0, 0, width, height);
@@ -246,14 +1255,19 @@ void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 /// <param name="title">Window title</param>
 /// <param name="width">Window width</param>
 /// <param name="height">Window height</param>
+/// <param name="hidden">Creates the window invisible with vsync off, for benchmarks</param>
 /// <returns>Returns window handle on success or null on fail</returns>
-GLFWwindow* initWindow(const char* title, int width, int height) {
+GLFWwindow* initWindow(const char* title, int width, int height, bool hidden) {
 	printf("Initializing...");
 	if (!glfwInit()) {
 		printf("GLFW failed to init!");
 		return nullptr;
 	}
 
+	//Benchmarks run unseen and unthrottled
+	if (hidden) {
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	}
 	GLFWwindow* window = glfwCreateWindow(width, height, title, NULL, NULL);
 	if (window == NULL) {
 		printf("GLFW failed to create window");
@@ -265,6 +1279,9 @@ GLFWwindow* initWindow(const char* title, int width, int height) {
 		printf("GLAD Failed to load GL headers");
 		return nullptr;
 	}
+	if (hidden) {
+		glfwSwapInterval(0);
+	}
 
 	//Initialize ImGUI
 	IMGUI_CHECKVERSION();
@@ -7,50 +7,272 @@
 
 #include "mesh.h"
 #include "external/glad.h"
+#include "../jameslib/geometryArena.h"
+#include <glm/gtc/packing.hpp>
+#include <math.h>
+#include <utility>
 
 namespace ew {
-	Mesh::Mesh(const MeshData& meshData)
+	void setModelMatrix(const glm::mat4& model)
 	{
-		load(meshData);
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			glVertexAttrib4f(VERTEX_ATTRIB_MODEL + i, model[i].x, model[i].y, model[i].z, model[i].w);
+		}
+	}
+
+	/// <summary>
+	/// Computes the axis aligned box of the vertices and a sphere around its center
+	/// </summary>
+	Bounds computeBounds(const Vertex* vertices, size_t numVertices)
+	{
+		Bounds bounds;
+		if (numVertices == 0) {
+			return bounds;
+		}
+		bounds.min = vertices[0].pos;
+		bounds.max = vertices[0].pos;
+		for (size_t i = 1; i < numVertices; i++)
+		{
+			bounds.min = glm::min(bounds.min, vertices[i].pos);
+			bounds.max = glm::max(bounds.max, vertices[i].pos);
+		}
+		bounds.center = (bounds.min + bounds.max) * 0.5f;
+		//Tighter than half the box diagonal for rounded meshes
+		float radiusSquared = 0.0f;
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			glm::vec3 offset = vertices[i].pos - bounds.center;
+			radiusSquared = glm::max(radiusSquared, glm::dot(offset, offset));
+		}
+		bounds.radius = sqrtf(radiusSquared);
+		return bounds;
+	}
+	Bounds mergeBounds(const Bounds& a, const Bounds& b)
+	{
+		Bounds bounds;
+		bounds.min = glm::min(a.min, b.min);
+		bounds.max = glm::max(a.max, b.max);
+		glm::vec3 offset = b.center - a.center;
+		float distance = glm::length(offset);
+		if (distance + b.radius <= a.radius) {
+			bounds.center = a.center;
+			bounds.radius = a.radius;
+		}
+		else if (distance + a.radius <= b.radius) {
+			bounds.center = b.center;
+			bounds.radius = b.radius;
+		}
+		else {
+			bounds.radius = (distance + a.radius + b.radius) * 0.5f;
+			bounds.center = a.center + offset * ((bounds.radius - a.radius) / distance);
+		}
+		return bounds;
+	}
+
+	/// <summary>
+	/// Finds the object space bounds that unorm16 positions are quantized into
+	/// </summary>
+	PositionQuantization computePositionQuantization(const Vertex* vertices, size_t numVertices)
+	{
+		PositionQuantization quantization;
+		if (numVertices == 0) {
+			return quantization;
+		}
+		glm::vec3 minPos = vertices[0].pos;
+		glm::vec3 maxPos = vertices[0].pos;
+		for (size_t i = 1; i < numVertices; i++)
+		{
+			minPos = glm::min(minPos, vertices[i].pos);
+			maxPos = glm::max(maxPos, vertices[i].pos);
+		}
+		quantization.offset = minPos;
+		quantization.scale = maxPos - minPos;
+		//Flat axes (e.g. a plane's Y) still need a non-zero scale
+		for (int i = 0; i < 3; i++)
+		{
+			if (quantization.scale[i] <= 0.0f) {
+				quantization.scale[i] = 1.0f;
+			}
+		}
+		return quantization;
+	}
+	PackedVertex packVertex(const Vertex& vertex, const PositionQuantization& quantization)
+	{
+		PackedVertex packed;
+		glm::vec3 normalizedPos = glm::clamp((vertex.pos - quantization.offset) / quantization.scale, 0.0f, 1.0f);
+		for (int i = 0; i < 3; i++)
+		{
+			packed.pos[i] = (uint16_t)(normalizedPos[i] * 65535.0f + 0.5f);
+		}
+		packed.pos[3] = 0;
+		packed.normal = glm::packSnorm3x10_1x2(glm::vec4(vertex.normal, 0.0f));
+		packed.uv[0] = glm::packHalf1x16(vertex.uv.x);
+		packed.uv[1] = glm::packHalf1x16(vertex.uv.y);
+		return packed;
+	}
+	Vertex unpackVertex(const PackedVertex& packed, const PositionQuantization& quantization)
+	{
+		Vertex vertex;
+		glm::vec3 normalizedPos = glm::vec3(packed.pos[0], packed.pos[1], packed.pos[2]) / 65535.0f;
+		vertex.pos = quantization.offset + normalizedPos * quantization.scale;
+		vertex.normal = glm::vec3(glm::unpackSnorm3x10_1x2(packed.normal));
+		vertex.uv = glm::vec2(glm::unpackHalf1x16(packed.uv[0]), glm::unpackHalf1x16(packed.uv[1]));
+		return vertex;
+	}
+
+	Mesh::Mesh(const MeshData& meshData, VertexFormat format)
+	{
+		load(meshData, format);
+	}
+	Mesh::Mesh(const MeshData& meshData, jameslib::GeometryArena* arena)
+	{
+		load(meshData, arena);
+	}
+	Mesh::Mesh(Mesh&& other) noexcept
+	{
+		*this = std::move(other);
+	}
+	Mesh& Mesh::operator=(Mesh&& other) noexcept
+	{
+		if (this != &other) {
+			std::swap(m_initialized, other.m_initialized);
+			std::swap(m_vao, other.m_vao);
+			std::swap(m_vbo, other.m_vbo);
+			std::swap(m_ebo, other.m_ebo);
+			std::swap(m_arena, other.m_arena);
+			std::swap(m_baseVertex, other.m_baseVertex);
+			std::swap(m_firstIndex, other.m_firstIndex);
+			std::swap(m_numVertices, other.m_numVertices);
+			std::swap(m_numIndices, other.m_numIndices);
+			std::swap(m_format, other.m_format);
+			std::swap(m_quantization, other.m_quantization);
+			std::swap(m_bounds, other.m_bounds);
+		}
+		return *this;
+	}
+	Mesh::~Mesh()
+	{
+		release();
+	}
+	void Mesh::release()
+	{
+		if (m_initialized) {
+			glDeleteVertexArrays(1, &m_vao);
+			glDeleteBuffers(1, &m_vbo);
+			glDeleteBuffers(1, &m_ebo);
+			m_initialized = false;
+		}
+		if (m_arena) {
+			jameslib::ArenaMesh range;
+			range.baseVertex = m_baseVertex;
+			range.numVertices = m_numVertices;
+			range.firstIndex = m_firstIndex;
+			range.numIndices = m_numIndices;
+			m_arena->free(range);
+			m_arena = nullptr;
+		}
+		m_vao = m_vbo = m_ebo = 0;
+		m_baseVertex = m_firstIndex = 0;
+	}
+	void Mesh::load(const MeshData& meshData, VertexFormat format)
+	{
+		load(meshData.vertices.data(), meshData.vertices.size(), meshData.indices.data(), meshData.indices.size(), format);
+	}
+	void Mesh::load(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, VertexFormat format)
+	{
+		if (m_arena) {
+			release();
+		}
+		m_format = format;
+		m_bounds = computeBounds(vertices, numVertices);
+		if (format == VertexFormat::PACKED) {
+			m_quantization = computePositionQuantization(vertices, numVertices);
+			std::vector<PackedVertex> packedVertices(numVertices);
+			for (size_t i = 0; i < numVertices; i++)
+			{
+				packedVertices[i] = packVertex(vertices[i], m_quantization);
+			}
+			loadBuffers(packedVertices.data(), numVertices, indices, numIndices);
+		}
+		else {
+			m_quantization = PositionQuantization();
+			loadBuffers(vertices, numVertices, indices, numIndices);
+		}
 	}
-	void Mesh::load(const MeshData& meshData)
+	void Mesh::load(const MeshData& meshData, jameslib::GeometryArena* arena)
+	{
+		load(meshData.vertices.data(), meshData.vertices.size(), meshData.indices.data(), meshData.indices.size(), arena);
+	}
+	void Mesh::load(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, jameslib::GeometryArena* arena)
+	{
+		release();
+		jameslib::ArenaMesh range;
+		if (!arena->allocate(vertices, numVertices, indices, numIndices, &range)) {
+			load(vertices, numVertices, indices, numIndices, VertexFormat::FULL);
+			return;
+		}
+		m_arena = arena;
+		m_vao = arena->getVAO();
+		m_baseVertex = range.baseVertex;
+		m_firstIndex = range.firstIndex;
+		m_numVertices = range.numVertices;
+		m_numIndices = range.numIndices;
+		m_format = VertexFormat::FULL;
+		m_quantization = PositionQuantization();
+		m_bounds = computeBounds(vertices, numVertices);
+	}
+	void Mesh::loadBuffers(const void* vertexData, size_t numVertices, const unsigned int* indices, size_t numIndices)
 	{
 		if (!m_initialized) {
 			glGenVertexArrays(1, &m_vao);
+			glGenBuffers(1, &m_vbo);
+			glGenBuffers(1, &m_ebo);
+			m_initialized = true;
+
+			//Instance stream layout. Left disabled until drawInstanced attaches a buffer.
 			glBindVertexArray(m_vao);
+			for (unsigned int i = 0; i < 4; i++)
+			{
+				glVertexAttribFormat(VERTEX_ATTRIB_MODEL + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * i);
+				glVertexAttribBinding(VERTEX_ATTRIB_MODEL + i, VERTEX_BINDING_INSTANCES);
+			}
+			glVertexBindingDivisor(VERTEX_BINDING_INSTANCES, 1);
+		}
 
-			glGenBuffers(1, &m_vbo);
-			glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBindVertexArray(m_vao);
+		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
 
-			glGenBuffers(1, &m_ebo);
-			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
+		if (m_format == VertexFormat::PACKED) {
+			//Position attribute, normalized to 0-1 and dequantized in the vertex shader
+			glVertexAttribPointer(0, 3, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, pos));
+			//Normal attribute
+			glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, normal));
+			//UV attribute
+			glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE, sizeof(PackedVertex), (const void*)offsetof(PackedVertex, uv));
+		}
+		else {
 			//Position attribute
 			glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, pos));
-			glEnableVertexAttribArray(0);
-
 			//Normal attribute
 			glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)offsetof(Vertex, normal));
-			glEnableVertexAttribArray(1);
-
 			//UV attribute
 			glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (const void*)(offsetof(Vertex, uv)));
-			glEnableVertexAttribArray(2);
-
-			m_initialized = true;
 		}
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
 
-		glBindVertexArray(m_vao);
-		glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ebo);
-
-		if (meshData.vertices.size() > 0) {
-			glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * meshData.vertices.size(), meshData.vertices.data(), GL_STATIC_DRAW);
+		size_t vertexSize = m_format == VertexFormat::PACKED ? sizeof(PackedVertex) : sizeof(Vertex);
+		if (numVertices > 0) {
+			glBufferData(GL_ARRAY_BUFFER, vertexSize * numVertices, vertexData, GL_STATIC_DRAW);
 		}
-		if (meshData.indices.size() > 0) {
-			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * meshData.indices.size(), meshData.indices.data(), GL_STATIC_DRAW);
+		if (numIndices > 0) {
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * numIndices, indices, GL_STATIC_DRAW);
 		}
-		m_numVertices = meshData.vertices.size();
-		m_numIndices = meshData.indices.size();
+		m_numVertices = numVertices;
+		m_numIndices = numIndices;
 
 		glBindVertexArray(0);
 		glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -58,13 +280,41 @@ namespace ew {
 	}
 	void Mesh::draw(ew::DrawMode drawMode) const
 	{
+		//Dequantization transform is passed as constant generic attributes so no shader uniforms are needed
+		glVertexAttrib3f(VERTEX_ATTRIB_POS_OFFSET, m_quantization.offset.x, m_quantization.offset.y, m_quantization.offset.z);
+		glVertexAttrib3f(VERTEX_ATTRIB_POS_SCALE, m_quantization.scale.x, m_quantization.scale.y, m_quantization.scale.z);
 		glBindVertexArray(m_vao);
 		if (drawMode == DrawMode::TRIANGLES) {
-			glDrawElements(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, NULL);
+			glDrawElementsBaseVertex(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, (const void*)(sizeof(unsigned int) * m_firstIndex), m_baseVertex);
 		}
 		else {
-			glDrawArrays(GL_POINTS, 0, m_numVertices);
+			glDrawArrays(GL_POINTS, m_baseVertex, m_numVertices);
+		}
+
+	}
+	void Mesh::drawInstanced(unsigned int instanceBuffer, int instanceCount, int firstInstance, DrawMode drawMode) const
+	{
+		if (instanceCount <= 0) {
+			return;
+		}
+		glVertexAttrib3f(VERTEX_ATTRIB_POS_OFFSET, m_quantization.offset.x, m_quantization.offset.y, m_quantization.offset.z);
+		glVertexAttrib3f(VERTEX_ATTRIB_POS_SCALE, m_quantization.scale.x, m_quantization.scale.y, m_quantization.scale.z);
+		glBindVertexArray(m_vao);
+		glBindVertexBuffer(VERTEX_BINDING_INSTANCES, instanceBuffer, sizeof(glm::mat4) * firstInstance, sizeof(glm::mat4));
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			glEnableVertexAttribArray(VERTEX_ATTRIB_MODEL + i);
+		}
+		if (drawMode == DrawMode::TRIANGLES) {
+			glDrawElementsInstancedBaseVertex(GL_TRIANGLES, m_numIndices, GL_UNSIGNED_INT, (const void*)(sizeof(unsigned int) * m_firstIndex), instanceCount, m_baseVertex);
+		}
+		else {
+			glDrawArraysInstanced(GL_POINTS, m_baseVertex, m_numVertices, instanceCount);
+		}
+		//Back to the constant _Model for ordinary draws
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			glDisableVertexAttribArray(VERTEX_ATTRIB_MODEL + i);
 		}
-		
 	}
 }
\ No newline at end of file
@@ -4,8 +4,13 @@
 
 #pragma once
 #include <glm/glm.hpp>
+#include <stdint.h>
 #include <vector>
 
+namespace jameslib {
+	class GeometryArena;
+}
+
 namespace ew {
 	struct Vertex {
 		glm::vec3 pos;
@@ -18,6 +23,55 @@ namespace ew {
 		std::vector<unsigned int> indices;
 	};
 
+	//Object space bounding volumes. The sphere is centered on the box and encloses every vertex.
+	struct Bounds {
+		glm::vec3 min = glm::vec3(0.0f);
+		glm::vec3 max = glm::vec3(0.0f);
+		glm::vec3 center = glm::vec3(0.0f);
+		float radius = 0.0f;
+	};
+
+	Bounds computeBounds(const Vertex* vertices, size_t numVertices);
+	//Smallest box and sphere containing both a and b
+	Bounds mergeBounds(const Bounds& a, const Bounds& b);
+
+	enum class VertexFormat {
+		FULL = 0, //32 bytes, all floats
+		PACKED = 1 //16 bytes, see PackedVertex
+	};
+
+	//Compressed vertex. Positions are unorm16 inside the mesh bounds, normals are
+	//snorm 10-10-10-2 and UVs are half floats. All of it is decoded by the vertex fetch hardware.
+	struct PackedVertex {
+		uint16_t pos[4]; //xyz + padding
+		uint32_t normal;
+		uint16_t uv[2];
+	};
+
+	//Maps unorm16 positions back to object space: pos = offset + packed * scale
+	struct PositionQuantization {
+		glm::vec3 offset = glm::vec3(0.0f);
+		glm::vec3 scale = glm::vec3(1.0f);
+	};
+
+	//Generic attribute locations holding the current mesh's PositionQuantization
+	const unsigned int VERTEX_ATTRIB_POS_OFFSET = 7;
+	const unsigned int VERTEX_ATTRIB_POS_SCALE = 8;
+
+	//Model matrix, one vec4 column per location (3-6). Meshes only enable these arrays inside
+	//drawInstanced, so ordinary draws read the constant value set by setModelMatrix.
+	const unsigned int VERTEX_ATTRIB_MODEL = 3;
+	//Vertex buffer binding the instance stream is attached to. glVertexAttribPointer implicitly
+	//uses bindings 0-2 for the per-vertex attributes.
+	const unsigned int VERTEX_BINDING_INSTANCES = 3;
+
+	//Sets _Model for following non-instanced draws
+	void setModelMatrix(const glm::mat4& model);
+
+	PositionQuantization computePositionQuantization(const Vertex* vertices, size_t numVertices);
+	PackedVertex packVertex(const Vertex& vertex, const PositionQuantization& quantization);
+	Vertex unpackVertex(const PackedVertex& vertex, const PositionQuantization& quantization);
+
 	enum class DrawMode {
 		TRIANGLES = 0,
 		POINTS = 1
@@ -26,17 +80,52 @@ namespace ew {
 	class Mesh {
 	public:
 		Mesh() {};
-		Mesh(const MeshData& meshData);
-		void load(const MeshData& meshData);
+		Mesh(const MeshData& meshData, VertexFormat format = VertexFormat::FULL);
+		Mesh(const MeshData& meshData, jameslib::GeometryArena* arena);
+		//Owns its GL buffers or arena range, so meshes can be moved but not copied
+		Mesh(const Mesh&) = delete;
+		Mesh& operator=(const Mesh&) = delete;
+		Mesh(Mesh&& other) noexcept;
+		Mesh& operator=(Mesh&& other) noexcept;
+		~Mesh();
+		void load(const MeshData& meshData, VertexFormat format = VertexFormat::FULL);
+		//Uploads straight from caller owned memory, e.g. a memory mapped mesh cache
+		void load(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, VertexFormat format = VertexFormat::FULL);
+		//Sub-allocates from a shared arena instead of creating buffers. Always VertexFormat::FULL.
+		//The arena must outlive the mesh. Falls back to owned buffers if the arena is full.
+		void load(const MeshData& meshData, jameslib::GeometryArena* arena);
+		void load(const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, jameslib::GeometryArena* arena);
 		void draw(DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//Draws instanceCount copies, reading one tightly packed glm::mat4 per instance from instanceBuffer
+		//starting at firstInstance. Any buffer works, including one also bound as an SSBO.
+		void drawInstanced(unsigned int instanceBuffer, int instanceCount, int firstInstance = 0, DrawMode drawMode = DrawMode::TRIANGLES)const;
+		//The arena's VAO for arena backed meshes
+		inline unsigned int getVAO()const { return m_vao; }
+		//Null unless the mesh lives in a GeometryArena
+		inline jameslib::GeometryArena* getArena()const { return m_arena; }
+		//Offsets into the VAO's buffers, 0 for meshes that own their buffers
+		inline unsigned int getBaseVertex()const { return m_baseVertex; }
+		inline unsigned int getFirstIndex()const { return m_firstIndex; }
 		inline int getNumVertices()const { return m_numVertices; }
 		inline int getNumIndices()const { return m_numIndices; }
+		inline VertexFormat getVertexFormat()const { return m_format; }
+		inline const PositionQuantization& getPositionQuantization()const { return m_quantization; }
+		inline const Bounds& getBounds()const { return m_bounds; }
 	private:
+		void loadBuffers(const void* vertexData, size_t numVertices, const unsigned int* indices, size_t numIndices);
+		void release();
+
 		bool m_initialized = false;
 		unsigned int m_vao = 0;
 		unsigned int m_vbo = 0;
 		unsigned int m_ebo = 0;
+		jameslib::GeometryArena* m_arena = nullptr;
+		unsigned int m_baseVertex = 0;
+		unsigned int m_firstIndex = 0;
 		unsigned int m_numVertices = 0;
 		unsigned int m_numIndices = 0;
+		VertexFormat m_format = VertexFormat::FULL;
+		PositionQuantization m_quantization;
+		Bounds m_bounds;
 	};
 }
\ No newline at end of file
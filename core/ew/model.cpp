@@ -3,62 +3,195 @@
 */
 
 #include "model.h"
+#include "../jameslib/meshCache.h"
 #include <assimp/Importer.hpp>
 #include <assimp/postprocess.h>
 
 #include <assimp/scene.h>
 #include <glm/glm.hpp>
+#include <stdio.h>
 
 namespace ew {
-	ew::Mesh processAiMesh(aiMesh* aiMesh);
+	void processAiMesh(const aiMesh* aiMesh, ew::MeshData* meshData);
 
-	Model::Model(const std::string& filePath)
+	/// <summary>
+	/// Reads a model file with Assimp and converts each mesh to MeshData. Does not touch GL.
+	/// </summary>
+	/// <param name="filePath">Model file to import</param>
+	/// <param name="meshes">Receives one MeshData per mesh in the file</param>
+	/// <returns>False if the file could not be imported</returns>
+	bool loadModelData(const std::string& filePath, std::vector<MeshData>* meshes)
 	{
 		Assimp::Importer importer;
 		const aiScene* aiScene = importer.ReadFile(filePath, aiProcess_Triangulate);
+		if (aiScene == NULL) {
+			printf("Failed to load model %s: %s\n", filePath.c_str(), importer.GetErrorString());
+			return false;
+		}
+		size_t firstMesh = meshes->size();
+		meshes->resize(firstMesh + aiScene->mNumMeshes);
 		for (size_t i = 0; i < aiScene->mNumMeshes; i++)
 		{
-			aiMesh* aiMesh = aiScene->mMeshes[i];
-			m_meshes.push_back(processAiMesh(aiMesh));
+			processAiMesh(aiScene->mMeshes[i], &(*meshes)[firstMesh + i]);
+		}
+		return true;
+	}
+
+	/// <summary>
+	/// Loads a model, preferring a baked .ewmesh cache next to the file and falling back to Assimp.
+	/// </summary>
+	Model::Model(const std::string& filePath)
+	{
+		jameslib::MeshCache cache;
+		if (jameslib::openMeshCache(jameslib::getMeshCachePath(filePath), filePath, &cache)) {
+			load(cache);
+			jameslib::closeMeshCache(&cache);
+			return;
 		}
+		std::vector<MeshData> meshes;
+		if (loadModelData(filePath, &meshes)) {
+			load(meshes);
+		}
+	}
+
+	/// <summary>
+	/// Uploads already imported mesh data. Must be called on the thread that owns the GL context.
+	/// </summary>
+	void Model::load(const std::vector<MeshData>& meshes)
+	{
+		m_lods.clear();
+		addLod(meshes);
+		updateBounds();
 	}
 
-	void Model::draw()
+	/// <summary>
+	/// Uploads a simplified version of the model. Must be called after LOD 0 is loaded.
+	/// </summary>
+	void Model::addLod(const std::vector<MeshData>& meshes)
 	{
-		for (size_t i = 0; i < m_meshes.size(); i++)
+		m_lods.emplace_back(meshes.size());
+		std::vector<ew::Mesh>& lod = m_lods.back();
+		for (size_t i = 0; i < meshes.size(); i++)
 		{
-			m_meshes[i].draw();
+			loadMesh(&lod[i], meshes[i].vertices.data(), meshes[i].vertices.size(), meshes[i].indices.data(), meshes[i].indices.size());
 		}
 	}
 
-	glm::vec3 convertAIVec3(const aiVector3D& v) {
-		return glm::vec3(v.x, v.y, v.z);
+	/// <summary>
+	/// Uploads each submesh of each baked detail level directly from a mapped mesh cache without an intermediate copy.
+	/// </summary>
+	void Model::load(const jameslib::MeshCache& cache, int maxLods)
+	{
+		uint32_t numLods = cache.header->numLods;
+		if (maxLods > 0 && (uint32_t)maxLods < numLods) {
+			numLods = maxLods;
+		}
+		m_lods.clear();
+		for (uint32_t lod = 0; lod < numLods; lod++)
+		{
+			m_lods.emplace_back(cache.header->numSubmeshes);
+			std::vector<ew::Mesh>& meshes = m_lods.back();
+			const jameslib::MeshCacheSubmesh* submeshes = cache.getLodSubmeshes(lod);
+			for (size_t i = 0; i < cache.header->numSubmeshes; i++)
+			{
+				const jameslib::MeshCacheSubmesh& submesh = submeshes[i];
+				loadMesh(&meshes[i], cache.vertices + submesh.firstVertex, submesh.numVertices, cache.indices + submesh.firstIndex, submesh.numIndices);
+			}
+		}
+		updateBounds();
+	}
+
+	void Model::loadMesh(ew::Mesh* mesh, const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices)
+	{
+		if (m_arena) {
+			mesh->load(vertices, numVertices, indices, numIndices, m_arena);
+		}
+		else {
+			mesh->load(vertices, numVertices, indices, numIndices);
+		}
+	}
+
+	void Model::updateBounds()
+	{
+		m_bounds = Bounds();
+		const std::vector<ew::Mesh>& meshes = m_lods[0];
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			m_bounds = i == 0 ? meshes[i].getBounds() : mergeBounds(m_bounds, meshes[i].getBounds());
+		}
+	}
+
+	void Model::draw(int lod)
+	{
+		if (m_lods.empty()) {
+			return;
+		}
+		std::vector<ew::Mesh>& meshes = m_lods[glm::clamp(lod, 0, (int)m_lods.size() - 1)];
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			meshes[i].draw();
+		}
+	}
+
+	const std::vector<ew::Mesh>& Model::getMeshes(int lod) const
+	{
+		return m_lods[glm::clamp(lod, 0, (int)m_lods.size() - 1)];
+	}
+
+	void Model::drawInstanced(unsigned int instanceBuffer, int instanceCount, int lod, int firstInstance)
+	{
+		if (m_lods.empty()) {
+			return;
+		}
+		std::vector<ew::Mesh>& meshes = m_lods[glm::clamp(lod, 0, (int)m_lods.size() - 1)];
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			meshes[i].drawInstanced(instanceBuffer, instanceCount, firstInstance);
+		}
 	}
 
 	//Utility functions local to this file
-	ew::Mesh processAiMesh(aiMesh* aiMesh) {
-		ew::MeshData meshData;
-		for (size_t i = 0; i < aiMesh->mNumVertices; i++)
+	/// <summary>
+	/// Converts an Assimp mesh into meshData, which is sized once up front so nothing reallocates.
+	/// Each attribute is copied in its own tight loop over the source aiVector3D array.
+	/// </summary>
+	void processAiMesh(const aiMesh* aiMesh, ew::MeshData* meshData) {
+		size_t numVertices = aiMesh->mNumVertices;
+		meshData->vertices.resize(numVertices);
+		ew::Vertex* vertices = meshData->vertices.data();
+
+		const aiVector3D* positions = aiMesh->mVertices;
+		for (size_t i = 0; i < numVertices; i++)
 		{
-			ew::Vertex vertex;
-			vertex.pos = convertAIVec3(aiMesh->mVertices[i]);
-			if (aiMesh->HasNormals()) {
-				vertex.normal = convertAIVec3(aiMesh->mNormals[i]);
-			}
-			if (aiMesh->HasTextureCoords(0)) {
-				vertex.uv = glm::vec2(convertAIVec3(aiMesh->mTextureCoords[0][i]));
-			}
-			meshData.vertices.push_back(vertex);
+			vertices[i].pos = glm::vec3(positions[i].x, positions[i].y, positions[i].z);
+		}
+		const aiVector3D* normals = aiMesh->HasNormals() ? aiMesh->mNormals : NULL;
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			vertices[i].normal = normals ? glm::vec3(normals[i].x, normals[i].y, normals[i].z) : glm::vec3(0.0f);
 		}
+		const aiVector3D* uvs = aiMesh->HasTextureCoords(0) ? aiMesh->mTextureCoords[0] : NULL;
+		for (size_t i = 0; i < numVertices; i++)
+		{
+			vertices[i].uv = uvs ? glm::vec2(uvs[i].x, uvs[i].y) : glm::vec2(0.0f);
+		}
+
 		//Convert faces to indices
+		size_t numIndices = 0;
+		for (size_t i = 0; i < aiMesh->mNumFaces; i++)
+		{
+			numIndices += aiMesh->mFaces[i].mNumIndices;
+		}
+		meshData->indices.resize(numIndices);
+		unsigned int* indices = meshData->indices.data();
 		for (size_t i = 0; i < aiMesh->mNumFaces; i++)
 		{
-			for (size_t j = 0; j < aiMesh->mFaces[i].mNumIndices; j++)
+			const aiFace& face = aiMesh->mFaces[i];
+			for (size_t j = 0; j < face.mNumIndices; j++)
 			{
-				meshData.indices.push_back(aiMesh->mFaces[i].mIndices[j]);
+				*indices++ = face.mIndices[j];
 			}
 		}
-		return ew::Mesh(meshData);
 	}
 
 }
@@ -7,12 +7,46 @@
 #include "shader.h"
 #include <vector>
 
+namespace jameslib {
+	struct MeshCache;
+	class GeometryArena;
+}
+
 namespace ew {
+	//Imports every mesh in a file on the CPU only. Safe to call from any thread.
+	bool loadModelData(const std::string& filePath, std::vector<MeshData>* meshes);
+
 	class Model {
 	public:
+		Model() {};
 		Model(const std::string& filePath);
-		void draw();
+		//Meshes loaded after this sub-allocate from arena so the model can draw through a DrawBatch.
+		//The arena must outlive the model.
+		inline void setGeometryArena(jameslib::GeometryArena* arena) { m_arena = arena; }
+		inline jameslib::GeometryArena* getGeometryArena()const { return m_arena; }
+		//Replaces every LOD with meshes as LOD 0
+		void load(const std::vector<MeshData>& meshes);
+		//Loads up to maxLods of the cache's baked detail levels, all of them if negative
+		void load(const jameslib::MeshCache& cache, int maxLods = -1);
+		//Appends a coarser detail level with one mesh per submesh of LOD 0
+		void addLod(const std::vector<MeshData>& meshes);
+		//lod is clamped to the available levels
+		void draw(int lod = 0);
+		//One instanced draw per submesh, see Mesh::drawInstanced
+		void drawInstanced(unsigned int instanceBuffer, int instanceCount, int lod = 0, int firstInstance = 0);
+		inline bool isLoaded()const { return !m_lods.empty(); }
+		inline int getNumLods()const { return (int)m_lods.size(); }
+		//Submeshes of one detail level, clamped like draw
+		const std::vector<ew::Mesh>& getMeshes(int lod = 0)const;
+		//Object space bounds of every submesh in LOD 0
+		inline const Bounds& getBounds()const { return m_bounds; }
 	private:
-		std::vector<ew::Mesh> m_meshes;
+		void updateBounds();
+
+		void loadMesh(ew::Mesh* mesh, const Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices);
+
+		std::vector<std::vector<ew::Mesh>> m_lods;
+		Bounds m_bounds;
+		jameslib::GeometryArena* m_arena = nullptr;
 	};
-}
\ No newline at end of file
+}
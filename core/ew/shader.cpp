@@ -5,25 +5,93 @@
 #include "shader.h"
 #include <fstream>
 #include <sstream>
+#include <algorithm>
+#include <string.h>
 #include "external/glad.h"
+#include "../jameslib/shaderCache.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
 namespace ew {
 	/// <summary>
-	/// Loads shader source code from a file.
+	/// Reads one file and expands its #include lines in place. Files already in included expand to nothing, which also stops cycles.
 	/// </summary>
 	/// <param name="filePath"></param>
+	/// <param name="included">Every file read so far</param>
 	/// <returns></returns>
-	std::string loadShaderSourceFromFile(const std::string& filePath) {
+	static std::string loadShaderSourceWithIncludes(const std::string& filePath, std::vector<std::string>* included) {
+		if (std::find(included->begin(), included->end(), filePath) != included->end()) {
+			return {};
+		}
+		included->push_back(filePath);
 		std::ifstream fstream(filePath);
 		if (!fstream.is_open()) {
 			printf("Failed to load file %s", filePath.c_str());
 			return {};
 		}
-		std::stringstream buffer;
-		buffer << fstream.rdbuf();
-		return buffer.str();
+		size_t slash = filePath.find_last_of("/\\");
+		std::string directory = slash == std::string::npos ? std::string() : filePath.substr(0, slash + 1);
+		std::string source;
+		std::string line;
+		while (std::getline(fstream, line)) {
+			size_t start = line.find_first_not_of(" \t");
+			if (start != std::string::npos && line.compare(start, 8, "#include") == 0) {
+				size_t open = line.find('"', start + 8);
+				size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+				if (close == std::string::npos) {
+					printf("Malformed #include in %s: %s\n", filePath.c_str(), line.c_str());
+					continue;
+				}
+				source += loadShaderSourceWithIncludes(directory + line.substr(open + 1, close - open - 1), included);
+				continue;
+			}
+			source += line;
+			source += '\n';
+		}
+		return source;
+	}
+
+	/// <summary>
+	/// Loads shader source code from a file, resolving #include "file" relative to the including file.
+	/// </summary>
+	/// <param name="filePath"></param>
+	/// <param name="dependencies">Optional. Receives filePath and every file it included.</param>
+	/// <returns></returns>
+	std::string loadShaderSourceFromFile(const std::string& filePath, std::vector<std::string>* dependencies) {
+		std::vector<std::string> included;
+		std::string source = loadShaderSourceWithIncludes(filePath, &included);
+		if (dependencies) {
+			*dependencies = included;
+		}
+		return source;
+	}
+
+	/// <summary>
+	/// Adds preprocessor defines to shader source. #version must stay the first directive, so they go on the line after it.
+	/// </summary>
+	/// <param name="source">GLSL source code</param>
+	/// <param name="defines">Define names with optional values</param>
+	/// <returns></returns>
+	std::string addShaderDefines(const std::string& source, const std::vector<std::string>& defines) {
+		if (defines.empty()) {
+			return source;
+		}
+		std::string defineLines;
+		for (size_t i = 0; i < defines.size(); i++)
+		{
+			defineLines += "#define " + defines[i] + "\n";
+		}
+		size_t versionPos = source.find("#version");
+		if (versionPos == std::string::npos) {
+			return defineLines + source;
+		}
+		size_t lineEnd = source.find('\n', versionPos);
+		if (lineEnd == std::string::npos) {
+			return source + "\n" + defineLines;
+		}
+		std::string result = source;
+		result.insert(lineEnd + 1, defineLines);
+		return result;
 	}
 
 	/// <summary>
@@ -51,19 +119,22 @@ namespace ew {
 	}
 
 	/// <summary>
-	/// Creates a shader program with a vertex and fragment shader
+	/// Compiles and links a program from any number of stages. The binary is left retrievable for the program cache.
 	/// </summary>
-	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
-	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
+	/// <param name="stageTypes">GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, etc. for each stage</param>
+	/// <param name="sources">GLSL source code for each stage</param>
+	/// <param name="numStages">Number of stages</param>
 	/// <returns></returns>
-	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
-		unsigned int vertexShader = createShader(GL_VERTEX_SHADER, vertexShaderSource);
-		unsigned int fragmentShader = createShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
-
+	static unsigned int linkProgram(const unsigned int* stageTypes, const char* const* sources, int numStages) {
 		unsigned int shaderProgram = glCreateProgram();
+		std::vector<unsigned int> shaders(numStages);
 		//Attach each stage
-		glAttachShader(shaderProgram, vertexShader);
-		glAttachShader(shaderProgram, fragmentShader);
+		for (int i = 0; i < numStages; i++)
+		{
+			shaders[i] = createShader(stageTypes[i], sources[i]);
+			glAttachShader(shaderProgram, shaders[i]);
+		}
+		glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 		//Link all the stages together
 		glLinkProgram(shaderProgram);
 		int success;
@@ -74,10 +145,33 @@ namespace ew {
 			printf("Failed to link shader program: %s", infoLog);
 		}
 		//The linked program now contains our compiled code, so we can delete these intermediate objects
-		glDeleteShader(vertexShader);
-		glDeleteShader(fragmentShader);
+		for (int i = 0; i < numStages; i++)
+		{
+			glDeleteShader(shaders[i]);
+		}
 		return shaderProgram;
 	}
+
+	/// <summary>
+	/// Creates a shader program with a vertex and fragment shader, from the program cache when it has a matching binary
+	/// </summary>
+	/// <param name="vertexShaderSource">GLSL source code for the vertex shader</param>
+	/// <param name="fragmentShaderSource">GLSL source code for the fragment shader</param>
+	/// <returns></returns>
+	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource) {
+		const unsigned int stageTypes[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+		const char* sources[2] = { vertexShaderSource, fragmentShaderSource };
+		return jameslib::createCachedProgram(stageTypes, sources, 2, linkProgram);
+	}
+	/// <summary>
+	/// Creates a shader program with a single compute stage, from the program cache when it has a matching binary. Requires GL 4.3.
+	/// </summary>
+	/// <param name="computeShaderSource">GLSL source code for the compute shader</param>
+	/// <returns></returns>
+	unsigned int createComputeProgram(const char* computeShaderSource) {
+		const unsigned int stageTypes[1] = { GL_COMPUTE_SHADER };
+		return jameslib::createCachedProgram(stageTypes, &computeShaderSource, 1, linkProgram);
+	}
 	/// <summary>
 	/// Creates a shader instance with vertex + fragment stages
 	/// </summary>
@@ -88,6 +182,118 @@ namespace ew {
 		std::string vertexShaderSource = ew::loadShaderSourceFromFile(vertexShader.c_str());
 		std::string fragmentShaderSource = ew::loadShaderSourceFromFile(fragmentShader.c_str());
 		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+		cacheUniformLocations();
+	}
+	/// <summary>
+	/// Creates a shader instance with vertex + fragment stages compiled with extra defines
+	/// </summary>
+	/// <param name="vertexShader">File path to vertex shader</param>
+	/// <param name="fragmentShader">File path to fragment shader</param>
+	/// <param name="defines">Added to both stages, see addShaderDefines</param>
+	Shader::Shader(const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines)
+	{
+		std::string vertexShaderSource = addShaderDefines(ew::loadShaderSourceFromFile(vertexShader.c_str()), defines);
+		std::string fragmentShaderSource = addShaderDefines(ew::loadShaderSourceFromFile(fragmentShader.c_str()), defines);
+		m_id = ew::createShaderProgram(vertexShaderSource.c_str(), fragmentShaderSource.c_str());
+		cacheUniformLocations();
+	}
+	/// <summary>
+	/// Creates a shader instance with a compute stage
+	/// </summary>
+	/// <param name="computeShader">File path to compute shader</param>
+	Shader::Shader(const std::string& computeShader)
+	{
+		std::string computeShaderSource = ew::loadShaderSourceFromFile(computeShader.c_str());
+		m_id = ew::createComputeProgram(computeShaderSource.c_str());
+		cacheUniformLocations();
+	}
+	/// <summary>
+	/// Wraps a program that was linked elsewhere
+	/// </summary>
+	/// <param name="program">Linked shader program handle</param>
+	Shader::Shader(unsigned int program)
+	{
+		m_id = program;
+		cacheUniformLocations();
+	}
+	/// <summary>
+	/// Replaces the program between frames, e.g. after a hot reload. The program id and uniform cache change together.
+	/// </summary>
+	/// <param name="program">Linked shader program handle</param>
+	void Shader::setProgram(unsigned int program)
+	{
+		m_id = program;
+		cacheUniformLocations();
+	}
+	/// <summary>
+	/// Queries every active uniform once after linking so setters never round trip to the driver.
+	/// Array uniforms are stored as "name", "name[0]" and every "name[i]".
+	/// </summary>
+	void Shader::cacheUniformLocations()
+	{
+		m_uniforms.clear();
+		int numUniforms = 0;
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORMS, &numUniforms);
+		int maxNameLength = 0;
+		glGetProgramiv(m_id, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+		std::vector<char> nameBuffer(maxNameLength + 1);
+		m_uniforms.reserve(numUniforms);
+		for (int i = 0; i < numUniforms; i++)
+		{
+			int size = 0;
+			GLenum type;
+			glGetActiveUniform(m_id, i, (GLsizei)nameBuffer.size(), NULL, &size, &type, nameBuffer.data());
+			int location = glGetUniformLocation(m_id, nameBuffer.data());
+			//Uniform block members have no location
+			if (location < 0) {
+				continue;
+			}
+			std::string name = nameBuffer.data();
+			if (size > 1 && name.size() > 3 && name.compare(name.size() - 3, 3, "[0]") == 0) {
+				std::string baseName = name.substr(0, name.size() - 3);
+				m_uniforms.push_back({ baseName, location });
+				//Every element by index too, so "name[3]" resolves like it did through glGetUniformLocation
+				for (int element = 1; element < size; element++)
+				{
+					std::string elementName = baseName + "[" + std::to_string(element) + "]";
+					m_uniforms.push_back({ elementName, glGetUniformLocation(m_id, elementName.c_str()) });
+				}
+			}
+			m_uniforms.push_back({ name, location });
+		}
+		std::sort(m_uniforms.begin(), m_uniforms.end(), [](const UniformEntry& a, const UniformEntry& b) {
+			return a.name < b.name;
+		});
+	}
+	/// <summary>
+	/// Looks up a uniform location in the cache built at link time.
+	/// </summary>
+	/// <param name="name">Uniform name as written in GLSL</param>
+	/// <returns>Location, or -1 if the uniform is not active. glUniform* silently ignores -1.</returns>
+	int Shader::getUniformLocation(const char* name) const
+	{
+		size_t lo = 0;
+		size_t hi = m_uniforms.size();
+		while (lo < hi) {
+			size_t mid = (lo + hi) / 2;
+			int cmp = strcmp(m_uniforms[mid].name.c_str(), name);
+			if (cmp == 0) {
+				return m_uniforms[mid].location;
+			}
+			if (cmp < 0) {
+				lo = mid + 1;
+			}
+			else {
+				hi = mid;
+			}
+		}
+		return -1;
+	}
+	UniformHandle Shader::getUniformHandle(const std::string& name) const
+	{
+		UniformHandle handle;
+		handle.location = getUniformLocation(name.c_str());
+		return handle;
 	}
 	void Shader::use()const
 	{
@@ -95,15 +301,15 @@ namespace ew {
 	}
 	void Shader::setInt(const std::string& name, int v) const
 	{
-		glUniform1i(glGetUniformLocation(m_id, name.c_str()), v);
+		glUniform1i(getUniformLocation(name.c_str()), v);
 	}
 	void Shader::setFloat(const std::string& name, float v) const
 	{
-		glUniform1f(glGetUniformLocation(m_id, name.c_str()), v);
+		glUniform1f(getUniformLocation(name.c_str()), v);
 	}
 	void Shader::setVec2(const std::string& name, float x, float y) const
 	{
-		glUniform2f(glGetUniformLocation(m_id, name.c_str()), x, y);
+		glUniform2f(getUniformLocation(name.c_str()), x, y);
 	}
 	void Shader::setVec2(const std::string& name, const glm::vec2& v) const
 	{
@@ -111,7 +317,7 @@ namespace ew {
 	}
 	void Shader::setVec3(const std::string& name, float x, float y, float z) const
 	{
-		glUniform3f(glGetUniformLocation(m_id, name.c_str()), x, y, z);
+		glUniform3f(getUniformLocation(name.c_str()), x, y, z);
 	}
 	void Shader::setVec3(const std::string& name, const glm::vec3& v) const
 	{
@@ -119,7 +325,7 @@ namespace ew {
 	}
 	void Shader::setVec4(const std::string& name, float x, float y, float z, float w) const
 	{
-		glUniform4f(glGetUniformLocation(m_id, name.c_str()), x, y, z, w);
+		glUniform4f(getUniformLocation(name.c_str()), x, y, z, w);
 	}
 	void Shader::setVec4(const std::string& name, const glm::vec4& v) const
 	{
@@ -127,7 +333,31 @@ namespace ew {
 	}
 	void Shader::setMat4(const std::string& name, const glm::mat4& m) const
 	{
-		glUniformMatrix4fv(glGetUniformLocation(m_id, name.c_str()), 1, GL_FALSE, glm::value_ptr(m));
+		glUniformMatrix4fv(getUniformLocation(name.c_str()), 1, GL_FALSE, glm::value_ptr(m));
+	}
+	void Shader::setInt(UniformHandle handle, int v) const
+	{
+		glUniform1i(handle.location, v);
+	}
+	void Shader::setFloat(UniformHandle handle, float v) const
+	{
+		glUniform1f(handle.location, v);
+	}
+	void Shader::setVec2(UniformHandle handle, const glm::vec2& v) const
+	{
+		glUniform2f(handle.location, v.x, v.y);
+	}
+	void Shader::setVec3(UniformHandle handle, const glm::vec3& v) const
+	{
+		glUniform3f(handle.location, v.x, v.y, v.z);
+	}
+	void Shader::setVec4(UniformHandle handle, const glm::vec4& v) const
+	{
+		glUniform4f(handle.location, v.x, v.y, v.z, v.w);
+	}
+	void Shader::setMat4(UniformHandle handle, const glm::mat4& m) const
+	{
+		glUniformMatrix4fv(handle.location, 1, GL_FALSE, glm::value_ptr(m));
 	}
 }
 
@@ -4,15 +4,37 @@
 
 #pragma once
 #include <string>
+#include <vector>
 #include <glm/glm.hpp>
 
 namespace ew {
-	std::string loadShaderSourceFromFile(const std::string& filePath);
+	//Replaces #include "file" lines with the file's contents, relative to the including file. Each file is included once.
+	//dependencies receives every file read, starting with filePath.
+	std::string loadShaderSourceFromFile(const std::string& filePath, std::vector<std::string>* dependencies = nullptr);
+	//Inserts "#define <define>" lines after the #version directive, e.g. { "GBUFFER_COMPACT", "TILE_SIZE 16" }
+	std::string addShaderDefines(const std::string& source, const std::vector<std::string>& defines);
 	unsigned int createShaderProgram(const char* vertexShaderSource, const char* fragmentShaderSource);
+	unsigned int createComputeProgram(const char* computeShaderSource);
+
+	//Precomputed uniform location. Resolve once with Shader::getUniformHandle and reuse every frame.
+	struct UniformHandle {
+		int location = -1;
+		inline bool isValid()const { return location >= 0; }
+	};
+
 	class Shader {
 	public:
 		Shader(const std::string& vertexShader, const std::string& fragmentShader);
+		Shader(const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines);
+		explicit Shader(const std::string& computeShader);
+		//Wraps an already linked program, e.g. from jameslib::ShaderBatch. Shaders never delete their program, so copies share it.
+		explicit Shader(unsigned int program);
+		//Swaps in another linked program and its uniform locations together. Handles from the old program must be resolved again.
+		void setProgram(unsigned int program);
 		void use()const;
+		inline unsigned int getProgram()const { return m_id; }
+		int getUniformLocation(const char* name)const;
+		UniformHandle getUniformHandle(const std::string& name)const;
 		void setInt(const std::string& name, int v) const;
 		void setFloat(const std::string& name, float v) const;
 		void setVec2(const std::string& name, float x, float y) const;
@@ -22,7 +44,20 @@ namespace ew {
 		void setVec4(const std::string& name, float x, float y, float z, float w) const;
 		void setVec4(const std::string& name, const glm::vec4& v) const;
 		void setMat4(const std::string& name, const glm::mat4& m) const;
+		void setInt(UniformHandle handle, int v) const;
+		void setFloat(UniformHandle handle, float v) const;
+		void setVec2(UniformHandle handle, const glm::vec2& v) const;
+		void setVec3(UniformHandle handle, const glm::vec3& v) const;
+		void setVec4(UniformHandle handle, const glm::vec4& v) const;
+		void setMat4(UniformHandle handle, const glm::mat4& m) const;
 	private:
+		struct UniformEntry {
+			std::string name;
+			int location;
+		};
+		void cacheUniformLocations();
+
 		unsigned int m_id; //Shader program handle
+		std::vector<UniformEntry> m_uniforms; //Active uniforms sorted by name
 	};
-}
\ No newline at end of file
+}
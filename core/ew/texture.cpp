@@ -32,6 +32,11 @@ namespace ew {
 		}
 		unsigned int texture;
 		glGenTextures(1, &texture);
+		uploadTexture(texture, width, height, numComponents, data, wrapMode, magFilter, minFilter, mipmap);
+		stbi_image_free(data);
+		return texture;
+	}
+	void uploadTexture(unsigned int texture, int width, int height, int numComponents, const unsigned char* data, int wrapMode, int magFilter, int minFilter, bool mipmap) {
 		glBindTexture(GL_TEXTURE_2D, texture);
 		int format = getTextureFormat(numComponents);
 		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
@@ -49,8 +54,6 @@ namespace ew {
 		}
 
 		glBindTexture(GL_TEXTURE_2D, 0);
-		stbi_image_free(data);
-		return texture;
 	}
 }
 
@@ -7,4 +7,6 @@
 namespace ew {
 	unsigned int loadTexture(const char* filePath);
 	unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap);
+	//(Re)specifies an existing texture object from decoded 8-bit pixel data
+	void uploadTexture(unsigned int texture, int width, int height, int numComponents, const unsigned char* data, int wrapMode, int magFilter, int minFilter, bool mipmap);
 }
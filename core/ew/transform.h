@@ -8,17 +8,23 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace ew {
+	//Same result as translate * mat4_cast(rotation) * scale, written out directly
+	inline glm::mat4 composeTransform(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale) {
+		glm::mat3 r = glm::mat3_cast(rotation);
+		return glm::mat4(
+			glm::vec4(r[0] * scale.x, 0.0f),
+			glm::vec4(r[1] * scale.y, 0.0f),
+			glm::vec4(r[2] * scale.z, 0.0f),
+			glm::vec4(position, 1.0f));
+	}
+
 	struct Transform {
 		glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f);
 		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f,0.0f);
 		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f);
 
 		glm::mat4 modelMatrix() const {
-			glm::mat4 m = glm::mat4(1.0f);
-			m = glm::translate(m, position);
-			m *= glm::mat4_cast(rotation);
-			m = glm::scale(m, scale);
-			return m;
+			return composeTransform(position, rotation, scale);
 		}
 	};
 }
@@ -0,0 +1,190 @@
+#include "assetLoader.h"
+#include "meshOptimizer.h"
+#include "meshSimplifier.h"
+#include "../ew/texture.h"
+#include "../ew/external/glad.h"
+#include "../ew/external/stb_image.h"
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+
+jameslib::AssetLoader::AssetLoader(unsigned int numThreads)
+	: m_completed(nullptr), m_numPending(0)
+{
+	if (numThreads == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		numThreads = hardwareThreads > 1 ? hardwareThreads - 1 : 1;
+	}
+	for (unsigned int i = 0; i < numThreads; i++)
+	{
+		m_workers.emplace_back(&AssetLoader::workerLoop, this);
+	}
+}
+
+jameslib::AssetLoader::~AssetLoader()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_stopping = true;
+	}
+	m_jobCondition.notify_all();
+	for (size_t i = 0; i < m_workers.size(); i++)
+	{
+		m_workers[i].join();
+	}
+
+	//Anything not uploaded yet is dropped
+	for (size_t i = 0; i < m_jobs.size(); i++)
+	{
+		delete m_jobs[i];
+	}
+	Job* job = m_completed.exchange(nullptr);
+	while (job) {
+		Job* next = job->next;
+		m_readyToUpload.push_back(job);
+		job = next;
+	}
+	for (size_t i = 0; i < m_readyToUpload.size(); i++)
+	{
+		stbi_image_free(m_readyToUpload[i]->pixels);
+		closeMeshCache(&m_readyToUpload[i]->meshCache);
+		delete m_readyToUpload[i];
+	}
+}
+
+void jameslib::AssetLoader::loadModel(const std::string& filePath, ew::Model* model, int numLods)
+{
+	Job* job = new Job();
+	job->type = AssetType::MODEL;
+	job->filePath = filePath;
+	job->model = model;
+	job->numLods = numLods;
+	submit(job);
+}
+
+unsigned int jameslib::AssetLoader::loadTexture(const char* filePath)
+{
+	return loadTexture(filePath, GL_REPEAT, GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, true);
+}
+
+unsigned int jameslib::AssetLoader::loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap)
+{
+	//The handle is valid immediately. Uploading later re-specifies the same texture object.
+	const unsigned char white[4] = { 255, 255, 255, 255 };
+	unsigned int texture;
+	glGenTextures(1, &texture);
+	ew::uploadTexture(texture, 1, 1, 4, white, wrapMode, GL_NEAREST, GL_NEAREST, false);
+
+	Job* job = new Job();
+	job->type = AssetType::TEXTURE;
+	job->filePath = filePath;
+	job->texture = texture;
+	job->wrapMode = wrapMode;
+	job->magFilter = magFilter;
+	job->minFilter = minFilter;
+	job->mipmap = mipmap;
+	submit(job);
+	return texture;
+}
+
+void jameslib::AssetLoader::submit(Job* job)
+{
+	m_numPending++;
+	{
+		std::lock_guard<std::mutex> lock(m_jobMutex);
+		m_jobs.push_back(job);
+	}
+	m_jobCondition.notify_one();
+}
+
+void jameslib::AssetLoader::workerLoop()
+{
+	while (true) {
+		Job* job;
+		{
+			std::unique_lock<std::mutex> lock(m_jobMutex);
+			m_jobCondition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+			if (m_stopping) {
+				return;
+			}
+			job = m_jobs.front();
+			m_jobs.pop_front();
+		}
+
+		if (job->type == AssetType::MODEL) {
+			job->succeeded = openMeshCache(getMeshCachePath(job->filePath), job->filePath, &job->meshCache);
+			if (!job->succeeded && ew::loadModelData(job->filePath, &job->meshes)) {
+				//Baked caches are already optimized and carry their LOD chain, fresh imports do both here off the main thread
+				for (size_t i = 0; i < job->meshes.size(); i++)
+				{
+					optimizeMesh(&job->meshes[i]);
+				}
+				if (job->numLods > 1) {
+					generateModelLods(job->meshes, job->numLods, &job->lods);
+				}
+				job->succeeded = true;
+			}
+		}
+		else {
+			job->pixels = stbi_load(job->filePath.c_str(), &job->width, &job->height, &job->numComponents, 0);
+			job->succeeded = job->pixels != NULL;
+		}
+
+		//Push onto the completion stack without locking
+		job->next = m_completed.load(std::memory_order_relaxed);
+		while (!m_completed.compare_exchange_weak(job->next, job, std::memory_order_release, std::memory_order_relaxed));
+	}
+}
+
+void jameslib::AssetLoader::processUploads(double budgetMs)
+{
+	//Take everything finished so far in one exchange. The stack pops newest first, so reverse it once
+	//to upload in completion order
+	Job* completed = m_completed.exchange(nullptr, std::memory_order_acquire);
+	std::vector<Job*> finished;
+	while (completed) {
+		finished.push_back(completed);
+		completed = completed->next;
+	}
+	m_readyToUpload.insert(m_readyToUpload.end(), finished.rbegin(), finished.rend());
+
+	auto start = std::chrono::steady_clock::now();
+	while (!m_readyToUpload.empty()) {
+		Job* job = m_readyToUpload.front();
+		m_readyToUpload.pop_front();
+		upload(job);
+		delete job;
+		m_numPending--;
+
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		if (elapsed.count() >= budgetMs) {
+			break;
+		}
+	}
+}
+
+void jameslib::AssetLoader::upload(Job* job)
+{
+	if (!job->succeeded) {
+		printf("Failed to load asset %s\n", job->filePath.c_str());
+		return;
+	}
+	if (job->type == AssetType::MODEL) {
+		if (job->meshCache.header) {
+			job->model->load(job->meshCache, job->numLods);
+			closeMeshCache(&job->meshCache);
+		}
+		else {
+			job->model->load(job->meshes);
+		}
+		for (size_t i = 0; i < job->lods.size(); i++)
+		{
+			job->model->addLod(job->lods[i]);
+		}
+	}
+	else {
+		ew::uploadTexture(job->texture, job->width, job->height, job->numComponents, job->pixels, job->wrapMode, job->magFilter, job->minFilter, job->mipmap);
+		stbi_image_free(job->pixels);
+		job->pixels = nullptr;
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "../ew/model.h"
+#include "meshCache.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace jameslib
+{
+	//Decodes models and images on worker threads. Finished loads are pushed onto a lock-free
+	//completion queue and uploaded to GL on the main thread by processUploads.
+	class AssetLoader
+	{
+	public:
+		//numThreads = 0 picks one less than the hardware thread count
+		AssetLoader(unsigned int numThreads = 0);
+		~AssetLoader();
+
+		//model must outlive the load. It stays empty (draws nothing) until uploaded.
+		//A baked .ewmesh next to the file is mapped instead of importing with Assimp.
+		//Loads up to numLods detail levels. Baked caches already carry them, fresh imports simplify a chain
+		//on the worker, see generateModelLods.
+		void loadModel(const std::string& filePath, ew::Model* model, int numLods = 1);
+		//Returns a texture handle that samples a 1x1 white placeholder until the image is uploaded
+		unsigned int loadTexture(const char* filePath);
+		unsigned int loadTexture(const char* filePath, int wrapMode, int magFilter, int minFilter, bool mipmap);
+
+		//Uploads finished loads until budgetMs has elapsed. Always uploads at least one.
+		void processUploads(double budgetMs);
+		inline int getNumPending()const { return m_numPending.load(); }
+
+	private:
+		enum class AssetType {
+			MODEL,
+			TEXTURE
+		};
+		struct Job {
+			AssetType type;
+			std::string filePath;
+			ew::Model* model = nullptr;
+			int numLods = 1;
+			unsigned int texture = 0;
+			int wrapMode, magFilter, minFilter;
+			bool mipmap;
+
+			//Filled in by the worker
+			Job* next = nullptr;
+			bool succeeded = false;
+			std::vector<ew::MeshData> meshes;
+			MeshCache meshCache; //Mapped instead of meshes when a baked cache exists
+			std::vector<std::vector<ew::MeshData>> lods; //[level - 1][submesh]
+			unsigned char* pixels = nullptr;
+			int width, height, numComponents;
+		};
+
+		void submit(Job* job);
+		void workerLoop();
+		void upload(Job* job);
+
+		std::vector<std::thread> m_workers;
+		std::mutex m_jobMutex;
+		std::condition_variable m_jobCondition;
+		std::deque<Job*> m_jobs;
+		bool m_stopping = false;
+
+		std::atomic<Job*> m_completed; //Lock-free LIFO pushed by workers
+		std::deque<Job*> m_readyToUpload; //Main thread only, in completion order
+		std::atomic<int> m_numPending;
+	};
+}
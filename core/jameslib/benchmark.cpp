@@ -0,0 +1,345 @@
+#include "benchmark.h"
+#include "pngWriter.h"
+#include "shaderCache.h"
+#include "../ew/external/glad.h"
+#include <algorithm>
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace
+{
+	//Counted by wrappers around the loaded GL entry points. ImGui's backend loads its own, so UI draws aren't included.
+	uint32_t numDrawCalls = 0;
+	uint32_t numDispatches = 0;
+
+	PFNGLDRAWARRAYSPROC drawArrays;
+	PFNGLDRAWARRAYSINSTANCEDPROC drawArraysInstanced;
+	PFNGLDRAWELEMENTSPROC drawElements;
+	PFNGLDRAWELEMENTSINSTANCEDPROC drawElementsInstanced;
+	PFNGLDRAWELEMENTSBASEVERTEXPROC drawElementsBaseVertex;
+	PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXPROC drawElementsInstancedBaseVertex;
+	PFNGLDRAWELEMENTSINSTANCEDBASEVERTEXBASEINSTANCEPROC drawElementsInstancedBaseVertexBaseInstance;
+	PFNGLMULTIDRAWELEMENTSINDIRECTPROC multiDrawElementsIndirect;
+	PFNGLDISPATCHCOMPUTEPROC dispatchCompute;
+
+	void GLAD_API_PTR countDrawArrays(GLenum mode, GLint first, GLsizei count)
+	{
+		numDrawCalls++;
+		drawArrays(mode, first, count);
+	}
+	void GLAD_API_PTR countDrawArraysInstanced(GLenum mode, GLint first, GLsizei count, GLsizei instanceCount)
+	{
+		numDrawCalls++;
+		drawArraysInstanced(mode, first, count, instanceCount);
+	}
+	void GLAD_API_PTR countDrawElements(GLenum mode, GLsizei count, GLenum type, const void* indices)
+	{
+		numDrawCalls++;
+		drawElements(mode, count, type, indices);
+	}
+	void GLAD_API_PTR countDrawElementsInstanced(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount)
+	{
+		numDrawCalls++;
+		drawElementsInstanced(mode, count, type, indices, instanceCount);
+	}
+	void GLAD_API_PTR countDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLint baseVertex)
+	{
+		numDrawCalls++;
+		drawElementsBaseVertex(mode, count, type, indices, baseVertex);
+	}
+	void GLAD_API_PTR countDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount, GLint baseVertex)
+	{
+		numDrawCalls++;
+		drawElementsInstancedBaseVertex(mode, count, type, indices, instanceCount, baseVertex);
+	}
+	void GLAD_API_PTR countDrawElementsInstancedBaseVertexBaseInstance(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instanceCount, GLint baseVertex, GLuint baseInstance)
+	{
+		numDrawCalls++;
+		drawElementsInstancedBaseVertexBaseInstance(mode, count, type, indices, instanceCount, baseVertex, baseInstance);
+	}
+	//One call, however many commands it submits
+	void GLAD_API_PTR countMultiDrawElementsIndirect(GLenum mode, GLenum type, const void* indirect, GLsizei drawCount, GLsizei stride)
+	{
+		numDrawCalls++;
+		multiDrawElementsIndirect(mode, type, indirect, drawCount, stride);
+	}
+	void GLAD_API_PTR countDispatchCompute(GLuint x, GLuint y, GLuint z)
+	{
+		numDispatches++;
+		dispatchCompute(x, y, z);
+	}
+
+	void installDrawCounters()
+	{
+		if (glad_glDrawArrays == countDrawArrays) {
+			return;
+		}
+		drawArrays = glad_glDrawArrays;
+		drawArraysInstanced = glad_glDrawArraysInstanced;
+		drawElements = glad_glDrawElements;
+		drawElementsInstanced = glad_glDrawElementsInstanced;
+		drawElementsBaseVertex = glad_glDrawElementsBaseVertex;
+		drawElementsInstancedBaseVertex = glad_glDrawElementsInstancedBaseVertex;
+		drawElementsInstancedBaseVertexBaseInstance = glad_glDrawElementsInstancedBaseVertexBaseInstance;
+		multiDrawElementsIndirect = glad_glMultiDrawElementsIndirect;
+		dispatchCompute = glad_glDispatchCompute;
+		glad_glDrawArrays = countDrawArrays;
+		glad_glDrawArraysInstanced = countDrawArraysInstanced;
+		glad_glDrawElements = countDrawElements;
+		glad_glDrawElementsInstanced = countDrawElementsInstanced;
+		glad_glDrawElementsBaseVertex = countDrawElementsBaseVertex;
+		glad_glDrawElementsInstancedBaseVertex = countDrawElementsInstancedBaseVertex;
+		glad_glDrawElementsInstancedBaseVertexBaseInstance = countDrawElementsInstancedBaseVertexBaseInstance;
+		glad_glMultiDrawElementsIndirect = countMultiDrawElementsIndirect;
+		glad_glDispatchCompute = countDispatchCompute;
+	}
+
+	//Nearest rank on sorted values
+	double getPercentile(const std::vector<double>& sorted, double percentile)
+	{
+		if (sorted.empty()) {
+			return 0.0;
+		}
+		size_t rank = (size_t)ceil(percentile / 100.0 * sorted.size());
+		return sorted[rank > 0 ? rank - 1 : 0];
+	}
+
+	void writeJsonString(FILE* file, const std::string& s)
+	{
+		fputc('"', file);
+		for (size_t i = 0; i < s.size(); i++)
+		{
+			if (s[i] == '"' || s[i] == '\\') {
+				fputc('\\', file);
+			}
+			if ((unsigned char)s[i] >= 0x20) {
+				fputc(s[i], file);
+			}
+		}
+		fputc('"', file);
+	}
+
+	void writeCountStats(FILE* file, const char* name, const std::vector<uint32_t>& counts)
+	{
+		double sum = 0.0;
+		uint32_t maxCount = 0;
+		for (size_t i = 0; i < counts.size(); i++)
+		{
+			sum += counts[i];
+			maxCount = std::max(maxCount, counts[i]);
+		}
+		fprintf(file, "  \"%s\": { \"mean\": %.2f, \"max\": %u },\n", name, counts.empty() ? 0.0 : sum / counts.size(), maxCount);
+	}
+
+	bool isNumber(const char* s)
+	{
+		if (!*s) {
+			return false;
+		}
+		for (; *s; s++)
+		{
+			if (!isdigit((unsigned char)*s)) {
+				return false;
+			}
+		}
+		return true;
+	}
+}
+
+bool jameslib::parseBenchmarkArgs(int argc, char** argv, BenchmarkSettings* settings)
+{
+	for (int i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (strcmp(arg, "--benchmark") == 0) {
+			settings->enabled = true;
+			if (hasValue && isNumber(argv[i + 1])) {
+				settings->numFrames = std::max(1, atoi(argv[++i]));
+			}
+		}
+		else if (strcmp(arg, "--warmup") == 0 && hasValue) {
+			settings->warmupFrames = std::max(0, atoi(argv[++i]));
+		}
+		else if (strcmp(arg, "--size") == 0 && hasValue) {
+			if (sscanf(argv[++i], "%dx%d", &settings->width, &settings->height) != 2 || settings->width <= 0 || settings->height <= 0) {
+				printf("Invalid size %s, expected <width>x<height>\n", argv[i]);
+				return false;
+			}
+		}
+		else if (strcmp(arg, "--report") == 0 && hasValue) {
+			settings->reportPath = argv[++i];
+		}
+		else if (strcmp(arg, "--capture") == 0 && hasValue) {
+			settings->capturePath = argv[++i];
+		}
+		else if (strcmp(arg, "--capture-every") == 0 && hasValue) {
+			settings->captureInterval = std::max(0, atoi(argv[++i]));
+		}
+		else {
+			printf("Unknown argument %s\n", arg);
+			printf("Usage: %s [--benchmark [frames]] [--warmup frames] [--size WxH] [--report path.json] [--capture path] [--capture-every frames]\n", argv[0]);
+			return false;
+		}
+	}
+	return true;
+}
+
+void jameslib::CameraPath::evaluate(float t, ew::Camera* camera)const
+{
+	int n = (int)keys.size();
+	if (n == 0) {
+		return;
+	}
+	float f = (t - floorf(t)) * n;
+	int i = (int)f % n;
+	float u = f - floorf(f);
+	const CameraKey& k0 = keys[(i + n - 1) % n];
+	const CameraKey& k1 = keys[i];
+	const CameraKey& k2 = keys[(i + 1) % n];
+	const CameraKey& k3 = keys[(i + 2) % n];
+	//Uniform Catmull-Rom passes through every key with a continuous tangent
+	float u2 = u * u;
+	float u3 = u2 * u;
+	float w0 = -0.5f * u3 + u2 - 0.5f * u;
+	float w1 = 1.5f * u3 - 2.5f * u2 + 1.0f;
+	float w2 = -1.5f * u3 + 2.0f * u2 + 0.5f * u;
+	float w3 = 0.5f * u3 - 0.5f * u2;
+	camera->position = k0.position * w0 + k1.position * w1 + k2.position * w2 + k3.position * w3;
+	camera->target = k0.target * w0 + k1.target * w1 + k2.target * w2 + k3.target * w3;
+}
+
+jameslib::CameraPath jameslib::createOrbitPath(const glm::vec3& target, float radius, float minHeight, float maxHeight, int numKeys)
+{
+	CameraPath path;
+	for (int i = 0; i < numKeys; i++)
+	{
+		float angle = 6.2831853f * i / numKeys;
+		float height = minHeight + (maxHeight - minHeight) * (0.5f + 0.5f * sinf(angle * 2.0f));
+		CameraKey key;
+		key.position = target + glm::vec3(sinf(angle) * radius, height, cosf(angle) * radius);
+		key.target = target;
+		path.keys.push_back(key);
+	}
+	return path;
+}
+
+jameslib::BenchmarkRunner::BenchmarkRunner(const char* name, const BenchmarkSettings& settings)
+	: m_name(name), m_settings(settings), m_created(std::chrono::steady_clock::now())
+{
+}
+
+void jameslib::BenchmarkRunner::start()
+{
+	if (!m_settings.enabled) {
+		return;
+	}
+	installDrawCounters();
+	const char* renderer = (const char*)glGetString(GL_RENDERER);
+	m_renderer = renderer ? renderer : "";
+	m_frameMs.reserve(m_settings.numFrames);
+	m_drawCalls.reserve(m_settings.numFrames);
+	m_dispatches.reserve(m_settings.numFrames);
+	printf("Benchmarking %s: %d frames at %dx%d on %s\n", m_name.c_str(), m_settings.numFrames, m_settings.width, m_settings.height, m_renderer.c_str());
+}
+
+void jameslib::BenchmarkRunner::updateCamera(const CameraPath& path, ew::Camera* camera)const
+{
+	//Warmup holds the first key, the measured frames make one lap
+	int measured = std::max(0, m_frame - m_settings.warmupFrames);
+	path.evaluate((float)measured / m_settings.numFrames, camera);
+}
+
+void jameslib::BenchmarkRunner::beginFrame()
+{
+	if (!m_settings.enabled) {
+		return;
+	}
+	numDrawCalls = 0;
+	numDispatches = 0;
+	m_frameStart = std::chrono::steady_clock::now();
+	if (m_frame == 0) {
+		std::chrono::duration<double, std::milli> startup = m_frameStart - m_created;
+		m_startupMs = startup.count();
+	}
+}
+
+void jameslib::BenchmarkRunner::endFrame(int width, int height)
+{
+	if (!m_settings.enabled) {
+		return;
+	}
+	glFinish();
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_frameStart;
+	int measured = m_frame - m_settings.warmupFrames;
+	m_frame++;
+	if (measured < 0) {
+		return;
+	}
+	m_frameMs.push_back(elapsed.count());
+	m_drawCalls.push_back(numDrawCalls);
+	m_dispatches.push_back(numDispatches);
+
+	bool capture = !m_settings.capturePath.empty() && (m_settings.captureInterval > 0
+		? (measured + 1) % m_settings.captureInterval == 0
+		: measured == m_settings.numFrames - 1);
+	if (capture && width > 0 && height > 0) {
+		std::vector<unsigned char> pixels((size_t)width * height * 4);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		char path[512];
+		snprintf(path, sizeof(path), "%s_%04d.png", m_settings.capturePath.c_str(), measured);
+		if (writePng(path, width, height, pixels.data(), true)) {
+			m_captures.push_back(path);
+		}
+	}
+}
+
+bool jameslib::BenchmarkRunner::writeReport()const
+{
+	std::vector<double> sorted = m_frameMs;
+	std::sort(sorted.begin(), sorted.end());
+	double sum = 0.0;
+	for (size_t i = 0; i < sorted.size(); i++)
+	{
+		sum += sorted[i];
+	}
+	double mean = sorted.empty() ? 0.0 : sum / sorted.size();
+	printf("%s: mean %.3f ms, p50 %.3f ms, p95 %.3f ms, p99 %.3f ms over %d frames\n", m_name.c_str(), mean,
+		getPercentile(sorted, 50.0), getPercentile(sorted, 95.0), getPercentile(sorted, 99.0), (int)sorted.size());
+
+	FILE* file = fopen(m_settings.reportPath.c_str(), "w");
+	if (!file) {
+		printf("Failed to open %s for writing\n", m_settings.reportPath.c_str());
+		return false;
+	}
+	fprintf(file, "{\n  \"name\": ");
+	writeJsonString(file, m_name);
+	fprintf(file, ",\n  \"renderer\": ");
+	writeJsonString(file, m_renderer);
+	fprintf(file, ",\n  \"width\": %d,\n  \"height\": %d,\n  \"warmupFrames\": %d,\n  \"frames\": %d,\n",
+		m_settings.width, m_settings.height, m_settings.warmupFrames, (int)sorted.size());
+	//A warm start loads every program from the cache
+	const ShaderCacheStats& shaderCache = getShaderCacheStats();
+	fprintf(file, "  \"startupMs\": %.3f,\n", m_startupMs);
+	fprintf(file, "  \"shaderCache\": { \"hits\": %u, \"misses\": %u, \"rejected\": %u, \"loadMs\": %.3f, \"compileMs\": %.3f },\n",
+		shaderCache.hits, shaderCache.misses, shaderCache.rejected, shaderCache.loadMs, shaderCache.compileMs);
+	fprintf(file, "  \"frameMs\": { \"mean\": %.4f, \"min\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p95\": %.4f, \"p99\": %.4f, \"max\": %.4f },\n",
+		mean, sorted.empty() ? 0.0 : sorted.front(), getPercentile(sorted, 50.0), getPercentile(sorted, 90.0),
+		getPercentile(sorted, 95.0), getPercentile(sorted, 99.0), sorted.empty() ? 0.0 : sorted.back());
+	writeCountStats(file, "drawCalls", m_drawCalls);
+	writeCountStats(file, "dispatches", m_dispatches);
+	fprintf(file, "  \"captures\": [");
+	for (size_t i = 0; i < m_captures.size(); i++)
+	{
+		fprintf(file, i == 0 ? "" : ", ");
+		writeJsonString(file, m_captures[i]);
+	}
+	fprintf(file, "]\n}\n");
+	fclose(file);
+	return true;
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "../ew/camera.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace jameslib
+{
+	struct BenchmarkSettings
+	{
+		bool enabled = false;
+		int numFrames = 600; //Measured frames, after the warmup
+		int warmupFrames = 60; //Shader compiles, asset uploads and pool allocations settle here
+		int width = 1280;
+		int height = 720;
+		std::string reportPath = "benchmark.json";
+		std::string capturePath; //PNG captures are written to <capturePath>_<frame>.png. Empty disables them.
+		int captureInterval = 0; //Capture every N measured frames. 0 captures the last frame only.
+	};
+
+	//Reads --benchmark [frames], --warmup <frames>, --size <w>x<h>, --report <path>, --capture <path>
+	//and --capture-every <frames>. Returns false and prints usage on anything it doesn't recognize.
+	bool parseBenchmarkArgs(int argc, char** argv, BenchmarkSettings* settings);
+
+	struct CameraKey
+	{
+		glm::vec3 position;
+		glm::vec3 target;
+	};
+
+	//Evenly spaced keys played back with Catmull-Rom interpolation. Loops back to the first key.
+	struct CameraPath
+	{
+		std::vector<CameraKey> keys;
+
+		//t in [0, 1] covers the whole loop
+		void evaluate(float t, ew::Camera* camera)const;
+	};
+
+	//One lap around target, rising and falling between two heights so the view sweeps over and under objects
+	CameraPath createOrbitPath(const glm::vec3& target, float radius, float minHeight, float maxHeight, int numKeys = 8);
+
+	//Drives an assignment without user input: fixed timestep, scripted camera, frame times taken after glFinish
+	//so they include the GPU. Draw calls and compute dispatches are counted by wrapping the loaded GL entry
+	//points, so every draw in core and the assignments is seen without changes at the call sites.
+	//With HEADLESS_BENCHMARK GLFW is built against OSMesa and needs no display, e.g. on Mesa llvmpipe.
+	class BenchmarkRunner
+	{
+	public:
+		BenchmarkRunner(const char* name, const BenchmarkSettings& settings);
+
+		inline bool isEnabled()const { return m_settings.enabled; }
+		inline const BenchmarkSettings& getSettings()const { return m_settings; }
+		//Call once GL is loaded. Installs the draw counters and prints the renderer.
+		void start();
+		inline bool isFinished()const { return m_settings.enabled && m_frame >= m_settings.warmupFrames + m_settings.numFrames; }
+		//Scripted time for the current frame, advancing 1/60 s per frame
+		inline float getTime()const { return m_frame / 60.0f; }
+		inline float getDeltaTime()const { return 1.0f / 60.0f; }
+		void updateCamera(const CameraPath& path, ew::Camera* camera)const;
+
+		//Both do nothing unless the benchmark is enabled
+		void beginFrame();
+		//Call before swapping buffers with the window's framebuffer size: the back buffer is read back for captures
+		void endFrame(int width, int height);
+
+		//Writes a JSON report with startup time, shader cache use, frame time percentiles and draw counts
+		bool writeReport()const;
+	private:
+		std::string m_name;
+		BenchmarkSettings m_settings;
+		int m_frame = 0;
+		std::chrono::steady_clock::time_point m_created;
+		double m_startupMs = 0.0; //Construction to the first frame: window, GL, shaders and assets
+		std::chrono::steady_clock::time_point m_frameStart;
+		std::vector<double> m_frameMs;
+		std::vector<uint32_t> m_drawCalls;
+		std::vector<uint32_t> m_dispatches;
+		std::vector<std::string> m_captures;
+		std::string m_renderer;
+	};
+}
@@ -0,0 +1,360 @@
+#include "culling.h"
+#include <math.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#define CULLING_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CULLING_SSE
+#endif
+
+jameslib::Frustum jameslib::extractFrustum(const glm::mat4& viewProjection)
+{
+	//glm is column major, so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+	Frustum frustum;
+	frustum.planes[0] = rows[3] + rows[0];
+	frustum.planes[1] = rows[3] - rows[0];
+	frustum.planes[2] = rows[3] + rows[1];
+	frustum.planes[3] = rows[3] - rows[1];
+	frustum.planes[4] = rows[3] + rows[2];
+	frustum.planes[5] = rows[3] - rows[2];
+	for (int i = 0; i < 6; i++)
+	{
+		frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+	}
+	return frustum;
+}
+
+jameslib::Frustum jameslib::extractFrustum(const ew::Camera& camera)
+{
+	return extractFrustum(camera.projectionMatrix() * camera.viewMatrix());
+}
+
+jameslib::Frustum jameslib::extractFrustum(const glm::mat4& viewProjection, const glm::vec2& ndcMin, const glm::vec2& ndcMax, float ndcNear, float ndcFar)
+{
+	glm::vec4 rows[4];
+	for (int i = 0; i < 4; i++)
+	{
+		rows[i] = glm::vec4(viewProjection[0][i], viewProjection[1][i], viewProjection[2][i], viewProjection[3][i]);
+	}
+	//x_clip >= ndcMin.x * w_clip and so on. The full range (-1, 1) reduces to the planes above.
+	Frustum frustum;
+	frustum.planes[0] = rows[0] - rows[3] * ndcMin.x;
+	frustum.planes[1] = rows[3] * ndcMax.x - rows[0];
+	frustum.planes[2] = rows[1] - rows[3] * ndcMin.y;
+	frustum.planes[3] = rows[3] * ndcMax.y - rows[1];
+	frustum.planes[4] = rows[2] - rows[3] * ndcNear;
+	frustum.planes[5] = rows[3] * ndcFar - rows[2];
+	for (int i = 0; i < 6; i++)
+	{
+		frustum.planes[i] /= glm::length(glm::vec3(frustum.planes[i]));
+	}
+	return frustum;
+}
+
+ew::Bounds jameslib::transformBounds(const ew::Bounds& bounds, const glm::mat4& transform)
+{
+	ew::Bounds result;
+	glm::vec3 boxCenter = (bounds.min + bounds.max) * 0.5f;
+	glm::vec3 boxExtents = (bounds.max - bounds.min) * 0.5f;
+	//Arvo: each world axis extent is the sum of the rotated object extents projected onto it
+	glm::vec3 worldCenter = glm::vec3(transform * glm::vec4(boxCenter, 1.0f));
+	glm::vec3 worldExtents = glm::abs(glm::vec3(transform[0])) * boxExtents.x
+		+ glm::abs(glm::vec3(transform[1])) * boxExtents.y
+		+ glm::abs(glm::vec3(transform[2])) * boxExtents.z;
+	result.min = worldCenter - worldExtents;
+	result.max = worldCenter + worldExtents;
+
+	float maxScaleSquared = glm::max(glm::dot(glm::vec3(transform[0]), glm::vec3(transform[0])),
+		glm::max(glm::dot(glm::vec3(transform[1]), glm::vec3(transform[1])), glm::dot(glm::vec3(transform[2]), glm::vec3(transform[2]))));
+	result.center = glm::vec3(transform * glm::vec4(bounds.center, 1.0f));
+	result.radius = bounds.radius * sqrtf(maxScaleSquared);
+	return result;
+}
+
+void jameslib::CullingBounds::clear()
+{
+	centerX.clear(); centerY.clear(); centerZ.clear();
+	extentX.clear(); extentY.clear(); extentZ.clear();
+	radius.clear();
+	count = 0;
+}
+
+void jameslib::CullingBounds::reserve(size_t capacity)
+{
+	capacity = (capacity + CULLING_BATCH - 1) / CULLING_BATCH * CULLING_BATCH;
+	centerX.reserve(capacity); centerY.reserve(capacity); centerZ.reserve(capacity);
+	extentX.reserve(capacity); extentY.reserve(capacity); extentZ.reserve(capacity);
+	radius.reserve(capacity);
+}
+
+size_t jameslib::CullingBounds::add(const ew::Bounds& worldBounds)
+{
+	//Grow a whole batch at a time so the kernels never read past the end
+	if (count == centerX.size()) {
+		size_t size = count + CULLING_BATCH;
+		centerX.resize(size); centerY.resize(size); centerZ.resize(size);
+		extentX.resize(size); extentY.resize(size); extentZ.resize(size);
+		radius.resize(size);
+	}
+	set(count, worldBounds);
+	return count++;
+}
+
+void jameslib::CullingBounds::set(size_t index, const ew::Bounds& worldBounds)
+{
+	//Both tests share one center. Merged bounds can have the sphere off the box center,
+	//in which case the box grows around the sphere center to stay conservative.
+	glm::vec3 boxCenter = (worldBounds.min + worldBounds.max) * 0.5f;
+	glm::vec3 boxExtents = (worldBounds.max - worldBounds.min) * 0.5f + glm::abs(boxCenter - worldBounds.center);
+	centerX[index] = worldBounds.center.x;
+	centerY[index] = worldBounds.center.y;
+	centerZ[index] = worldBounds.center.z;
+	radius[index] = worldBounds.radius;
+	extentX[index] = boxExtents.x;
+	extentY[index] = boxExtents.y;
+	extentZ[index] = boxExtents.z;
+}
+
+bool jameslib::isSphereVisible(const Frustum& frustum, const glm::vec3& center, float radius)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = frustum.planes[i];
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+			return false;
+		}
+	}
+	return true;
+}
+
+bool jameslib::isBoxVisible(const Frustum& frustum, const glm::vec3& center, const glm::vec3& extents)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		const glm::vec4& plane = frustum.planes[i];
+		float projectedExtent = glm::dot(glm::abs(glm::vec3(plane)), extents);
+		if (glm::dot(glm::vec3(plane), center) + plane.w < -projectedExtent) {
+			return false;
+		}
+	}
+	return true;
+}
+
+size_t jameslib::cullSpheresScalar(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices)
+{
+	size_t numVisible = 0;
+	for (size_t i = 0; i < bounds.count; i++)
+	{
+		glm::vec3 center = glm::vec3(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+		if (isSphereVisible(frustum, center, bounds.radius[i])) {
+			visibleIndices[numVisible++] = (uint32_t)i;
+		}
+	}
+	return numVisible;
+}
+
+size_t jameslib::cullBoxesScalar(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices)
+{
+	size_t numVisible = 0;
+	for (size_t i = 0; i < bounds.count; i++)
+	{
+		glm::vec3 center = glm::vec3(bounds.centerX[i], bounds.centerY[i], bounds.centerZ[i]);
+		glm::vec3 extents = glm::vec3(bounds.extentX[i], bounds.extentY[i], bounds.extentZ[i]);
+		if (isBoxVisible(frustum, center, extents)) {
+			visibleIndices[numVisible++] = (uint32_t)i;
+		}
+	}
+	return numVisible;
+}
+
+namespace
+{
+	//Appends the set lanes of a visibility mask without branching on each lane
+	inline size_t appendVisible(unsigned int mask, size_t first, size_t lanes, uint32_t* visibleIndices, size_t numVisible)
+	{
+		for (size_t j = 0; j < lanes; j++)
+		{
+			visibleIndices[numVisible] = (uint32_t)(first + j);
+			numVisible += (mask >> j) & 1;
+		}
+		return numVisible;
+	}
+}
+
+#if defined(CULLING_AVX)
+
+size_t jameslib::cullSpheres(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices)
+{
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	size_t numVisible = 0;
+	for (size_t i = 0; i < bounds.count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&bounds.centerX[i]);
+		__m256 y = _mm256_loadu_ps(&bounds.centerY[i]);
+		__m256 z = _mm256_loadu_ps(&bounds.centerZ[i]);
+		__m256 negRadius = _mm256_sub_ps(zero, _mm256_loadu_ps(&bounds.radius[i]));
+		__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+				_mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+			visible = _mm256_and_ps(visible, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+		}
+		size_t lanes = bounds.count - i < 8 ? bounds.count - i : 8;
+		numVisible = appendVisible((unsigned int)_mm256_movemask_ps(visible), i, lanes, visibleIndices, numVisible);
+	}
+	return numVisible;
+}
+
+size_t jameslib::cullBoxes(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices)
+{
+	__m256 planeX[6], planeY[6], planeZ[6], planeW[6];
+	__m256 absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm256_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm256_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm256_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm256_set1_ps(frustum.planes[p].w);
+		absX[p] = _mm256_set1_ps(fabsf(frustum.planes[p].x));
+		absY[p] = _mm256_set1_ps(fabsf(frustum.planes[p].y));
+		absZ[p] = _mm256_set1_ps(fabsf(frustum.planes[p].z));
+	}
+	const __m256 zero = _mm256_setzero_ps();
+	size_t numVisible = 0;
+	for (size_t i = 0; i < bounds.count; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&bounds.centerX[i]);
+		__m256 y = _mm256_loadu_ps(&bounds.centerY[i]);
+		__m256 z = _mm256_loadu_ps(&bounds.centerZ[i]);
+		__m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+		__m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+		__m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+		__m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(planeX[p], x), _mm256_mul_ps(planeY[p], y)),
+				_mm256_add_ps(_mm256_mul_ps(planeZ[p], z), planeW[p]));
+			__m256 projectedExtent = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(absX[p], ex), _mm256_mul_ps(absY[p], ey)), _mm256_mul_ps(absZ[p], ez));
+			visible = _mm256_and_ps(visible, _mm256_cmp_ps(_mm256_add_ps(distance, projectedExtent), zero, _CMP_GE_OQ));
+		}
+		size_t lanes = bounds.count - i < 8 ? bounds.count - i : 8;
+		numVisible = appendVisible((unsigned int)_mm256_movemask_ps(visible), i, lanes, visibleIndices, numVisible);
+	}
+	return numVisible;
+}
+
+const char* jameslib::getCullingKernelName()
+{
+	return "AVX";
+}
+
+#elif defined(CULLING_SSE)
+
+size_t jameslib::cullSpheres(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices)
+{
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+	}
+	const __m128 zero = _mm_setzero_ps();
+	size_t numVisible = 0;
+	for (size_t i = 0; i < bounds.count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&bounds.centerX[i]);
+		__m128 y = _mm_loadu_ps(&bounds.centerY[i]);
+		__m128 z = _mm_loadu_ps(&bounds.centerZ[i]);
+		__m128 negRadius = _mm_sub_ps(zero, _mm_loadu_ps(&bounds.radius[i]));
+		__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(distance, negRadius));
+		}
+		size_t lanes = bounds.count - i < 4 ? bounds.count - i : 4;
+		numVisible = appendVisible((unsigned int)_mm_movemask_ps(visible), i, lanes, visibleIndices, numVisible);
+	}
+	return numVisible;
+}
+
+size_t jameslib::cullBoxes(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices)
+{
+	__m128 planeX[6], planeY[6], planeZ[6], planeW[6];
+	__m128 absX[6], absY[6], absZ[6];
+	for (int p = 0; p < 6; p++)
+	{
+		planeX[p] = _mm_set1_ps(frustum.planes[p].x);
+		planeY[p] = _mm_set1_ps(frustum.planes[p].y);
+		planeZ[p] = _mm_set1_ps(frustum.planes[p].z);
+		planeW[p] = _mm_set1_ps(frustum.planes[p].w);
+		absX[p] = _mm_set1_ps(fabsf(frustum.planes[p].x));
+		absY[p] = _mm_set1_ps(fabsf(frustum.planes[p].y));
+		absZ[p] = _mm_set1_ps(fabsf(frustum.planes[p].z));
+	}
+	const __m128 zero = _mm_setzero_ps();
+	size_t numVisible = 0;
+	for (size_t i = 0; i < bounds.count; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&bounds.centerX[i]);
+		__m128 y = _mm_loadu_ps(&bounds.centerY[i]);
+		__m128 z = _mm_loadu_ps(&bounds.centerZ[i]);
+		__m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+		__m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+		__m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+		__m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(planeX[p], x), _mm_mul_ps(planeY[p], y)),
+				_mm_add_ps(_mm_mul_ps(planeZ[p], z), planeW[p]));
+			__m128 projectedExtent = _mm_add_ps(_mm_add_ps(_mm_mul_ps(absX[p], ex), _mm_mul_ps(absY[p], ey)), _mm_mul_ps(absZ[p], ez));
+			visible = _mm_and_ps(visible, _mm_cmpge_ps(_mm_add_ps(distance, projectedExtent), zero));
+		}
+		size_t lanes = bounds.count - i < 4 ? bounds.count - i : 4;
+		numVisible = appendVisible((unsigned int)_mm_movemask_ps(visible), i, lanes, visibleIndices, numVisible);
+	}
+	return numVisible;
+}
+
+const char* jameslib::getCullingKernelName()
+{
+	return "SSE";
+}
+
+#else
+
+size_t jameslib::cullSpheres(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices)
+{
+	return cullSpheresScalar(frustum, bounds, visibleIndices);
+}
+
+size_t jameslib::cullBoxes(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices)
+{
+	return cullBoxesScalar(frustum, bounds, visibleIndices);
+}
+
+const char* jameslib::getCullingKernelName()
+{
+	return "Scalar";
+}
+
+#endif
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../ew/camera.h"
+#include "../ew/mesh.h"
+#include <stdint.h>
+#include <vector>
+
+namespace jameslib
+{
+	//Planes are (normal, distance) with normals pointing into the frustum, so a point p is
+	//inside a plane when dot(normal, p) + distance >= 0.
+	struct Frustum
+	{
+		glm::vec4 planes[6]; //Left, right, bottom, top, near, far
+	};
+
+	//Gribb/Hartmann extraction. Works for perspective and orthographic cameras.
+	Frustum extractFrustum(const glm::mat4& viewProjection);
+	Frustum extractFrustum(const ew::Camera& camera);
+	//The part of a view frustum covering an NDC box, e.g. one screen tile between two depths
+	Frustum extractFrustum(const glm::mat4& viewProjection, const glm::vec2& ndcMin, const glm::vec2& ndcMax, float ndcNear = -1.0f, float ndcFar = 1.0f);
+
+	//Conservative world space bounds of object space bounds under an affine transform
+	ew::Bounds transformBounds(const ew::Bounds& bounds, const glm::mat4& transform);
+
+	//World space bounds stored as structure of arrays so the kernels can test 4 or 8 objects per instruction.
+	//Arrays are padded to a multiple of CULLING_BATCH with empty bounds that are never reported.
+	const size_t CULLING_BATCH = 8;
+	struct CullingBounds
+	{
+		std::vector<float> centerX, centerY, centerZ;
+		std::vector<float> extentX, extentY, extentZ; //Box half size
+		std::vector<float> radius;
+		size_t count = 0;
+
+		void clear();
+		void reserve(size_t capacity);
+		//Returns the index the bounds were stored at
+		size_t add(const ew::Bounds& worldBounds);
+		//Overwrites bounds previously added at index
+		void set(size_t index, const ew::Bounds& worldBounds);
+	};
+
+	//Writes the indices of visible objects in ascending order and returns how many were visible.
+	//visibleIndices must have room for bounds.count entries.
+	size_t cullSpheres(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices);
+	size_t cullBoxes(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices);
+	//One object at a time, used as a reference for the batched kernels
+	size_t cullSpheresScalar(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices);
+	size_t cullBoxesScalar(const Frustum& frustum, const CullingBounds& bounds, uint32_t* visibleIndices);
+	bool isSphereVisible(const Frustum& frustum, const glm::vec3& center, float radius);
+	bool isBoxVisible(const Frustum& frustum, const glm::vec3& center, const glm::vec3& extents);
+
+	//Name of the instruction set the batched kernels were compiled for ("AVX", "SSE" or "Scalar")
+	const char* getCullingKernelName();
+}
@@ -0,0 +1,341 @@
+#include "frameGraph.h"
+#include "profiler.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+
+namespace
+{
+	//Barrier a pass needs before touching a resource last written through image or shader storage stores
+	unsigned int getBarrierBit(jameslib::FrameGraphAccess access, bool buffer)
+	{
+		switch (access)
+		{
+		case jameslib::FrameGraphAccess::SAMPLED:
+			return buffer ? GL_UNIFORM_BARRIER_BIT : GL_TEXTURE_FETCH_BARRIER_BIT;
+		case jameslib::FrameGraphAccess::ATTACHMENT:
+			return GL_FRAMEBUFFER_BARRIER_BIT;
+		case jameslib::FrameGraphAccess::STORAGE:
+			return buffer ? GL_SHADER_STORAGE_BARRIER_BIT : GL_SHADER_IMAGE_ACCESS_BARRIER_BIT;
+		default:
+			return GL_ALL_BARRIER_BITS;
+		}
+	}
+}
+
+jameslib::FrameGraph::FrameGraph(RenderTargetPool& pool)
+	: m_pool(pool)
+{
+}
+
+void jameslib::FrameGraph::reset()
+{
+	m_resources.clear();
+	m_passes.clear();
+	m_numCulled = 0;
+	m_numBarriers = 0;
+}
+
+jameslib::FrameGraphResource jameslib::FrameGraph::createTexture(const char* name, unsigned int width, unsigned int height, int format)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.type = ResourceType::TRANSIENT;
+	resource.width = width;
+	resource.height = height;
+	resource.format = format;
+	m_resources.push_back(resource);
+	return (FrameGraphResource)(m_resources.size() - 1);
+}
+
+jameslib::FrameGraphResource jameslib::FrameGraph::importTexture(const char* name, unsigned int texture, unsigned int width, unsigned int height)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.type = ResourceType::TEXTURE;
+	resource.width = width;
+	resource.height = height;
+	resource.object = texture;
+	m_resources.push_back(resource);
+	return (FrameGraphResource)(m_resources.size() - 1);
+}
+
+jameslib::FrameGraphResource jameslib::FrameGraph::importBuffer(const char* name, unsigned int buffer)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.type = ResourceType::BUFFER;
+	resource.object = buffer;
+	m_resources.push_back(resource);
+	return (FrameGraphResource)(m_resources.size() - 1);
+}
+
+jameslib::FrameGraphResource jameslib::FrameGraph::importFramebuffer(const char* name, const Framebuffer& framebuffer)
+{
+	Resource resource = {};
+	resource.name = name;
+	resource.type = ResourceType::FRAMEBUFFER;
+	resource.width = framebuffer.width;
+	resource.height = framebuffer.height;
+	resource.object = framebuffer.colorBuffers[0] ? framebuffer.colorBuffers[0] : framebuffer.depthBuffer;
+	resource.fbo = framebuffer.fbo;
+	m_resources.push_back(resource);
+	return (FrameGraphResource)(m_resources.size() - 1);
+}
+
+void jameslib::FrameGraph::markOutput(FrameGraphResource resource)
+{
+	m_resources[resource].output = true;
+}
+
+jameslib::FrameGraphPass jameslib::FrameGraph::addPass(const char* name, std::function<void()> execute)
+{
+	Pass pass;
+	pass.name = name;
+	pass.execute = execute;
+	pass.clearColor = glm::vec4(0.0f);
+	pass.clearMask = 0;
+	pass.culled = false;
+	pass.numWrites = 0;
+	pass.barrierBits = 0;
+	m_passes.push_back(pass);
+	return (FrameGraphPass)(m_passes.size() - 1);
+}
+
+void jameslib::FrameGraph::read(FrameGraphPass pass, FrameGraphResource resource, FrameGraphAccess access)
+{
+	Access a;
+	a.resource = resource;
+	a.access = access;
+	a.write = false;
+	m_passes[pass].accesses.push_back(a);
+}
+
+void jameslib::FrameGraph::write(FrameGraphPass pass, FrameGraphResource resource, FrameGraphAccess access)
+{
+	Access a;
+	a.resource = resource;
+	a.access = access;
+	a.write = true;
+	m_passes[pass].accesses.push_back(a);
+}
+
+void jameslib::FrameGraph::setClear(FrameGraphPass pass, const glm::vec4& color, bool clearColor, bool clearDepth)
+{
+	m_passes[pass].clearColor = color;
+	m_passes[pass].clearMask = (clearColor ? GL_COLOR_BUFFER_BIT : 0) | (clearDepth ? GL_DEPTH_BUFFER_BIT : 0);
+}
+
+void jameslib::FrameGraph::compile()
+{
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		m_resources[i].numReaders = 0;
+		m_resources[i].firstPass = -1;
+		m_resources[i].lastPass = -1;
+	}
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		Pass& pass = m_passes[i];
+		pass.culled = false;
+		pass.numWrites = 0;
+		pass.barrierBits = 0;
+		for (size_t j = 0; j < pass.accesses.size(); j++)
+		{
+			if (pass.accesses[j].write) {
+				pass.numWrites++;
+			}
+			else {
+				m_resources[pass.accesses[j].resource].numReaders++;
+			}
+		}
+	}
+
+	//Flood backwards from resources nobody reads: their writers lose a reference, and a writer left
+	//with none is culled, which in turn releases everything it reads
+	std::vector<FrameGraphResource> unused;
+	for (size_t i = 0; i < m_resources.size(); i++)
+	{
+		if (m_resources[i].numReaders == 0 && !m_resources[i].output) {
+			unused.push_back((FrameGraphResource)i);
+		}
+	}
+	while (!unused.empty()) {
+		FrameGraphResource resource = unused.back();
+		unused.pop_back();
+		for (size_t i = 0; i < m_passes.size(); i++)
+		{
+			Pass& pass = m_passes[i];
+			if (pass.culled) {
+				continue;
+			}
+			for (size_t j = 0; j < pass.accesses.size(); j++)
+			{
+				if (!pass.accesses[j].write || pass.accesses[j].resource != resource) {
+					continue;
+				}
+				pass.numWrites--;
+				if (pass.numWrites > 0) {
+					continue;
+				}
+				pass.culled = true;
+				for (size_t k = 0; k < pass.accesses.size(); k++)
+				{
+					const Access& a = pass.accesses[k];
+					if (!a.write && --m_resources[a.resource].numReaders == 0 && !m_resources[a.resource].output) {
+						unused.push_back(a.resource);
+					}
+				}
+				break;
+			}
+		}
+	}
+
+	//Lifetimes and barriers over the passes that survived
+	m_numCulled = 0;
+	m_numBarriers = 0;
+	std::vector<bool> storageWritten(m_resources.size(), false);
+	std::vector<unsigned int> barriersSinceWrite(m_resources.size(), 0);
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		Pass& pass = m_passes[i];
+		if (pass.culled) {
+			m_numCulled++;
+			continue;
+		}
+		for (size_t j = 0; j < pass.accesses.size(); j++)
+		{
+			const Access& a = pass.accesses[j];
+			Resource& resource = m_resources[a.resource];
+			if (resource.firstPass < 0) {
+				resource.firstPass = (int)i;
+				if (resource.type == ResourceType::TRANSIENT && !a.write) {
+					printf("Frame graph pass %s reads %s before anything writes it\n", pass.name.c_str(), resource.name.c_str());
+				}
+			}
+			resource.lastPass = (int)i;
+			if (storageWritten[a.resource]) {
+				unsigned int bit = getBarrierBit(a.access, resource.type == ResourceType::BUFFER);
+				if ((barriersSinceWrite[a.resource] & bit) != bit) {
+					pass.barrierBits |= bit;
+					barriersSinceWrite[a.resource] |= bit;
+				}
+			}
+		}
+		//Writes only need a barrier once a later pass touches them
+		for (size_t j = 0; j < pass.accesses.size(); j++)
+		{
+			const Access& a = pass.accesses[j];
+			if (a.write) {
+				storageWritten[a.resource] = a.access == FrameGraphAccess::STORAGE;
+				barriersSinceWrite[a.resource] = 0;
+			}
+		}
+		if (pass.barrierBits != 0) {
+			m_numBarriers++;
+		}
+	}
+}
+
+void jameslib::FrameGraph::execute()
+{
+	Profiler& profiler = getProfiler();
+	m_frameTimings.resize(m_passes.size());
+	for (size_t i = 0; i < m_passes.size(); i++)
+	{
+		Pass& pass = m_passes[i];
+		FrameGraphTiming& timing = m_frameTimings[i];
+		timing.name = pass.name;
+		timing.culled = pass.culled;
+		if (pass.culled) {
+			timing.cpuMs = 0.0f;
+			timing.gpuMs = 0.0f;
+			continue;
+		}
+
+		for (size_t j = 0; j < pass.accesses.size(); j++)
+		{
+			Resource& resource = m_resources[pass.accesses[j].resource];
+			if (resource.type == ResourceType::TRANSIENT && resource.firstPass == (int)i) {
+				resource.object = m_pool.acquireTexture(resource.width, resource.height, resource.format);
+			}
+		}
+
+		uint32_t event = profiler.beginZone(pass.name.c_str(), true);
+		if (pass.barrierBits != 0) {
+			glMemoryBarrier(pass.barrierBits);
+		}
+		bindAttachments(pass);
+		pass.execute();
+		profiler.endZone(event);
+		const ProfilerZone* zone = profiler.findZone(pass.name.c_str());
+		timing.cpuMs = zone->avgCpuMs;
+		timing.gpuMs = zone->avgGpuMs;
+
+		for (size_t j = 0; j < pass.accesses.size(); j++)
+		{
+			Resource& resource = m_resources[pass.accesses[j].resource];
+			if (resource.type == ResourceType::TRANSIENT && resource.lastPass == (int)i && resource.object != 0) {
+				m_pool.releaseTexture(resource.object);
+				resource.object = 0;
+			}
+		}
+	}
+}
+
+unsigned int jameslib::FrameGraph::getTexture(FrameGraphResource resource)const
+{
+	return m_resources[resource].object;
+}
+
+void jameslib::FrameGraph::setTexture(FrameGraphResource resource, unsigned int texture)
+{
+	m_resources[resource].object = texture;
+}
+
+jameslib::Framebuffer jameslib::FrameGraph::getFramebuffer(FrameGraphPass pass)const
+{
+	return m_passes[pass].framebuffer;
+}
+
+void jameslib::FrameGraph::bindAttachments(Pass& pass)
+{
+	Framebuffer framebuffer;
+	unsigned int numColors = 0;
+	bool hasAttachments = false;
+	bool imported = false;
+	for (size_t i = 0; i < pass.accesses.size(); i++)
+	{
+		const Access& a = pass.accesses[i];
+		if (!a.write || a.access != FrameGraphAccess::ATTACHMENT) {
+			continue;
+		}
+		const Resource& resource = m_resources[a.resource];
+		framebuffer.width = resource.width;
+		framebuffer.height = resource.height;
+		hasAttachments = true;
+		if (resource.type == ResourceType::FRAMEBUFFER) {
+			framebuffer.fbo = resource.fbo;
+			imported = true;
+		}
+		else if (isDepthFormat(resource.format)) {
+			framebuffer.depthBuffer = resource.object;
+		}
+		else if (numColors < 8) {
+			framebuffer.colorBuffers[numColors++] = resource.object;
+		}
+	}
+	if (!hasAttachments) {
+		return;
+	}
+	if (!imported) {
+		framebuffer.fbo = m_pool.getFramebuffer(framebuffer.colorBuffers, numColors, framebuffer.depthBuffer);
+	}
+	pass.framebuffer = framebuffer;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
+	glViewport(0, 0, framebuffer.width, framebuffer.height);
+	if (pass.clearMask != 0) {
+		glClearColor(pass.clearColor.x, pass.clearColor.y, pass.clearColor.z, pass.clearColor.w);
+		glClear(pass.clearMask);
+	}
+}
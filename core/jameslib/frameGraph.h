@@ -0,0 +1,131 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "renderTargetPool.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace jameslib
+{
+	typedef uint32_t FrameGraphResource;
+	typedef uint32_t FrameGraphPass;
+
+	//How a pass touches a resource
+	enum class FrameGraphAccess
+	{
+		SAMPLED, //Read through a sampler
+		ATTACHMENT, //Rendered to. Color or depth attachment depending on the format.
+		STORAGE, //Image or shader storage load/store, e.g. from a compute shader
+		CUSTOM //Handled by the pass itself, e.g. a texture it makes with a helper and publishes with setTexture
+	};
+
+	struct FrameGraphTiming
+	{
+		std::string name;
+		float cpuMs = 0.0f; //Smoothed over recent frames, from the pass's profiler zone
+		float gpuMs = 0.0f;
+		bool culled = false;
+	};
+
+	//Passes declare the resources they read and write, then compile culls every pass that does not
+	//contribute to an output, works out when each transient texture is first and last used, and which
+	//memory barriers each pass needs. execute runs the survivors in declaration order: transients come
+	//from a RenderTargetPool just before their first use and go back after their last, so targets whose
+	//lifetimes don't overlap alias. Every writer of a resource stays alive while anything reads it.
+	//Declare the graph again every frame after reset; pass callbacks capture what they need by reference.
+	class FrameGraph
+	{
+	public:
+		explicit FrameGraph(RenderTargetPool& pool);
+		FrameGraph(const FrameGraph&) = delete;
+		FrameGraph& operator=(const FrameGraph&) = delete;
+
+		//Drops the previous frame's passes and resources
+		void reset();
+
+		FrameGraphResource createTexture(const char* name, unsigned int width, unsigned int height, int format);
+		//Resources owned elsewhere. The graph never acquires or releases them.
+		FrameGraphResource importTexture(const char* name, unsigned int texture, unsigned int width, unsigned int height);
+		FrameGraphResource importBuffer(const char* name, unsigned int buffer);
+		//Attachment writes bind the imported fbo as is. Use a Framebuffer with fbo 0 for the window.
+		FrameGraphResource importFramebuffer(const char* name, const Framebuffer& framebuffer);
+		//Passes that write an output are never culled
+		void markOutput(FrameGraphResource resource);
+
+		FrameGraphPass addPass(const char* name, std::function<void()> execute);
+		void read(FrameGraphPass pass, FrameGraphResource resource, FrameGraphAccess access = FrameGraphAccess::SAMPLED);
+		void write(FrameGraphPass pass, FrameGraphResource resource, FrameGraphAccess access = FrameGraphAccess::ATTACHMENT);
+		//Cleared once the pass's attachments are bound
+		void setClear(FrameGraphPass pass, const glm::vec4& color, bool clearColor, bool clearDepth);
+
+		void compile();
+		//Binds each pass's attachments and viewport before calling it. Leaves the last pass's framebuffer bound.
+		//Each pass is timed in a GPU profiler zone named after it, so call this outside any other GPU zone.
+		void execute();
+
+		//Valid during execute while the resource is alive
+		unsigned int getTexture(FrameGraphResource resource)const;
+		void setTexture(FrameGraphResource resource, unsigned int texture);
+		//The attachments a pass renders to, valid during execute while they are alive
+		Framebuffer getFramebuffer(FrameGraphPass pass)const;
+
+		//One entry per pass of the last executed frame, in declaration order
+		inline const std::vector<FrameGraphTiming>& getTimings()const { return m_frameTimings; }
+		inline size_t getNumPasses()const { return m_passes.size(); }
+		inline size_t getNumCulledPasses()const { return m_numCulled; }
+		inline size_t getNumBarriers()const { return m_numBarriers; }
+	private:
+		enum class ResourceType
+		{
+			TRANSIENT,
+			TEXTURE,
+			BUFFER,
+			FRAMEBUFFER
+		};
+		struct Resource
+		{
+			std::string name;
+			ResourceType type;
+			unsigned int width;
+			unsigned int height;
+			int format;
+			unsigned int object; //Texture or buffer
+			unsigned int fbo;
+			bool output;
+			//Compile results
+			uint32_t numReaders;
+			int firstPass;
+			int lastPass;
+		};
+		struct Access
+		{
+			FrameGraphResource resource;
+			FrameGraphAccess access;
+			bool write;
+		};
+		struct Pass
+		{
+			std::string name;
+			std::function<void()> execute;
+			std::vector<Access> accesses;
+			glm::vec4 clearColor;
+			unsigned int clearMask;
+			//Compile results
+			bool culled;
+			uint32_t numWrites;
+			unsigned int barrierBits;
+			Framebuffer framebuffer;
+		};
+		void bindAttachments(Pass& pass);
+
+		RenderTargetPool& m_pool;
+		std::vector<Resource> m_resources;
+		std::vector<Pass> m_passes;
+		size_t m_numCulled = 0;
+		size_t m_numBarriers = 0;
+		std::vector<FrameGraphTiming> m_frameTimings;
+	};
+}
@@ -0,0 +1,66 @@
+#include "frameUniforms.h"
+#include <string.h>
+
+jameslib::FrameUniforms jameslib::createFrameUniforms()
+{
+	FrameUniforms frameUniforms;
+	frameUniforms.currentRegion = 0;
+
+	//Each region must start on a valid glBindBufferRange offset
+	int alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	frameUniforms.regionSize = (sizeof(FrameData) + alignment - 1) / alignment * alignment;
+
+	GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers(1, &frameUniforms.buffer);
+	glNamedBufferStorage(frameUniforms.buffer, frameUniforms.regionSize * FRAME_UNIFORM_REGIONS, NULL, flags);
+	frameUniforms.mapped = (unsigned char*)glMapNamedBufferRange(frameUniforms.buffer, 0, frameUniforms.regionSize * FRAME_UNIFORM_REGIONS, flags);
+
+	for (size_t i = 0; i < FRAME_UNIFORM_REGIONS; i++)
+	{
+		frameUniforms.fences[i] = 0;
+	}
+	return frameUniforms;
+}
+
+void jameslib::writeFrameUniforms(FrameUniforms& frameUniforms, const FrameData& data)
+{
+	frameUniforms.currentRegion = (frameUniforms.currentRegion + 1) % FRAME_UNIFORM_REGIONS;
+	unsigned int region = frameUniforms.currentRegion;
+
+	//Only blocks if the GPU is still reading this region from FRAME_UNIFORM_REGIONS frames ago
+	GLsync& fence = frameUniforms.fences[region];
+	if (fence) {
+		while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+		glDeleteSync(fence);
+		fence = 0;
+	}
+
+	unsigned int offset = region * frameUniforms.regionSize;
+	memcpy(frameUniforms.mapped + offset, &data, sizeof(FrameData));
+	glBindBufferRange(GL_UNIFORM_BUFFER, FRAME_DATA_BINDING, frameUniforms.buffer, offset, sizeof(FrameData));
+}
+
+void jameslib::fenceFrameUniforms(FrameUniforms& frameUniforms)
+{
+	GLsync& fence = frameUniforms.fences[frameUniforms.currentRegion];
+	if (fence) {
+		glDeleteSync(fence);
+	}
+	fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void jameslib::destroyFrameUniforms(FrameUniforms& frameUniforms)
+{
+	for (size_t i = 0; i < FRAME_UNIFORM_REGIONS; i++)
+	{
+		if (frameUniforms.fences[i]) {
+			glDeleteSync(frameUniforms.fences[i]);
+			frameUniforms.fences[i] = 0;
+		}
+	}
+	glUnmapNamedBuffer(frameUniforms.buffer);
+	glDeleteBuffers(1, &frameUniforms.buffer);
+	frameUniforms.buffer = 0;
+	frameUniforms.mapped = nullptr;
+}
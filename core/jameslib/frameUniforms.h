@@ -0,0 +1,42 @@
+#pragma once
+
+#include "../ew/external/glad.h"
+#include "shadowCascades.h"
+#include <glm/glm.hpp>
+
+namespace jameslib
+{
+	//Fixed uniform block binding points shared by every shader in assets/
+	const unsigned int FRAME_DATA_BINDING = 0;
+
+	//Number of frames the CPU may run ahead of the GPU before writes have to wait
+	const unsigned int FRAME_UNIFORM_REGIONS = 3;
+
+	//std140 mirror of the FrameData uniform block. vec3s are padded to vec4 unless a scalar follows.
+	struct FrameData
+	{
+		glm::mat4 viewProjection;
+		glm::mat4 cascadeViewProj[MAX_SHADOW_CASCADES];
+		glm::vec4 cascadeSplits; //View space far distance of each cascade
+		glm::vec4 eyePos;
+		glm::vec4 viewForward;
+		glm::vec3 lightDirection;
+		int numCascades;
+	};
+
+	//Persistently mapped ring of FrameData regions. Each frame writes the next region
+	//once and binds it to FRAME_DATA_BINDING for every pass.
+	struct FrameUniforms
+	{
+		unsigned int buffer;
+		unsigned char* mapped;
+		unsigned int regionSize;
+		unsigned int currentRegion;
+		GLsync fences[FRAME_UNIFORM_REGIONS];
+	};
+
+	FrameUniforms createFrameUniforms();
+	void writeFrameUniforms(FrameUniforms& frameUniforms, const FrameData& data);
+	void fenceFrameUniforms(FrameUniforms& frameUniforms);
+	void destroyFrameUniforms(FrameUniforms& frameUniforms);
+}
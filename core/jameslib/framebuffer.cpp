@@ -1,7 +1,29 @@
 #include "framebuffer.h"
 #include <stdio.h>
 
-jameslib::Framebuffer jameslib::createFramebuffer(unsigned int width, unsigned int height, int colorFormat)
+namespace
+{
+	struct GBufferTarget
+	{
+		int format;
+		unsigned int bytesPerPixel;
+	};
+	const GBufferTarget WIDE_TARGETS[3] = {
+		{ GL_RGB32F, 12 }, //0 = World Position
+		{ GL_RGB16F, 6 }, //1 = World Normal
+		{ GL_RGB16F, 6 } //2 = Albedo
+	};
+	const GBufferTarget COMPACT_TARGETS[3] = {
+		{ GL_RG16, 4 }, //0 = Octahedral World Normal
+		{ GL_RGBA8, 4 }, //1 = Albedo
+		{ GL_RGBA8, 4 } //2 = Material
+	};
+	//Position is reconstructed from depth, so it needs more than 16 bits. 24 bit depth is stored as 32.
+	const int DEPTH_FORMAT = GL_DEPTH_COMPONENT24;
+	const unsigned int DEPTH_BYTES_PER_PIXEL = 4;
+}
+
+jameslib::Framebuffer jameslib::createFramebuffer(unsigned int width, unsigned int height, int colorFormat, bool withDepth)
 {
 	Framebuffer buffer;
 	buffer.width = width;
@@ -15,10 +37,12 @@ jameslib::Framebuffer jameslib::createFramebuffer(unsigned int width, unsigned i
 	glTexStorage2D(GL_TEXTURE_2D, 1, colorFormat, width, height);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, buffer.colorBuffers[0], 0);
 
-	glGenTextures(1, &buffer.depthBuffer);
-	glBindTexture(GL_TEXTURE_2D, buffer.depthBuffer);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, width, height);
-	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, buffer.depthBuffer, 0);
+	if (withDepth) {
+		glGenTextures(1, &buffer.depthBuffer);
+		glBindTexture(GL_TEXTURE_2D, buffer.depthBuffer);
+		glTexStorage2D(GL_TEXTURE_2D, 1, DEPTH_FORMAT, width, height);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, buffer.depthBuffer, 0);
+	}
 
 	GLenum fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
 	if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
@@ -28,7 +52,46 @@ jameslib::Framebuffer jameslib::createFramebuffer(unsigned int width, unsigned i
 	return buffer;
 }
 
-jameslib::Framebuffer jameslib::createGBuffer(unsigned int width, unsigned int height)
+jameslib::Framebuffer jameslib::createDepthFramebuffer(unsigned int width, unsigned int height, unsigned int layers)
+{
+	Framebuffer buffer;
+	buffer.width = width;
+	buffer.height = height;
+	buffer.layers = layers;
+
+	GLenum target = layers > 1 ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+	glCreateTextures(target, 1, &buffer.depthBuffer);
+	if (layers > 1) {
+		glTextureStorage3D(buffer.depthBuffer, 1, DEPTH_FORMAT, width, height, layers);
+	}
+	else {
+		glTextureStorage2D(buffer.depthBuffer, 1, DEPTH_FORMAT, width, height);
+	}
+	const float border[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	glTextureParameteri(buffer.depthBuffer, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+	glTextureParameteri(buffer.depthBuffer, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+	glTextureParameterfv(buffer.depthBuffer, GL_TEXTURE_BORDER_COLOR, border);
+	glTextureParameteri(buffer.depthBuffer, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTextureParameteri(buffer.depthBuffer, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+	glCreateFramebuffers(1, &buffer.fbo);
+	if (layers > 1) {
+		glNamedFramebufferTextureLayer(buffer.fbo, GL_DEPTH_ATTACHMENT, buffer.depthBuffer, 0, 0);
+	}
+	else {
+		glNamedFramebufferTexture(buffer.fbo, GL_DEPTH_ATTACHMENT, buffer.depthBuffer, 0);
+	}
+	glNamedFramebufferDrawBuffer(buffer.fbo, GL_NONE);
+	glNamedFramebufferReadBuffer(buffer.fbo, GL_NONE);
+
+	GLenum fboStatus = glCheckNamedFramebufferStatus(buffer.fbo, GL_FRAMEBUFFER);
+	if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+		printf("Framebuffer incomplete: %d", fboStatus);
+	}
+	return buffer;
+}
+
+jameslib::Framebuffer jameslib::createGBuffer(unsigned int width, unsigned int height, GBufferLayout layout)
 {
 	Framebuffer framebuffer;
 	framebuffer.width = width;
@@ -37,17 +100,12 @@ jameslib::Framebuffer jameslib::createGBuffer(unsigned int width, unsigned int h
 	glCreateFramebuffers(1, &framebuffer.fbo);
 	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer.fbo);
 
-	int formats[3] = {
-		GL_RGB32F, //0 = World Position 
-		GL_RGB16F, //1 = World Normal
-		GL_RGB16F  //2 = Albedo
-	};
-
+	const GBufferTarget* targets = layout == GBufferLayout::COMPACT ? COMPACT_TARGETS : WIDE_TARGETS;
 	for (size_t i = 0; i < 3; i++)
 	{
 		glGenTextures(1, &framebuffer.colorBuffers[i]);
 		glBindTexture(GL_TEXTURE_2D, framebuffer.colorBuffers[i]);
-		glTexStorage2D(GL_TEXTURE_2D, 1, formats[i], width, height);
+		glTexStorage2D(GL_TEXTURE_2D, 1, targets[i].format, width, height);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -63,7 +121,7 @@ jameslib::Framebuffer jameslib::createGBuffer(unsigned int width, unsigned int h
 
 	glGenTextures(1, &framebuffer.depthBuffer);
 	glBindTexture(GL_TEXTURE_2D, framebuffer.depthBuffer);
-	glTexStorage2D(GL_TEXTURE_2D, 1, GL_DEPTH_COMPONENT16, width, height);
+	glTexStorage2D(GL_TEXTURE_2D, 1, DEPTH_FORMAT, width, height);
 	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, framebuffer.depthBuffer, 0);
 
 	GLenum fboStatus = glCheckFramebufferStatus(GL_FRAMEBUFFER);
@@ -75,4 +133,88 @@ jameslib::Framebuffer jameslib::createGBuffer(unsigned int width, unsigned int h
 	glBindTexture(GL_TEXTURE_2D, 0);
 	glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	return framebuffer;
-}
\ No newline at end of file
+}
+
+void jameslib::destroyFramebuffer(Framebuffer& framebuffer)
+{
+	glDeleteFramebuffers(1, &framebuffer.fbo);
+	for (size_t i = 0; i < 8; i++)
+	{
+		if (framebuffer.colorBuffers[i]) {
+			glDeleteTextures(1, &framebuffer.colorBuffers[i]);
+		}
+	}
+	if (framebuffer.depthBuffer) {
+		glDeleteTextures(1, &framebuffer.depthBuffer);
+	}
+	framebuffer = Framebuffer();
+}
+
+unsigned int jameslib::getGBufferBytesPerPixel(GBufferLayout layout)
+{
+	const GBufferTarget* targets = layout == GBufferLayout::COMPACT ? COMPACT_TARGETS : WIDE_TARGETS;
+	unsigned int bytes = DEPTH_BYTES_PER_PIXEL;
+	for (size_t i = 0; i < 3; i++)
+	{
+		bytes += targets[i].bytesPerPixel;
+	}
+	return bytes;
+}
+
+jameslib::FramebufferDesc jameslib::getGBufferDesc(unsigned int width, unsigned int height, GBufferLayout layout)
+{
+	const GBufferTarget* targets = layout == GBufferLayout::COMPACT ? COMPACT_TARGETS : WIDE_TARGETS;
+	FramebufferDesc desc;
+	desc.width = width;
+	desc.height = height;
+	desc.numColorBuffers = 3;
+	for (size_t i = 0; i < 3; i++)
+	{
+		desc.colorFormats[i] = targets[i].format;
+	}
+	desc.depthFormat = DEPTH_FORMAT;
+	return desc;
+}
+
+unsigned int jameslib::getFormatBytesPerPixel(int format)
+{
+	switch (format)
+	{
+	case GL_R8:
+		return 1;
+	case GL_RG8:
+	case GL_R16F:
+	case GL_DEPTH_COMPONENT16:
+		return 2;
+	case GL_RGB8:
+		return 3;
+	case GL_RGBA8:
+	case GL_RG16:
+	case GL_RG16F:
+	case GL_R32F:
+	case GL_R11F_G11F_B10F:
+	case GL_RGB10_A2:
+	case GL_DEPTH_COMPONENT24:
+	case GL_DEPTH_COMPONENT32F:
+	case GL_DEPTH24_STENCIL8:
+		return 4;
+	case GL_RGB16F:
+		return 6;
+	case GL_RGBA16F:
+	case GL_RG32F:
+	case GL_DEPTH32F_STENCIL8:
+		return 8;
+	case GL_RGB32F:
+		return 12;
+	case GL_RGBA32F:
+		return 16;
+	default:
+		return 4;
+	}
+}
+
+bool jameslib::isDepthFormat(int format)
+{
+	return format == GL_DEPTH_COMPONENT16 || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT32F
+		|| format == GL_DEPTH24_STENCIL8 || format == GL_DEPTH32F_STENCIL8;
+}
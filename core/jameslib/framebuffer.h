@@ -6,13 +6,46 @@ namespace jameslib
 {
 	struct Framebuffer
 	{
-		unsigned int fbo;
-		unsigned int colorBuffers[8];
-		unsigned int depthBuffer;
-		unsigned int width;
-		unsigned int height;
+		unsigned int fbo = 0;
+		unsigned int colorBuffers[8] = {};
+		unsigned int depthBuffer = 0;
+		unsigned int width = 0;
+		unsigned int height = 0;
+		unsigned int layers = 1; //Depth framebuffers with more than one layer use a 2D array texture
 	};
 
-	Framebuffer createFramebuffer(unsigned int width, unsigned int height, int colorFormat);
-	Framebuffer createGBuffer(unsigned int width, unsigned int height);
+	//WIDE stores world position RGB32F, normal RGB16F and albedo RGB16F.
+	//COMPACT reconstructs position from depth and stores an octahedral RG16 normal,
+	//RGBA8 albedo and RGBA8 material params (ka, kd, ks, log2(shininess) / 10).
+	//Shaders select the matching layout with the GBUFFER_COMPACT define.
+	enum class GBufferLayout
+	{
+		WIDE,
+		COMPACT
+	};
+
+	//Size and attachment formats of a framebuffer, used to request targets from a RenderTargetPool.
+	//A depthFormat of 0 means no depth attachment.
+	struct FramebufferDesc
+	{
+		unsigned int width = 0;
+		unsigned int height = 0;
+		int colorFormats[8] = {};
+		unsigned int numColorBuffers = 0;
+		int depthFormat = 0;
+	};
+
+	Framebuffer createFramebuffer(unsigned int width, unsigned int height, int colorFormat, bool withDepth = true);
+	//No color attachment. Layered targets attach layer 0, select others with glNamedFramebufferTextureLayer.
+	//Depth reads as 1 outside the map so everything past the edges is lit.
+	Framebuffer createDepthFramebuffer(unsigned int width, unsigned int height, unsigned int layers = 1);
+	Framebuffer createGBuffer(unsigned int width, unsigned int height, GBufferLayout layout = GBufferLayout::COMPACT);
+	void destroyFramebuffer(Framebuffer& framebuffer);
+	//Same attachments as createGBuffer
+	FramebufferDesc getGBufferDesc(unsigned int width, unsigned int height, GBufferLayout layout);
+	//Nominal storage per pixel including depth, before any driver padding
+	unsigned int getGBufferBytesPerPixel(GBufferLayout layout);
+	//Nominal storage per pixel of a sized internal format, before any driver padding
+	unsigned int getFormatBytesPerPixel(int format);
+	bool isDepthFormat(int format);
 }
\ No newline at end of file
@@ -0,0 +1,209 @@
+#include "geometryArena.h"
+#include "../ew/external/glad.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <iterator>
+
+jameslib::RangeAllocator::RangeAllocator(size_t capacity)
+	: m_capacity(capacity), m_used(0)
+{
+	if (capacity > 0) {
+		m_freeRanges[0] = capacity;
+	}
+}
+
+bool jameslib::RangeAllocator::allocate(size_t size, size_t* offset)
+{
+	for (auto it = m_freeRanges.begin(); it != m_freeRanges.end(); ++it)
+	{
+		if (it->second < size) {
+			continue;
+		}
+		*offset = it->first;
+		size_t remaining = it->second - size;
+		m_freeRanges.erase(it);
+		if (remaining > 0) {
+			m_freeRanges[*offset + size] = remaining;
+		}
+		m_used += size;
+		return true;
+	}
+	return false;
+}
+
+void jameslib::RangeAllocator::free(size_t offset, size_t size)
+{
+	if (size == 0) {
+		return;
+	}
+	m_used -= size;
+	auto it = m_freeRanges.emplace(offset, size).first;
+
+	//Merge with the following range
+	auto next = std::next(it);
+	if (next != m_freeRanges.end() && it->first + it->second == next->first) {
+		it->second += next->second;
+		m_freeRanges.erase(next);
+	}
+	//Merge with the preceding range
+	if (it != m_freeRanges.begin()) {
+		auto prev = std::prev(it);
+		if (prev->first + prev->second == it->first) {
+			prev->second += it->second;
+			m_freeRanges.erase(it);
+		}
+	}
+}
+
+jameslib::GeometryArena::GeometryArena(size_t maxVertices, size_t maxIndices)
+	: m_vertexAllocator(maxVertices), m_indexAllocator(maxIndices)
+{
+	glCreateBuffers(1, &m_vbo);
+	glNamedBufferStorage(m_vbo, sizeof(ew::Vertex) * maxVertices, NULL, GL_DYNAMIC_STORAGE_BIT);
+	glCreateBuffers(1, &m_ebo);
+	glNamedBufferStorage(m_ebo, sizeof(unsigned int) * maxIndices, NULL, GL_DYNAMIC_STORAGE_BIT);
+
+	glCreateVertexArrays(1, &m_vao);
+	glVertexArrayVertexBuffer(m_vao, 0, m_vbo, 0, sizeof(ew::Vertex));
+	glVertexArrayElementBuffer(m_vao, m_ebo);
+
+	//Position, normal, UV
+	glVertexArrayAttribFormat(m_vao, 0, 3, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, pos));
+	glVertexArrayAttribFormat(m_vao, 1, 3, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, normal));
+	glVertexArrayAttribFormat(m_vao, 2, 2, GL_FLOAT, GL_FALSE, offsetof(ew::Vertex, uv));
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		glVertexArrayAttribBinding(m_vao, i, 0);
+		glEnableVertexArrayAttrib(m_vao, i);
+	}
+
+	//Per-instance model matrix, one vec4 column per location. Left disabled so ordinary draws of
+	//arena backed meshes read the constant set by ew::setModelMatrix.
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		glVertexArrayAttribFormat(m_vao, ew::VERTEX_ATTRIB_MODEL + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * i);
+		glVertexArrayAttribBinding(m_vao, ew::VERTEX_ATTRIB_MODEL + i, ew::VERTEX_BINDING_INSTANCES);
+	}
+	glVertexArrayBindingDivisor(m_vao, ew::VERTEX_BINDING_INSTANCES, 1);
+}
+
+jameslib::GeometryArena::~GeometryArena()
+{
+	glDeleteVertexArrays(1, &m_vao);
+	glDeleteBuffers(1, &m_vbo);
+	glDeleteBuffers(1, &m_ebo);
+}
+
+bool jameslib::GeometryArena::allocate(const ew::MeshData& meshData, ArenaMesh* mesh)
+{
+	return allocate(meshData.vertices.data(), meshData.vertices.size(), meshData.indices.data(), meshData.indices.size(), mesh);
+}
+
+bool jameslib::GeometryArena::allocate(const ew::Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, ArenaMesh* mesh)
+{
+	size_t baseVertex, firstIndex;
+	if (!m_vertexAllocator.allocate(numVertices, &baseVertex)) {
+		printf("Geometry arena out of vertex space\n");
+		return false;
+	}
+	if (!m_indexAllocator.allocate(numIndices, &firstIndex)) {
+		printf("Geometry arena out of index space\n");
+		m_vertexAllocator.free(baseVertex, numVertices);
+		return false;
+	}
+	mesh->baseVertex = (unsigned int)baseVertex;
+	mesh->numVertices = (unsigned int)numVertices;
+	mesh->firstIndex = (unsigned int)firstIndex;
+	mesh->numIndices = (unsigned int)numIndices;
+
+	if (numVertices > 0) {
+		glNamedBufferSubData(m_vbo, sizeof(ew::Vertex) * baseVertex, sizeof(ew::Vertex) * numVertices, vertices);
+	}
+	if (numIndices > 0) {
+		glNamedBufferSubData(m_ebo, sizeof(unsigned int) * firstIndex, sizeof(unsigned int) * numIndices, indices);
+	}
+	return true;
+}
+
+void jameslib::GeometryArena::free(const ArenaMesh& mesh)
+{
+	m_vertexAllocator.free(mesh.baseVertex, mesh.numVertices);
+	m_indexAllocator.free(mesh.firstIndex, mesh.numIndices);
+}
+
+jameslib::DrawBatch::DrawBatch()
+{
+	glCreateBuffers(1, &m_indirectBuffer);
+	glCreateBuffers(1, &m_instanceBuffer);
+}
+
+jameslib::DrawBatch::~DrawBatch()
+{
+	glDeleteBuffers(1, &m_indirectBuffer);
+	glDeleteBuffers(1, &m_instanceBuffer);
+}
+
+void jameslib::DrawBatch::clear()
+{
+	m_commands.clear();
+	m_modelMatrices.clear();
+}
+
+void jameslib::DrawBatch::add(const ArenaMesh& mesh, const glm::mat4& modelMatrix)
+{
+	DrawElementsIndirectCommand command;
+	command.count = mesh.numIndices;
+	command.instanceCount = 1;
+	command.firstIndex = mesh.firstIndex;
+	command.baseVertex = (int)mesh.baseVertex;
+	//Selects this draw's model matrix from the instance stream
+	command.baseInstance = (unsigned int)m_modelMatrices.size();
+	m_commands.push_back(command);
+	m_modelMatrices.push_back(modelMatrix);
+}
+
+void jameslib::DrawBatch::add(const ew::Mesh& mesh, const glm::mat4& modelMatrix)
+{
+	ArenaMesh range;
+	range.baseVertex = mesh.getBaseVertex();
+	range.numVertices = (unsigned int)mesh.getNumVertices();
+	range.firstIndex = mesh.getFirstIndex();
+	range.numIndices = (unsigned int)mesh.getNumIndices();
+	add(range, modelMatrix);
+}
+
+void jameslib::DrawBatch::draw(const GeometryArena& arena)
+{
+	if (m_commands.empty()) {
+		return;
+	}
+	//Grow by doubling so steady state frames only re-upload
+	if (m_commands.size() > m_capacity) {
+		m_capacity = m_capacity == 0 ? 64 : m_capacity;
+		while (m_capacity < m_commands.size()) {
+			m_capacity *= 2;
+		}
+		glNamedBufferData(m_indirectBuffer, sizeof(DrawElementsIndirectCommand) * m_capacity, NULL, GL_DYNAMIC_DRAW);
+		glNamedBufferData(m_instanceBuffer, sizeof(glm::mat4) * m_capacity, NULL, GL_DYNAMIC_DRAW);
+	}
+	glNamedBufferSubData(m_indirectBuffer, 0, sizeof(DrawElementsIndirectCommand) * m_commands.size(), m_commands.data());
+	glNamedBufferSubData(m_instanceBuffer, 0, sizeof(glm::mat4) * m_modelMatrices.size(), m_modelMatrices.data());
+
+	//Arena vertices are always full floats
+	glVertexAttrib3f(ew::VERTEX_ATTRIB_POS_OFFSET, 0.0f, 0.0f, 0.0f);
+	glVertexAttrib3f(ew::VERTEX_ATTRIB_POS_SCALE, 1.0f, 1.0f, 1.0f);
+	glVertexArrayVertexBuffer(arena.getVAO(), ew::VERTEX_BINDING_INSTANCES, m_instanceBuffer, 0, sizeof(glm::mat4));
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		glEnableVertexArrayAttrib(arena.getVAO(), ew::VERTEX_ATTRIB_MODEL + i);
+	}
+	glBindVertexArray(arena.getVAO());
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+	glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, NULL, (GLsizei)m_commands.size(), 0);
+	glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+	//Back to the constant _Model for ordinary draws of arena backed meshes
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		glDisableVertexArrayAttrib(arena.getVAO(), ew::VERTEX_ATTRIB_MODEL + i);
+	}
+}
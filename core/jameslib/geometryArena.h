@@ -0,0 +1,92 @@
+#pragma once
+
+#include "../ew/mesh.h"
+#include <glm/glm.hpp>
+#include <map>
+#include <vector>
+
+namespace jameslib
+{
+	//First-fit sub-allocator over a range of elements. Freed ranges are merged with their neighbours.
+	class RangeAllocator
+	{
+	public:
+		RangeAllocator(size_t capacity = 0);
+		bool allocate(size_t size, size_t* offset);
+		void free(size_t offset, size_t size);
+		inline size_t getCapacity()const { return m_capacity; }
+		inline size_t getUsed()const { return m_used; }
+	private:
+		std::map<size_t, size_t> m_freeRanges; //offset -> size
+		size_t m_capacity;
+		size_t m_used;
+	};
+
+	//Where a mesh lives inside a GeometryArena. Indices are relative to baseVertex.
+	struct ArenaMesh
+	{
+		unsigned int baseVertex = 0;
+		unsigned int numVertices = 0;
+		unsigned int firstIndex = 0;
+		unsigned int numIndices = 0;
+	};
+
+	//Matches the layout glMultiDrawElementsIndirect expects
+	struct DrawElementsIndirectCommand
+	{
+		unsigned int count;
+		unsigned int instanceCount;
+		unsigned int firstIndex;
+		int baseVertex;
+		unsigned int baseInstance;
+	};
+
+	//One vertex buffer, one index buffer and one VAO shared by every mesh allocated from it.
+	//ew::Mesh and ew::Model can live here too, see Mesh::load and Model::setGeometryArena.
+	//Attribute locations 0-2 match ew::Vertex. Locations 3-6 are the same per-instance mat4 stream
+	//as ew::Mesh::drawInstanced, only enabled while an instanced or batched draw reads them.
+	class GeometryArena
+	{
+	public:
+		GeometryArena(size_t maxVertices, size_t maxIndices);
+		~GeometryArena();
+		GeometryArena(const GeometryArena&) = delete;
+		GeometryArena& operator=(const GeometryArena&) = delete;
+
+		bool allocate(const ew::MeshData& meshData, ArenaMesh* mesh);
+		bool allocate(const ew::Vertex* vertices, size_t numVertices, const unsigned int* indices, size_t numIndices, ArenaMesh* mesh);
+		void free(const ArenaMesh& mesh);
+		inline unsigned int getVAO()const { return m_vao; }
+		inline const RangeAllocator& getVertexAllocator()const { return m_vertexAllocator; }
+		inline const RangeAllocator& getIndexAllocator()const { return m_indexAllocator; }
+	private:
+		RangeAllocator m_vertexAllocator;
+		RangeAllocator m_indexAllocator;
+		unsigned int m_vao = 0;
+		unsigned int m_vbo = 0;
+		unsigned int m_ebo = 0;
+	};
+
+	//Collects arena draws for one pass and submits them with a single glMultiDrawElementsIndirect
+	class DrawBatch
+	{
+	public:
+		DrawBatch();
+		~DrawBatch();
+		DrawBatch(const DrawBatch&) = delete;
+		DrawBatch& operator=(const DrawBatch&) = delete;
+
+		void clear();
+		void add(const ArenaMesh& mesh, const glm::mat4& modelMatrix);
+		//mesh must be arena backed, see ew::Mesh::getArena
+		void add(const ew::Mesh& mesh, const glm::mat4& modelMatrix);
+		void draw(const GeometryArena& arena);
+		inline size_t getNumDraws()const { return m_commands.size(); }
+	private:
+		std::vector<DrawElementsIndirectCommand> m_commands;
+		std::vector<glm::mat4> m_modelMatrices;
+		unsigned int m_indirectBuffer = 0;
+		unsigned int m_instanceBuffer = 0;
+		size_t m_capacity = 0;
+	};
+}
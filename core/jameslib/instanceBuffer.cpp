@@ -0,0 +1,39 @@
+#include "instanceBuffer.h"
+#include "../ew/external/glad.h"
+
+jameslib::InstanceBuffer::InstanceBuffer()
+{
+	glCreateBuffers(1, &m_buffer);
+}
+
+jameslib::InstanceBuffer::~InstanceBuffer()
+{
+	glDeleteBuffers(1, &m_buffer);
+}
+
+void jameslib::InstanceBuffer::upload(const glm::mat4* modelMatrices, size_t count)
+{
+	m_count = count;
+	if (count == 0) {
+		return;
+	}
+	//Grow by doubling, otherwise orphan at the same size
+	if (count > m_capacity) {
+		m_capacity = m_capacity == 0 ? 64 : m_capacity;
+		while (m_capacity < count) {
+			m_capacity *= 2;
+		}
+	}
+	glNamedBufferData(m_buffer, sizeof(glm::mat4) * m_capacity, NULL, GL_STREAM_DRAW);
+	glNamedBufferSubData(m_buffer, 0, sizeof(glm::mat4) * count, modelMatrices);
+}
+
+void jameslib::InstanceBuffer::upload(const ew::Transform* transforms, size_t count)
+{
+	m_scratch.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		m_scratch[i] = transforms[i].modelMatrix();
+	}
+	upload(m_scratch.data(), count);
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "../ew/transform.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+namespace jameslib
+{
+	//GPU array of model matrices for ew::Mesh::drawInstanced / ew::Model::drawInstanced.
+	//The same buffer can be bound as an SSBO by shaders that want to index it themselves.
+	class InstanceBuffer
+	{
+	public:
+		InstanceBuffer();
+		~InstanceBuffer();
+		InstanceBuffer(const InstanceBuffer&) = delete;
+		InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+
+		//Replaces the contents. The previous storage is orphaned so in-flight draws never stall the upload.
+		void upload(const glm::mat4* modelMatrices, size_t count);
+		void upload(const ew::Transform* transforms, size_t count);
+		inline unsigned int getBuffer()const { return m_buffer; }
+		inline int getCount()const { return (int)m_count; }
+	private:
+		unsigned int m_buffer = 0;
+		size_t m_count = 0;
+		size_t m_capacity = 0;
+		std::vector<glm::mat4> m_scratch;
+	};
+}
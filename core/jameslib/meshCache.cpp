@@ -0,0 +1,262 @@
+#include "meshCache.h"
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+std::string jameslib::getMeshCachePath(const std::string& sourcePath)
+{
+	return sourcePath + ".ewmesh";
+}
+
+uint64_t jameslib::getFileSize(const std::string& filePath)
+{
+	struct stat info;
+	if (stat(filePath.c_str(), &info) != 0) {
+		return 0;
+	}
+	return (uint64_t)info.st_size;
+}
+
+uint64_t jameslib::getFileModifiedTime(const std::string& filePath)
+{
+	struct stat info;
+	if (stat(filePath.c_str(), &info) != 0) {
+		return 0;
+	}
+#if defined(_WIN32)
+	return (uint64_t)info.st_mtime * 1000000000ull;
+#elif defined(__APPLE__)
+	return (uint64_t)info.st_mtimespec.tv_sec * 1000000000ull + (uint64_t)info.st_mtimespec.tv_nsec;
+#else
+	return (uint64_t)info.st_mtim.tv_sec * 1000000000ull + (uint64_t)info.st_mtim.tv_nsec;
+#endif
+}
+
+uint64_t jameslib::getFileHash(const std::string& filePath)
+{
+	FILE* file = fopen(filePath.c_str(), "rb");
+	if (file == NULL) {
+		return 0;
+	}
+	uint64_t hash = 14695981039346656037ull;
+	unsigned char buffer[65536];
+	size_t length;
+	while ((length = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+		for (size_t i = 0; i < length; i++)
+		{
+			hash ^= buffer[i];
+			hash *= 1099511628211ull;
+		}
+	}
+	fclose(file);
+	return hash;
+}
+
+bool jameslib::writeMeshCache(const std::string& cachePath, const std::vector<ew::MeshData>& meshes, const std::string& sourcePath)
+{
+	return writeMeshCache(cachePath, std::vector<std::vector<ew::MeshData>>(1, meshes), sourcePath);
+}
+
+bool jameslib::writeMeshCache(const std::string& cachePath, const std::vector<std::vector<ew::MeshData>>& lods, const std::string& sourcePath)
+{
+	//Level-major, matching the submesh table
+	std::vector<const ew::MeshData*> meshes;
+	for (size_t level = 0; level < lods.size(); level++)
+	{
+		for (size_t i = 0; i < lods[level].size(); i++)
+		{
+			meshes.push_back(&lods[level][i]);
+		}
+	}
+	MeshCacheHeader header;
+	memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(header.magic));
+	header.version = MESH_CACHE_VERSION;
+	header.vertexStride = sizeof(ew::Vertex);
+	header.numSubmeshes = lods.empty() ? 0 : (uint32_t)lods[0].size();
+	header.numLods = lods.empty() ? 1 : (uint32_t)lods.size();
+	header.padding = 0;
+	header.numVertices = 0;
+	header.numIndices = 0;
+	header.sourceSize = getFileSize(sourcePath);
+	header.sourceTime = getFileModifiedTime(sourcePath);
+	header.sourceHash = getFileHash(sourcePath);
+
+	std::vector<MeshCacheSubmesh> submeshes(meshes.size());
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		submeshes[i].firstVertex = (uint32_t)header.numVertices;
+		submeshes[i].numVertices = (uint32_t)meshes[i]->vertices.size();
+		submeshes[i].firstIndex = (uint32_t)header.numIndices;
+		submeshes[i].numIndices = (uint32_t)meshes[i]->indices.size();
+		header.numVertices += meshes[i]->vertices.size();
+		header.numIndices += meshes[i]->indices.size();
+	}
+	header.submeshOffset = sizeof(MeshCacheHeader);
+	header.vertexOffset = header.submeshOffset + sizeof(MeshCacheSubmesh) * submeshes.size();
+	header.indexOffset = header.vertexOffset + sizeof(ew::Vertex) * header.numVertices;
+
+	FILE* file = fopen(cachePath.c_str(), "wb");
+	if (file == NULL) {
+		printf("Failed to open %s for writing\n", cachePath.c_str());
+		return false;
+	}
+	fwrite(&header, sizeof(header), 1, file);
+	fwrite(submeshes.data(), sizeof(MeshCacheSubmesh), submeshes.size(), file);
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		fwrite(meshes[i]->vertices.data(), sizeof(ew::Vertex), meshes[i]->vertices.size(), file);
+	}
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		fwrite(meshes[i]->indices.data(), sizeof(unsigned int), meshes[i]->indices.size(), file);
+	}
+	bool succeeded = ferror(file) == 0;
+	fclose(file);
+	return succeeded;
+}
+
+//True if count elements of elementSize starting at offset end by limit, without overflowing
+static bool rangeFits(uint64_t offset, uint64_t count, uint64_t elementSize, uint64_t limit)
+{
+	return offset <= limit && count <= (limit - offset) / elementSize;
+}
+
+//Checks everything a reader will dereference: the three arrays must be in order without overlapping, every
+//submesh must lie inside them, and every index must address a vertex of its own submesh
+static bool validateMeshCache(const unsigned char* base, size_t mappingSize)
+{
+	const jameslib::MeshCacheHeader* header = (const jameslib::MeshCacheHeader*)base;
+	if (mappingSize < sizeof(jameslib::MeshCacheHeader)
+		|| memcmp(header->magic, jameslib::MESH_CACHE_MAGIC, sizeof(header->magic)) != 0
+		|| header->version != jameslib::MESH_CACHE_VERSION
+		|| header->vertexStride != sizeof(ew::Vertex)
+		|| header->numLods == 0) {
+		return false;
+	}
+	//Readers cast the arrays in place, so they must stay aligned
+	if (header->submeshOffset < sizeof(jameslib::MeshCacheHeader)
+		|| header->submeshOffset % alignof(jameslib::MeshCacheSubmesh) != 0
+		|| header->vertexOffset % alignof(ew::Vertex) != 0
+		|| header->indexOffset % alignof(unsigned int) != 0
+		|| !rangeFits(header->submeshOffset, (uint64_t)header->numSubmeshes * header->numLods, sizeof(jameslib::MeshCacheSubmesh), header->vertexOffset)
+		|| !rangeFits(header->vertexOffset, header->numVertices, sizeof(ew::Vertex), header->indexOffset)
+		|| !rangeFits(header->indexOffset, header->numIndices, sizeof(unsigned int), mappingSize)) {
+		return false;
+	}
+	const jameslib::MeshCacheSubmesh* submeshes = (const jameslib::MeshCacheSubmesh*)(base + header->submeshOffset);
+	const unsigned int* indices = (const unsigned int*)(base + header->indexOffset);
+	for (uint64_t i = 0; i < (uint64_t)header->numSubmeshes * header->numLods; i++)
+	{
+		const jameslib::MeshCacheSubmesh& submesh = submeshes[i];
+		if ((uint64_t)submesh.firstVertex + submesh.numVertices > header->numVertices
+			|| (uint64_t)submesh.firstIndex + submesh.numIndices > header->numIndices) {
+			return false;
+		}
+		for (uint32_t j = 0; j < submesh.numIndices; j++)
+		{
+			if (indices[submesh.firstIndex + j] >= submesh.numVertices) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+static bool mapFile(const std::string& filePath, jameslib::MeshCache* cache)
+{
+#ifdef _WIN32
+	HANDLE file = CreateFileA(filePath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE) {
+		return false;
+	}
+	LARGE_INTEGER size;
+	GetFileSizeEx(file, &size);
+	HANDLE mapping = size.QuadPart > 0 ? CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+	if (mapping == NULL) {
+		CloseHandle(file);
+		return false;
+	}
+	cache->mapping = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	cache->mappingSize = (size_t)size.QuadPart;
+	cache->fileHandle = file;
+	cache->mappingHandle = mapping;
+	return cache->mapping != NULL;
+#else
+	int fd = open(filePath.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return false;
+	}
+	void* mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	//The mapping keeps the file alive on its own
+	close(fd);
+	if (mapping == MAP_FAILED) {
+		return false;
+	}
+	madvise(mapping, info.st_size, MADV_WILLNEED);
+	cache->mapping = mapping;
+	cache->mappingSize = info.st_size;
+	return true;
+#endif
+}
+
+bool jameslib::openMeshCache(const std::string& cachePath, const std::string& sourcePath, MeshCache* cache)
+{
+	if (!mapFile(cachePath, cache)) {
+		return false;
+	}
+	const unsigned char* base = (const unsigned char*)cache->mapping;
+	const MeshCacheHeader* header = (const MeshCacheHeader*)base;
+
+	bool valid = validateMeshCache(base, cache->mappingSize);
+	if (!valid) {
+		printf("Mesh cache %s is corrupt or from another version, ignoring\n", cachePath.c_str());
+	}
+	//Size and time come from one stat. Only a matching size with a new time (e.g. a same size edit, or
+	//a checkout that touched the file) needs the full read to hash.
+	uint64_t sourceSize = getFileSize(sourcePath);
+	if (valid && sourceSize != 0 && (sourceSize != header->sourceSize
+		|| (getFileModifiedTime(sourcePath) != header->sourceTime && getFileHash(sourcePath) != header->sourceHash))) {
+		printf("Mesh cache %s is stale, ignoring\n", cachePath.c_str());
+		valid = false;
+	}
+	if (!valid) {
+		closeMeshCache(cache);
+		return false;
+	}
+
+	cache->header = header;
+	cache->submeshes = (const MeshCacheSubmesh*)(base + header->submeshOffset);
+	cache->vertices = (const ew::Vertex*)(base + header->vertexOffset);
+	cache->indices = (const unsigned int*)(base + header->indexOffset);
+	return true;
+}
+
+void jameslib::closeMeshCache(MeshCache* cache)
+{
+	if (cache->mapping) {
+#ifdef _WIN32
+		UnmapViewOfFile(cache->mapping);
+		CloseHandle((HANDLE)cache->mappingHandle);
+		CloseHandle((HANDLE)cache->fileHandle);
+#else
+		munmap(cache->mapping, cache->mappingSize);
+#endif
+	}
+	*cache = MeshCache();
+}
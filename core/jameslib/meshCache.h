@@ -0,0 +1,76 @@
+#pragma once
+
+#include "../ew/mesh.h"
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace jameslib
+{
+	//Binary mesh cache (.ewmesh). Layout on disk:
+	//  MeshCacheHeader | MeshCacheSubmesh[numLods * numSubmeshes] | ew::Vertex[numVertices] | uint32 indices[numIndices]
+	//The submesh table is level-major: LOD 0's submeshes first, then each coarser level baked from it.
+	//Submesh indices are relative to the submesh's first vertex so each range uploads as-is.
+	const char MESH_CACHE_MAGIC[4] = { 'E', 'W', 'M', 'C' };
+	const uint32_t MESH_CACHE_VERSION = 4;
+
+	struct MeshCacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint32_t vertexStride; //sizeof(ew::Vertex) at bake time
+		uint32_t numSubmeshes; //Per detail level
+		uint32_t numLods; //At least 1
+		uint32_t padding;
+		uint64_t numVertices;
+		uint64_t numIndices;
+		uint64_t sourceSize; //Byte size of the source model, used to detect stale caches
+		uint64_t sourceTime; //Modification time of the source model, see getFileModifiedTime
+		uint64_t sourceHash; //FNV-1a of the source model's bytes, catches edits that keep the size
+		uint64_t submeshOffset;
+		uint64_t vertexOffset;
+		uint64_t indexOffset;
+	};
+
+	struct MeshCacheSubmesh
+	{
+		uint32_t firstVertex;
+		uint32_t numVertices;
+		uint32_t firstIndex;
+		uint32_t numIndices;
+	};
+
+	//Read-only memory mapping of a cache file. Pointers are valid until closeMeshCache.
+	struct MeshCache
+	{
+		const MeshCacheHeader* header = nullptr;
+		const MeshCacheSubmesh* submeshes = nullptr;
+		const ew::Vertex* vertices = nullptr;
+		const unsigned int* indices = nullptr;
+
+		//numSubmeshes entries for one detail level
+		inline const MeshCacheSubmesh* getLodSubmeshes(uint32_t lod)const { return submeshes + lod * header->numSubmeshes; }
+
+		void* mapping = nullptr;
+		size_t mappingSize = 0;
+		void* fileHandle = nullptr;
+		void* mappingHandle = nullptr;
+	};
+
+	//Cache file that sits next to a source model, e.g. assets/Suzanne.obj.ewmesh
+	std::string getMeshCachePath(const std::string& sourcePath);
+	//Records sourcePath's size, modification time and hash so later opens can tell when the source changed
+	bool writeMeshCache(const std::string& cachePath, const std::vector<ew::MeshData>& meshes, const std::string& sourcePath);
+	//lods[level][submesh], every level with the same number of submeshes
+	bool writeMeshCache(const std::string& cachePath, const std::vector<std::vector<ew::MeshData>>& lods, const std::string& sourcePath);
+	//Maps and validates a cache: every offset, range and index must lie inside the file and its submesh.
+	//If sourcePath exists, its size must match the one recorded at bake time. The source is only hashed
+	//when its modification time differs, so a warm start never reads the source model.
+	bool openMeshCache(const std::string& cachePath, const std::string& sourcePath, MeshCache* cache);
+	void closeMeshCache(MeshCache* cache);
+	uint64_t getFileSize(const std::string& filePath);
+	//Nanoseconds since the epoch where the platform records them, 0 if the file is missing
+	uint64_t getFileModifiedTime(const std::string& filePath);
+	//FNV-1a over the file's contents, 0 if it can't be read
+	uint64_t getFileHash(const std::string& filePath);
+}
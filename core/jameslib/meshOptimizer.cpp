@@ -0,0 +1,360 @@
+#include "meshOptimizer.h"
+#include <algorithm>
+#include <math.h>
+
+namespace
+{
+	//Forsyth scoring parameters, see "Linear-Speed Vertex Cache Optimisation"
+	const int CACHE_SIZE = 32;
+	const float CACHE_DECAY_POWER = 1.5f;
+	const float LAST_TRI_SCORE = 0.75f;
+	const float VALENCE_BOOST_SCALE = 2.0f;
+	const float VALENCE_BOOST_POWER = 0.5f;
+
+	float forsythVertexScore(int cachePosition, unsigned int numActiveTriangles)
+	{
+		if (numActiveTriangles == 0) {
+			return -1.0f;
+		}
+		float score = 0.0f;
+		if (cachePosition >= 0) {
+			if (cachePosition < 3) {
+				//Vertices of the last triangle get a fixed score so it isn't simply repeated
+				score = LAST_TRI_SCORE;
+			}
+			else {
+				float scaler = 1.0f / (CACHE_SIZE - 3);
+				score = powf(1.0f - (cachePosition - 3) * scaler, CACHE_DECAY_POWER);
+			}
+		}
+		//Boost vertices with few triangles left so they get finished off
+		score += VALENCE_BOOST_SCALE * powf((float)numActiveTriangles, -VALENCE_BOOST_POWER);
+		return score;
+	}
+
+	//FIFO vertex cache. A vertex is cached if it missed within the last cacheSize misses. reset() empties
+	//the cache by advancing the clock past every stored timestamp, so the buffer is never cleared again.
+	struct CacheSimulator
+	{
+		std::vector<unsigned int> timestamps;
+		unsigned int timestamp;
+		unsigned int cacheSize;
+
+		CacheSimulator(size_t numVertices, unsigned int cacheSize)
+			: timestamps(numVertices, 0), timestamp(cacheSize + 1), cacheSize(cacheSize) {}
+
+		void reset()
+		{
+			timestamp += cacheSize + 1;
+		}
+
+		//Returns the misses for one triangle
+		unsigned int addTriangle(const unsigned int* triangle)
+		{
+			unsigned int misses = 0;
+			for (size_t j = 0; j < 3; j++)
+			{
+				unsigned int index = triangle[j];
+				if (timestamp - timestamps[index] > cacheSize) {
+					timestamps[index] = timestamp++;
+					misses++;
+				}
+			}
+			return misses;
+		}
+	};
+
+	//Simulates a FIFO cache from an empty state and returns the misses for each triangle
+	void simulateCacheMisses(const unsigned int* indices, size_t numTriangles, size_t numVertices, unsigned int cacheSize, std::vector<unsigned int>* missesPerTriangle)
+	{
+		CacheSimulator cache(numVertices, cacheSize);
+		missesPerTriangle->resize(numTriangles);
+		for (size_t i = 0; i < numTriangles; i++)
+		{
+			(*missesPerTriangle)[i] = cache.addTriangle(&indices[i * 3]);
+		}
+	}
+}
+
+jameslib::VertexCacheStats jameslib::analyzeVertexCache(const ew::MeshData& mesh, unsigned int cacheSize)
+{
+	VertexCacheStats stats = {};
+	size_t numTriangles = mesh.indices.size() / 3;
+	if (numTriangles == 0) {
+		return stats;
+	}
+	std::vector<unsigned int> misses;
+	simulateCacheMisses(mesh.indices.data(), numTriangles, mesh.vertices.size(), cacheSize, &misses);
+	std::vector<bool> referenced(mesh.vertices.size(), false);
+	unsigned int numReferenced = 0;
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		if (!referenced[mesh.indices[i]]) {
+			referenced[mesh.indices[i]] = true;
+			numReferenced++;
+		}
+	}
+	for (size_t i = 0; i < numTriangles; i++)
+	{
+		stats.numTransformed += misses[i];
+	}
+	stats.acmr = (float)stats.numTransformed / numTriangles;
+	stats.atvr = (float)stats.numTransformed / numReferenced;
+	return stats;
+}
+
+void jameslib::optimizeVertexCache(ew::MeshData* mesh)
+{
+	size_t numTriangles = mesh->indices.size() / 3;
+	size_t numVertices = mesh->vertices.size();
+	if (numTriangles == 0) {
+		return;
+	}
+	const std::vector<unsigned int>& indices = mesh->indices;
+
+	//Vertex -> triangle adjacency, packed so each vertex's live triangles sit at the front of its range
+	std::vector<unsigned int> numActive(numVertices, 0);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		numActive[indices[i]]++;
+	}
+	std::vector<unsigned int> adjacencyOffsets(numVertices + 1, 0);
+	for (size_t i = 0; i < numVertices; i++)
+	{
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + numActive[i];
+	}
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		adjacency[fill[indices[i]]++] = (unsigned int)(i / 3);
+	}
+
+	std::vector<int> cachePositions(numVertices, -1);
+	std::vector<float> vertexScores(numVertices);
+	for (size_t i = 0; i < numVertices; i++)
+	{
+		vertexScores[i] = forsythVertexScore(-1, numActive[i]);
+	}
+	std::vector<float> triangleScores(numTriangles);
+	std::vector<bool> emitted(numTriangles, false);
+	for (size_t i = 0; i < numTriangles; i++)
+	{
+		triangleScores[i] = vertexScores[indices[i * 3]] + vertexScores[indices[i * 3 + 1]] + vertexScores[indices[i * 3 + 2]];
+	}
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	std::vector<unsigned int> cache, nextCache;
+	cache.reserve(CACHE_SIZE + 3);
+	nextCache.reserve(CACHE_SIZE + 3);
+	size_t scanStart = 0;
+	int bestTriangle = -1;
+
+	for (size_t emittedCount = 0; emittedCount < numTriangles; emittedCount++)
+	{
+		//Nothing in the cache has live triangles left, fall back to a full search
+		if (bestTriangle < 0) {
+			float bestScore = -1.0f;
+			while (scanStart < numTriangles && emitted[scanStart]) {
+				scanStart++;
+			}
+			for (size_t i = scanStart; i < numTriangles; i++)
+			{
+				if (!emitted[i] && triangleScores[i] > bestScore) {
+					bestScore = triangleScores[i];
+					bestTriangle = (int)i;
+				}
+			}
+		}
+
+		//Emit the triangle and remove it from each vertex's live list
+		emitted[bestTriangle] = true;
+		for (size_t j = 0; j < 3; j++)
+		{
+			unsigned int vertex = indices[bestTriangle * 3 + j];
+			output.push_back(vertex);
+			unsigned int* begin = &adjacency[adjacencyOffsets[vertex]];
+			unsigned int* end = begin + numActive[vertex];
+			unsigned int* found = std::find(begin, end, (unsigned int)bestTriangle);
+			std::swap(*found, *(end - 1));
+			numActive[vertex]--;
+		}
+
+		//New cache = this triangle's vertices followed by the old cache minus duplicates
+		nextCache.clear();
+		for (size_t j = 0; j < 3; j++)
+		{
+			nextCache.push_back(indices[bestTriangle * 3 + j]);
+		}
+		for (size_t j = 0; j < cache.size(); j++)
+		{
+			unsigned int vertex = cache[j];
+			if (vertex != nextCache[0] && vertex != nextCache[1] && vertex != nextCache[2]) {
+				nextCache.push_back(vertex);
+			}
+		}
+		std::swap(cache, nextCache);
+
+		//Rescore everything in (or just evicted from) the cache
+		for (size_t j = 0; j < cache.size(); j++)
+		{
+			unsigned int vertex = cache[j];
+			cachePositions[vertex] = j < (size_t)CACHE_SIZE ? (int)j : -1;
+			vertexScores[vertex] = forsythVertexScore(cachePositions[vertex], numActive[vertex]);
+		}
+		bestTriangle = -1;
+		float bestScore = -1.0f;
+		for (size_t j = 0; j < cache.size(); j++)
+		{
+			unsigned int vertex = cache[j];
+			for (unsigned int k = 0; k < numActive[vertex]; k++)
+			{
+				unsigned int triangle = adjacency[adjacencyOffsets[vertex] + k];
+				float score = vertexScores[indices[triangle * 3]] + vertexScores[indices[triangle * 3 + 1]] + vertexScores[indices[triangle * 3 + 2]];
+				triangleScores[triangle] = score;
+				if (score > bestScore) {
+					bestScore = score;
+					bestTriangle = (int)triangle;
+				}
+			}
+		}
+		if (cache.size() > (size_t)CACHE_SIZE) {
+			cache.resize(CACHE_SIZE);
+		}
+	}
+	mesh->indices.swap(output);
+}
+
+void jameslib::optimizeOverdraw(ew::MeshData* mesh, float threshold)
+{
+	const unsigned int SIMULATED_CACHE_SIZE = 16;
+	const size_t MIN_CLUSTER_SIZE = 16;
+	size_t numTriangles = mesh->indices.size() / 3;
+	if (numTriangles == 0) {
+		return;
+	}
+	const std::vector<unsigned int>& indices = mesh->indices;
+
+	//Hard boundaries: triangles where the cache is effectively flushed (every vertex missed)
+	std::vector<unsigned int> misses;
+	simulateCacheMisses(indices.data(), numTriangles, mesh->vertices.size(), SIMULATED_CACHE_SIZE, &misses);
+	std::vector<size_t> hardClusters;
+	for (size_t i = 0; i < numTriangles; i++)
+	{
+		if (i == 0 || misses[i] == 3) {
+			hardClusters.push_back(i);
+		}
+	}
+	hardClusters.push_back(numTriangles);
+
+	//Soft boundaries: split a hard cluster further wherever restarting the cache costs
+	//no more than threshold times that cluster's own ACMR
+	std::vector<size_t> clusters;
+	CacheSimulator cache(mesh->vertices.size(), SIMULATED_CACHE_SIZE);
+	for (size_t c = 0; c + 1 < hardClusters.size(); c++)
+	{
+		size_t start = hardClusters[c];
+		size_t end = hardClusters[c + 1];
+		unsigned int clusterMisses = 0;
+		for (size_t i = start; i < end; i++)
+		{
+			clusterMisses += misses[i];
+		}
+		float clusterACMR = (float)clusterMisses / (end - start);
+
+		//One pass over the cluster, restarting the simulated cache and the running ACMR at every split
+		cache.reset();
+		clusters.push_back(start);
+		size_t subStart = start;
+		unsigned int runningMisses = 0;
+		for (size_t i = start; i < end; i++)
+		{
+			runningMisses += cache.addTriangle(&indices[i * 3]);
+			size_t count = i + 1 - subStart;
+			if (count >= MIN_CLUSTER_SIZE && i + 1 < end && (float)runningMisses / count <= clusterACMR * threshold) {
+				clusters.push_back(i + 1);
+				subStart = i + 1;
+				runningMisses = 0;
+				cache.reset();
+			}
+		}
+	}
+	clusters.push_back(numTriangles);
+
+	//Sort clusters by how much they face away from the mesh center, most outward first
+	glm::vec3 meshCentroid = glm::vec3(0.0f);
+	for (size_t i = 0; i < mesh->vertices.size(); i++)
+	{
+		meshCentroid += mesh->vertices[i].pos;
+	}
+	meshCentroid /= (float)glm::max(mesh->vertices.size(), (size_t)1);
+
+	size_t numClusters = clusters.size() - 1;
+	std::vector<float> sortKeys(numClusters);
+	for (size_t c = 0; c < numClusters; c++)
+	{
+		glm::vec3 centroid = glm::vec3(0.0f);
+		glm::vec3 normal = glm::vec3(0.0f);
+		float area = 0.0f;
+		for (size_t i = clusters[c]; i < clusters[c + 1]; i++)
+		{
+			glm::vec3 a = mesh->vertices[indices[i * 3]].pos;
+			glm::vec3 b = mesh->vertices[indices[i * 3 + 1]].pos;
+			glm::vec3 cc = mesh->vertices[indices[i * 3 + 2]].pos;
+			//Cross product length is twice the area, so this is an area weighted sum
+			glm::vec3 areaNormal = glm::cross(b - a, cc - a);
+			float triangleArea = glm::length(areaNormal);
+			centroid += (a + b + cc) * (triangleArea / 3.0f);
+			normal += areaNormal;
+			area += triangleArea;
+		}
+		centroid = area > 0.0f ? centroid / area : meshCentroid;
+		float normalLength = glm::length(normal);
+		normal = normalLength > 0.0f ? normal / normalLength : glm::vec3(0.0f);
+		sortKeys[c] = glm::dot(centroid - meshCentroid, normal);
+	}
+	std::vector<size_t> order(numClusters);
+	for (size_t c = 0; c < numClusters; c++)
+	{
+		order[c] = c;
+	}
+	std::stable_sort(order.begin(), order.end(), [&sortKeys](size_t a, size_t b) {
+		return sortKeys[a] > sortKeys[b];
+	});
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+	for (size_t c = 0; c < numClusters; c++)
+	{
+		size_t cluster = order[c];
+		output.insert(output.end(), indices.begin() + clusters[cluster] * 3, indices.begin() + clusters[cluster + 1] * 3);
+	}
+	mesh->indices.swap(output);
+}
+
+void jameslib::optimizeVertexFetch(ew::MeshData* mesh)
+{
+	const unsigned int UNUSED = 0xFFFFFFFF;
+	std::vector<unsigned int> remap(mesh->vertices.size(), UNUSED);
+	std::vector<ew::Vertex> vertices;
+	vertices.reserve(mesh->vertices.size());
+	for (size_t i = 0; i < mesh->indices.size(); i++)
+	{
+		unsigned int& index = mesh->indices[i];
+		if (remap[index] == UNUSED) {
+			remap[index] = (unsigned int)vertices.size();
+			vertices.push_back(mesh->vertices[index]);
+		}
+		index = remap[index];
+	}
+	//Unreferenced vertices are dropped
+	mesh->vertices.swap(vertices);
+}
+
+void jameslib::optimizeMesh(ew::MeshData* mesh)
+{
+	optimizeVertexCache(mesh);
+	optimizeOverdraw(mesh);
+	optimizeVertexFetch(mesh);
+}
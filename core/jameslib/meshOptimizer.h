@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../ew/mesh.h"
+
+namespace jameslib
+{
+	//Post-transform cache statistics from simulating a FIFO vertex cache
+	struct VertexCacheStats
+	{
+		unsigned int numTransformed; //Cache misses
+		float acmr; //Average cache miss ratio, transformed vertices per triangle (0.5 - 3.0)
+		float atvr; //Average transform to vertex ratio, transformed vertices per unique vertex (1.0+)
+	};
+
+	VertexCacheStats analyzeVertexCache(const ew::MeshData& mesh, unsigned int cacheSize = 16);
+
+	//Reorders triangles for post-transform cache reuse (Forsyth's linear-speed algorithm)
+	void optimizeVertexCache(ew::MeshData* mesh);
+	//Splits the cache optimized order into clusters and sorts them so outward facing clusters draw first.
+	//threshold bounds how much ACMR may degrade (1.05 = 5%) in exchange for smaller clusters.
+	void optimizeOverdraw(ew::MeshData* mesh, float threshold = 1.05f);
+	//Reorders vertices into first-use order and remaps indices so vertex fetch is sequential
+	void optimizeVertexFetch(ew::MeshData* mesh);
+	//Runs all of the above in the order they need to be applied
+	void optimizeMesh(ew::MeshData* mesh);
+}
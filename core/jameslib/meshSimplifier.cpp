@@ -0,0 +1,429 @@
+#include "meshSimplifier.h"
+#include "meshOptimizer.h"
+#include <algorithm>
+#include <math.h>
+#include <queue>
+#include <string.h>
+#include <unordered_map>
+
+namespace
+{
+	//Symmetric 4x4 matrix, upper triangle
+	struct Quadric
+	{
+		double a2 = 0, ab = 0, ac = 0, ad = 0;
+		double b2 = 0, bc = 0, bd = 0;
+		double c2 = 0, cd = 0;
+		double d2 = 0;
+
+		void addPlane(const glm::vec3& n, double d, double weight)
+		{
+			a2 += weight * n.x * n.x; ab += weight * n.x * n.y; ac += weight * n.x * n.z; ad += weight * n.x * d;
+			b2 += weight * n.y * n.y; bc += weight * n.y * n.z; bd += weight * n.y * d;
+			c2 += weight * n.z * n.z; cd += weight * n.z * d;
+			d2 += weight * d * d;
+		}
+		void add(const Quadric& q)
+		{
+			a2 += q.a2; ab += q.ab; ac += q.ac; ad += q.ad;
+			b2 += q.b2; bc += q.bc; bd += q.bd;
+			c2 += q.c2; cd += q.cd;
+			d2 += q.d2;
+		}
+		//Sum of squared distances from p to every accumulated plane
+		double evaluate(const glm::vec3& p) const
+		{
+			double x = p.x, y = p.y, z = p.z;
+			return a2 * x * x + 2 * ab * x * y + 2 * ac * x * z + 2 * ad * x
+				+ b2 * y * y + 2 * bc * y * z + 2 * bd * y
+				+ c2 * z * z + 2 * cd * z
+				+ d2;
+		}
+	};
+
+	struct Collapse
+	{
+		double cost;
+		unsigned int from;
+		unsigned int to;
+		unsigned int fromVersion;
+		unsigned int toVersion;
+		bool operator>(const Collapse& other) const { return cost > other.cost; }
+	};
+
+	struct PositionHash
+	{
+		size_t operator()(const glm::vec3& p) const
+		{
+			unsigned int h[3];
+			memcpy(h, &p, sizeof(h));
+			return (h[0] * 73856093u) ^ (h[1] * 19349663u) ^ (h[2] * 83492791u);
+		}
+	};
+
+	//Boundary edges are held in place by a steep plane through the edge, perpendicular to its face
+	const double BORDER_WEIGHT = 10.0;
+	//Reject collapses that rotate an adjacent face normal by more than ~80 degrees
+	const float MIN_NORMAL_DOT = 0.2f;
+}
+
+ew::MeshData jameslib::simplifyMesh(const ew::MeshData& mesh, size_t targetIndexCount, float targetError, float* resultError)
+{
+	if (resultError) {
+		*resultError = 0.0f;
+	}
+	size_t numTriangles = mesh.indices.size() / 3;
+	if (mesh.indices.size() <= targetIndexCount || numTriangles == 0) {
+		return mesh;
+	}
+
+	//Weld vertices by position. Simplification runs on positions, original vertices ("wedges") follow.
+	//Exact duplicate vertices (unindexed imports) collapse to a single wedge.
+	std::unordered_map<glm::vec3, unsigned int, PositionHash> positionLookup;
+	std::vector<unsigned int> wedgePosition(mesh.vertices.size());
+	std::vector<unsigned int> wedgeCanonical(mesh.vertices.size());
+	std::vector<glm::vec3> positions;
+	std::vector<std::vector<unsigned int>> positionWedges;
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		auto result = positionLookup.emplace(mesh.vertices[i].pos, (unsigned int)positions.size());
+		if (result.second) {
+			positions.push_back(mesh.vertices[i].pos);
+			positionWedges.emplace_back();
+		}
+		unsigned int position = result.first->second;
+		wedgePosition[i] = position;
+		wedgeCanonical[i] = (unsigned int)i;
+		std::vector<unsigned int>& wedges = positionWedges[position];
+		for (size_t j = 0; j < wedges.size(); j++)
+		{
+			if (memcmp(&mesh.vertices[wedges[j]], &mesh.vertices[i], sizeof(ew::Vertex)) == 0) {
+				wedgeCanonical[i] = wedges[j];
+				break;
+			}
+		}
+		if (wedgeCanonical[i] == i) {
+			wedges.push_back((unsigned int)i);
+		}
+	}
+	size_t numPositions = positions.size();
+
+	glm::vec3 minPos = positions[0], maxPos = positions[0];
+	for (size_t i = 1; i < numPositions; i++)
+	{
+		minPos = glm::min(minPos, positions[i]);
+		maxPos = glm::max(maxPos, positions[i]);
+	}
+	glm::vec3 extent = maxPos - minPos;
+	double meshScale = glm::max(extent.x, glm::max(extent.y, extent.z));
+	if (meshScale <= 0.0) {
+		return mesh;
+	}
+	double maxCost = (double)targetError * targetError * meshScale * meshScale;
+
+	std::vector<unsigned int> triangles(numTriangles * 3);
+	for (size_t i = 0; i < triangles.size(); i++)
+	{
+		triangles[i] = wedgeCanonical[mesh.indices[i]];
+	}
+	std::vector<bool> triangleAlive(numTriangles, true);
+	std::vector<std::vector<unsigned int>> positionTriangles(numPositions);
+	std::vector<Quadric> quadrics(numPositions);
+
+	//Face quadrics, area weighted
+	std::unordered_map<unsigned long long, int> edgeUse;
+	auto edgeKey = [](unsigned int a, unsigned int b) {
+		return a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+	};
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		unsigned int p[3];
+		for (int j = 0; j < 3; j++)
+		{
+			p[j] = wedgePosition[triangles[t * 3 + j]];
+			positionTriangles[p[j]].push_back((unsigned int)t);
+		}
+		glm::vec3 normal = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+		float area = glm::length(normal);
+		if (area > 0.0f) {
+			normal /= area;
+			double d = -glm::dot(normal, positions[p[0]]);
+			for (int j = 0; j < 3; j++)
+			{
+				quadrics[p[j]].addPlane(normal, d, area * 0.5);
+			}
+		}
+		for (int j = 0; j < 3; j++)
+		{
+			edgeUse[edgeKey(p[j], p[(j + 1) % 3])]++;
+		}
+	}
+	//Border quadrics
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		unsigned int p[3];
+		for (int j = 0; j < 3; j++)
+		{
+			p[j] = wedgePosition[triangles[t * 3 + j]];
+		}
+		glm::vec3 faceNormal = glm::cross(positions[p[1]] - positions[p[0]], positions[p[2]] - positions[p[0]]);
+		if (glm::length(faceNormal) <= 0.0f) {
+			continue;
+		}
+		faceNormal = glm::normalize(faceNormal);
+		for (int j = 0; j < 3; j++)
+		{
+			unsigned int a = p[j], b = p[(j + 1) % 3];
+			if (edgeUse[edgeKey(a, b)] != 1) {
+				continue;
+			}
+			glm::vec3 edge = positions[b] - positions[a];
+			float edgeLength = glm::length(edge);
+			if (edgeLength <= 0.0f) {
+				continue;
+			}
+			glm::vec3 borderNormal = glm::normalize(glm::cross(edge, faceNormal));
+			double d = -glm::dot(borderNormal, positions[a]);
+			quadrics[a].addPlane(borderNormal, d, BORDER_WEIGHT * edgeLength * edgeLength);
+			quadrics[b].addPlane(borderNormal, d, BORDER_WEIGHT * edgeLength * edgeLength);
+		}
+	}
+
+	std::vector<unsigned int> versions(numPositions, 0);
+	std::vector<bool> positionAlive(numPositions, true);
+	std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> queue;
+
+	//Pushes the cheaper direction of collapsing edge a-b
+	auto pushEdge = [&](unsigned int a, unsigned int b) {
+		Quadric q = quadrics[a];
+		q.add(quadrics[b]);
+		double costToB = q.evaluate(positions[b]);
+		double costToA = q.evaluate(positions[a]);
+		Collapse collapse;
+		if (costToB <= costToA) {
+			collapse = { costToB, a, b, versions[a], versions[b] };
+		}
+		else {
+			collapse = { costToA, b, a, versions[b], versions[a] };
+		}
+		queue.push(collapse);
+	};
+	for (auto it = edgeUse.begin(); it != edgeUse.end(); ++it)
+	{
+		pushEdge((unsigned int)(it->first >> 32), (unsigned int)(it->first & 0xFFFFFFFF));
+	}
+
+	size_t liveTriangles = numTriangles;
+	double acceptedCost = 0.0;
+	std::vector<unsigned int> wedgeRemap(mesh.vertices.size());
+	while (liveTriangles * 3 > targetIndexCount && !queue.empty()) {
+		Collapse collapse = queue.top();
+		queue.pop();
+		unsigned int from = collapse.from;
+		unsigned int to = collapse.to;
+		if (!positionAlive[from] || !positionAlive[to] || versions[from] != collapse.fromVersion || versions[to] != collapse.toVersion) {
+			continue;
+		}
+		if (collapse.cost > maxCost) {
+			break;
+		}
+
+		//Reject collapses that would flip a face that survives
+		bool flips = false;
+		for (size_t i = 0; i < positionTriangles[from].size() && !flips; i++)
+		{
+			unsigned int t = positionTriangles[from][i];
+			if (!triangleAlive[t]) {
+				continue;
+			}
+			glm::vec3 before[3], after[3];
+			bool containsTo = false;
+			for (int j = 0; j < 3; j++)
+			{
+				unsigned int p = wedgePosition[triangles[t * 3 + j]];
+				containsTo |= p == to;
+				before[j] = positions[p];
+				after[j] = p == from ? positions[to] : positions[p];
+			}
+			if (containsTo) {
+				continue;
+			}
+			glm::vec3 n0 = glm::cross(before[1] - before[0], before[2] - before[0]);
+			glm::vec3 n1 = glm::cross(after[1] - after[0], after[2] - after[0]);
+			float l0 = glm::length(n0), l1 = glm::length(n1);
+			flips = l1 <= 0.0f || (l0 > 0.0f && glm::dot(n0, n1) < MIN_NORMAL_DOT * l0 * l1);
+		}
+		if (flips) {
+			continue;
+		}
+
+		//Every wedge at "from" moves to the wedge at "to" with the closest attributes
+		for (size_t i = 0; i < positionWedges[from].size(); i++)
+		{
+			unsigned int wedge = positionWedges[from][i];
+			const ew::Vertex& v = mesh.vertices[wedge];
+			unsigned int best = positionWedges[to][0];
+			float bestDistance = INFINITY;
+			for (size_t j = 0; j < positionWedges[to].size(); j++)
+			{
+				const ew::Vertex& candidate = mesh.vertices[positionWedges[to][j]];
+				float distance = glm::dot(candidate.uv - v.uv, candidate.uv - v.uv) + glm::dot(candidate.normal - v.normal, candidate.normal - v.normal);
+				if (distance < bestDistance) {
+					bestDistance = distance;
+					best = positionWedges[to][j];
+				}
+			}
+			wedgeRemap[wedge] = best;
+		}
+		for (size_t i = 0; i < positionTriangles[from].size(); i++)
+		{
+			unsigned int t = positionTriangles[from][i];
+			if (!triangleAlive[t]) {
+				continue;
+			}
+			bool degenerate = false;
+			for (int j = 0; j < 3; j++)
+			{
+				unsigned int& wedge = triangles[t * 3 + j];
+				if (wedgePosition[wedge] == from) {
+					wedge = wedgeRemap[wedge];
+				}
+			}
+			unsigned int p0 = wedgePosition[triangles[t * 3]];
+			unsigned int p1 = wedgePosition[triangles[t * 3 + 1]];
+			unsigned int p2 = wedgePosition[triangles[t * 3 + 2]];
+			degenerate = p0 == p1 || p1 == p2 || p0 == p2;
+			if (degenerate) {
+				triangleAlive[t] = false;
+				liveTriangles--;
+			}
+			else {
+				positionTriangles[to].push_back(t);
+			}
+		}
+		positionTriangles[from].clear();
+		positionAlive[from] = false;
+		quadrics[to].add(quadrics[from]);
+		versions[to]++;
+		acceptedCost = glm::max(acceptedCost, collapse.cost);
+
+		//Re-queue every edge around the merged vertex with its new quadric
+		std::vector<unsigned int> neighbours;
+		std::vector<unsigned int>& toTriangles = positionTriangles[to];
+		size_t write = 0;
+		for (size_t i = 0; i < toTriangles.size(); i++)
+		{
+			unsigned int t = toTriangles[i];
+			if (!triangleAlive[t]) {
+				continue;
+			}
+			toTriangles[write++] = t;
+			for (int j = 0; j < 3; j++)
+			{
+				unsigned int p = wedgePosition[triangles[t * 3 + j]];
+				if (p != to) {
+					neighbours.push_back(p);
+				}
+			}
+		}
+		toTriangles.resize(write);
+		std::sort(neighbours.begin(), neighbours.end());
+		neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+		for (size_t i = 0; i < neighbours.size(); i++)
+		{
+			pushEdge(to, neighbours[i]);
+		}
+	}
+
+	//Compact surviving triangles and the vertices they reference
+	ew::MeshData result;
+	result.indices.reserve(liveTriangles * 3);
+	std::vector<unsigned int> vertexRemap(mesh.vertices.size(), 0xFFFFFFFF);
+	for (size_t t = 0; t < numTriangles; t++)
+	{
+		if (!triangleAlive[t]) {
+			continue;
+		}
+		for (int j = 0; j < 3; j++)
+		{
+			unsigned int wedge = triangles[t * 3 + j];
+			if (vertexRemap[wedge] == 0xFFFFFFFF) {
+				vertexRemap[wedge] = (unsigned int)result.vertices.size();
+				result.vertices.push_back(mesh.vertices[wedge]);
+			}
+			result.indices.push_back(vertexRemap[wedge]);
+		}
+	}
+	if (resultError) {
+		*resultError = (float)(sqrt(acceptedCost) / meshScale);
+	}
+	return result;
+}
+
+void jameslib::generateLodChain(const ew::MeshData& mesh, int numLevels, std::vector<ew::MeshData>* lods, float reduction, float maxError)
+{
+	lods->clear();
+	lods->push_back(mesh);
+	size_t targetIndexCount = mesh.indices.size();
+	for (int i = 1; i < numLevels; i++)
+	{
+		targetIndexCount = (size_t)(targetIndexCount / 3 * reduction) * 3;
+		if (targetIndexCount < 12) {
+			break;
+		}
+		//Always simplify from the source so error doesn't compound between levels
+		ew::MeshData lod = simplifyMesh(mesh, targetIndexCount, maxError);
+		//Couldn't get meaningfully smaller than the previous level within maxError
+		if (lod.indices.size() > lods->back().indices.size() * 0.9f) {
+			break;
+		}
+		lods->push_back(std::move(lod));
+	}
+}
+
+void jameslib::generateModelLods(const std::vector<ew::MeshData>& meshes, int numLevels, std::vector<std::vector<ew::MeshData>>* lods)
+{
+	std::vector<std::vector<ew::MeshData>> chains(meshes.size());
+	size_t chainLength = numLevels > 0 ? numLevels : 1;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		generateLodChain(meshes[i], numLevels, &chains[i]);
+		chainLength = std::min(chainLength, chains[i].size());
+	}
+	lods->clear();
+	lods->resize(chainLength - 1);
+	for (size_t level = 0; level < lods->size(); level++)
+	{
+		(*lods)[level].resize(meshes.size());
+		for (size_t i = 0; i < meshes.size(); i++)
+		{
+			(*lods)[level][i] = std::move(chains[i][level + 1]);
+			optimizeMesh(&(*lods)[level][i]);
+		}
+	}
+}
+
+float jameslib::computeScreenCoverage(const ew::Camera& camera, const glm::vec3& center, float radius)
+{
+	if (camera.orthographic) {
+		return 2.0f * radius / camera.orthoHeight;
+	}
+	float distance = glm::length(center - camera.position);
+	if (distance <= radius) {
+		return 1.0f;
+	}
+	//Projected diameter over the viewport height at this distance
+	return radius / (distance * tanf(glm::radians(camera.fov) * 0.5f));
+}
+
+int jameslib::selectLod(float screenCoverage, int numLods, float lodBias, float fullDetailCoverage)
+{
+	if (numLods <= 1) {
+		return 0;
+	}
+	float lod = lodBias;
+	if (screenCoverage < fullDetailCoverage) {
+		lod += log2f(fullDetailCoverage / glm::max(screenCoverage, 1e-6f));
+	}
+	return glm::clamp((int)lod, 0, numLods - 1);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "../ew/mesh.h"
+#include "../ew/camera.h"
+#include <vector>
+
+namespace jameslib
+{
+	//Quadric error metric edge-collapse simplifier. Vertices sharing a position are welded so UV and
+	//normal seams collapse together. Stops at targetIndexCount or when the next collapse would move the
+	//surface by more than targetError (fraction of the mesh's largest extent).
+	//resultError receives the largest error that was accepted.
+	ew::MeshData simplifyMesh(const ew::MeshData& mesh, size_t targetIndexCount, float targetError = 0.02f, float* resultError = nullptr);
+
+	//lods[0] is a copy of mesh. Each following level targets reduction times the previous triangle count.
+	//Generation stops early once a level can't be reduced within maxError.
+	void generateLodChain(const ew::MeshData& mesh, int numLevels, std::vector<ew::MeshData>* lods, float reduction = 0.5f, float maxError = 0.05f);
+	//Coarser levels for a whole model as lods[level - 1][submesh], each optimized for drawing.
+	//Every level needs all submeshes, so the chain is as long as the shortest submesh chain.
+	void generateModelLods(const std::vector<ew::MeshData>& meshes, int numLevels, std::vector<std::vector<ew::MeshData>>* lods);
+
+	//Height of a bounding sphere on screen as a fraction of the viewport height
+	float computeScreenCoverage(const ew::Camera& camera, const glm::vec3& center, float radius);
+	//LOD 0 is used down to fullDetailCoverage, each level after covers half the screen size of the previous.
+	//lodBias shifts the result towards coarser levels (e.g. +1 for shadow passes).
+	int selectLod(float screenCoverage, int numLods, float lodBias = 0.0f, float fullDetailCoverage = 0.5f);
+}
@@ -0,0 +1,122 @@
+#include "pngWriter.h"
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+namespace
+{
+	uint32_t crc32(uint32_t crc, const unsigned char* data, size_t size)
+	{
+		static uint32_t table[256];
+		static bool tableReady = false;
+		if (!tableReady) {
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++)
+				{
+					c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+				}
+				table[i] = c;
+			}
+			tableReady = true;
+		}
+		crc = ~crc;
+		for (size_t i = 0; i < size; i++)
+		{
+			crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+		}
+		return ~crc;
+	}
+
+	void putBigEndian(std::vector<unsigned char>& out, uint32_t value)
+	{
+		out.push_back((unsigned char)(value >> 24));
+		out.push_back((unsigned char)(value >> 16));
+		out.push_back((unsigned char)(value >> 8));
+		out.push_back((unsigned char)value);
+	}
+
+	//Length, type, data, CRC of type and data
+	void writeChunk(FILE* file, const char* type, const std::vector<unsigned char>& data)
+	{
+		std::vector<unsigned char> chunk;
+		chunk.reserve(data.size() + 12);
+		putBigEndian(chunk, (uint32_t)data.size());
+		chunk.insert(chunk.end(), type, type + 4);
+		chunk.insert(chunk.end(), data.begin(), data.end());
+		putBigEndian(chunk, crc32(0, chunk.data() + 4, data.size() + 4));
+		fwrite(chunk.data(), 1, chunk.size(), file);
+	}
+}
+
+bool jameslib::writePng(const char* filePath, unsigned int width, unsigned int height, const unsigned char* rgba, bool flipY)
+{
+	FILE* file = fopen(filePath, "wb");
+	if (!file) {
+		printf("Failed to open %s for writing\n", filePath);
+		return false;
+	}
+	const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	fwrite(signature, 1, 8, file);
+
+	std::vector<unsigned char> header;
+	putBigEndian(header, width);
+	putBigEndian(header, height);
+	header.push_back(8); //Bit depth
+	header.push_back(6); //RGBA
+	header.push_back(0); //Deflate
+	header.push_back(0); //Adaptive filtering
+	header.push_back(0); //No interlace
+	writeChunk(file, "IHDR", header);
+
+	//Every scanline starts with filter type 0 (none)
+	size_t rowBytes = (size_t)width * 4;
+	std::vector<unsigned char> raw((rowBytes + 1) * height);
+	for (unsigned int y = 0; y < height; y++)
+	{
+		unsigned int sourceRow = flipY ? height - 1 - y : y;
+		raw[y * (rowBytes + 1)] = 0;
+		memcpy(&raw[y * (rowBytes + 1) + 1], rgba + sourceRow * rowBytes, rowBytes);
+	}
+
+	//zlib stream of stored deflate blocks, at most 65535 bytes each, then the Adler-32 of the raw data
+	std::vector<unsigned char> zlib;
+	zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+	zlib.push_back(0x78);
+	zlib.push_back(0x01);
+	size_t offset = 0;
+	do {
+		size_t blockSize = raw.size() - offset < 65535 ? raw.size() - offset : 65535;
+		bool last = offset + blockSize == raw.size();
+		zlib.push_back(last ? 1 : 0);
+		zlib.push_back((unsigned char)blockSize);
+		zlib.push_back((unsigned char)(blockSize >> 8));
+		zlib.push_back((unsigned char)~blockSize);
+		zlib.push_back((unsigned char)(~blockSize >> 8));
+		zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + blockSize);
+		offset += blockSize;
+	} while (offset < raw.size());
+	//5552 bytes is the most that can be summed before b overflows 32 bits
+	uint32_t a = 1;
+	uint32_t b = 0;
+	for (size_t start = 0; start < raw.size(); start += 5552)
+	{
+		size_t end = start + 5552 < raw.size() ? start + 5552 : raw.size();
+		for (size_t i = start; i < end; i++)
+		{
+			a += raw[i];
+			b += a;
+		}
+		a %= 65521;
+		b %= 65521;
+	}
+	putBigEndian(zlib, (b << 16) | a);
+	writeChunk(file, "IDAT", zlib);
+
+	writeChunk(file, "IEND", std::vector<unsigned char>());
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
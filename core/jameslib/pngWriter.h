@@ -0,0 +1,8 @@
+#pragma once
+
+namespace jameslib
+{
+	//Writes 8 bit RGBA pixels as an uncompressed PNG (stored deflate blocks), so no zlib is needed.
+	//Rows are bottom to top as glReadPixels returns them when flipY is set.
+	bool writePng(const char* filePath, unsigned int width, unsigned int height, const unsigned char* rgba, bool flipY);
+}
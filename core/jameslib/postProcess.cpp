@@ -0,0 +1,196 @@
+#include "postProcess.h"
+#include "../ew/external/glad.h"
+#include <math.h>
+
+namespace
+{
+	unsigned int levelSize(unsigned int size, int level)
+	{
+		unsigned int s = size >> level;
+		return s > 0 ? s : 1;
+	}
+}
+
+int jameslib::computeLinearTaps(float radius, bool gaussian, float* offsets, float* weights, int maxTaps)
+{
+	//Every tap after the center covers two texels
+	maxTaps = maxTaps < MAX_BLUR_TAPS ? maxTaps : MAX_BLUR_TAPS;
+	radius = fminf(fmaxf(radius, 0.0f), (float)(maxTaps - 1) * 2.0f);
+	int halfWidth = (int)ceilf(radius);
+	//Discrete weights of one side. Sigma puts the kernel edge at 3 standard deviations.
+	float discrete[MAX_BLUR_TAPS * 2];
+	float sigma = fmaxf(radius / 3.0f, 0.5f);
+	float total = 0.0f;
+	for (int i = 0; i <= halfWidth; i++)
+	{
+		discrete[i] = gaussian ? expf(-(float)(i * i) / (2.0f * sigma * sigma)) : 1.0f;
+		total += i == 0 ? discrete[i] : discrete[i] * 2.0f;
+	}
+	for (int i = 0; i <= halfWidth; i++)
+	{
+		discrete[i] /= total;
+	}
+
+	//A fetch between texels i and i + 1, placed by their weights, returns the weighted sum of both
+	offsets[0] = 0.0f;
+	weights[0] = discrete[0];
+	int numTaps = 1;
+	for (int i = 1; i <= halfWidth; i += 2)
+	{
+		float w1 = discrete[i];
+		float w2 = i + 1 <= halfWidth ? discrete[i + 1] : 0.0f;
+		weights[numTaps] = w1 + w2;
+		offsets[numTaps] = (i * w1 + (i + 1) * w2) / (w1 + w2);
+		numTaps++;
+	}
+	return numTaps;
+}
+
+float jameslib::getBlurTapsPerPixel(const BlurSettings& settings)
+{
+	switch (settings.mode)
+	{
+	case BlurMode::BOX_5X5:
+		return 25.0f;
+	case BlurMode::SEPARABLE_BOX:
+	case BlurMode::SEPARABLE_GAUSSIAN: {
+		float offsets[MAX_BLUR_TAPS];
+		float weights[MAX_BLUR_TAPS];
+		int downsample = settings.downsample > 1 ? 2 : 1;
+		int numTaps = computeLinearTaps(settings.radius / downsample, settings.mode == BlurMode::SEPARABLE_GAUSSIAN, offsets, weights, MAX_BLUR_TAPS);
+		//Each pass fetches the center once and every other tap on both sides
+		float taps = 2.0f * (numTaps * 2 - 1);
+		if (downsample > 1) {
+			taps += 1.0f; //Bilinear downsample
+		}
+		return taps / (float)(downsample * downsample);
+	}
+	case BlurMode::DUAL_KAWASE: {
+		int levels = settings.kawaseLevels < 1 ? 1 : (settings.kawaseLevels > MAX_KAWASE_LEVELS ? MAX_KAWASE_LEVELS : settings.kawaseLevels);
+		float taps = 0.0f;
+		for (int i = 1; i <= levels; i++)
+		{
+			float area = 1.0f / (float)(1 << (i * 2));
+			taps += 5.0f * area; //Downsample into level i
+			taps += 8.0f * area * 4.0f; //Upsample into level i - 1
+		}
+		return taps;
+	}
+	default:
+		return 1.0f;
+	}
+}
+
+jameslib::PostProcessChain::PostProcessChain(RenderTargetPool& pool, const std::string& shaderDirectory, int colorFormat)
+	: m_pool(pool), m_colorFormat(colorFormat),
+	m_separableShader(shaderDirectory + "postprocess.vert", shaderDirectory + "blurSeparable.frag"),
+	m_kawaseDownShader(shaderDirectory + "postprocess.vert", shaderDirectory + "kawaseDown.frag"),
+	m_kawaseUpShader(shaderDirectory + "postprocess.vert", shaderDirectory + "kawaseUp.frag")
+{
+	glCreateVertexArrays(1, &m_vao);
+	glCreateSamplers(1, &m_sampler);
+	glSamplerParameteri(m_sampler, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glSamplerParameteri(m_sampler, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glSamplerParameteri(m_sampler, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glSamplerParameteri(m_sampler, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+}
+
+jameslib::PostProcessChain::~PostProcessChain()
+{
+	glDeleteSamplers(1, &m_sampler);
+	glDeleteVertexArrays(1, &m_vao);
+}
+
+unsigned int jameslib::PostProcessChain::blur(unsigned int source, unsigned int width, unsigned int height, const BlurSettings& settings)
+{
+	if (settings.mode == BlurMode::NONE || settings.mode == BlurMode::BOX_5X5) {
+		return source;
+	}
+	glBindVertexArray(m_vao);
+	glBindSampler(0, m_sampler);
+	unsigned int result = settings.mode == BlurMode::DUAL_KAWASE ? blurKawase(source, width, height, settings) : blurSeparable(source, width, height, settings);
+	glBindSampler(0, 0);
+	return result;
+}
+
+unsigned int jameslib::PostProcessChain::blurSeparable(unsigned int source, unsigned int width, unsigned int height, const BlurSettings& settings)
+{
+	int downsample = settings.downsample > 1 ? 2 : 1;
+	unsigned int targetWidth = levelSize(width, downsample - 1);
+	unsigned int targetHeight = levelSize(height, downsample - 1);
+	int numTaps = computeLinearTaps(settings.radius / downsample, settings.mode == BlurMode::SEPARABLE_GAUSSIAN, m_offsets, m_weights, MAX_BLUR_TAPS);
+	m_separableShader.use();
+
+	Framebuffer downsampled;
+	if (downsample > 1) {
+		//One bilinear fetch at the center of each half resolution pixel averages a 2x2 block
+		const float one = 1.0f;
+		const float zero = 0.0f;
+		glUniform1fv(m_separableShader.getUniformLocation("_Offsets"), 1, &zero);
+		glUniform1fv(m_separableShader.getUniformLocation("_Weights"), 1, &one);
+		m_separableShader.setVec2("_Direction", 0.0f, 0.0f);
+		m_separableShader.setInt("_NumTaps", 1);
+		downsampled = draw(source, targetWidth, targetHeight);
+		source = downsampled.colorBuffers[0];
+	}
+	glUniform1fv(m_separableShader.getUniformLocation("_Offsets"), numTaps, m_offsets);
+	glUniform1fv(m_separableShader.getUniformLocation("_Weights"), numTaps, m_weights);
+	m_separableShader.setInt("_NumTaps", numTaps);
+
+	m_separableShader.setVec2("_Direction", 1.0f / targetWidth, 0.0f);
+	Framebuffer horizontal = draw(source, targetWidth, targetHeight);
+	if (downsample > 1) {
+		m_pool.releaseFramebuffer(downsampled);
+	}
+	//Reuses the downsampled target when there is one
+	m_separableShader.setVec2("_Direction", 0.0f, 1.0f / targetHeight);
+	Framebuffer vertical = draw(horizontal.colorBuffers[0], targetWidth, targetHeight);
+	m_pool.releaseFramebuffer(horizontal);
+	return vertical.colorBuffers[0];
+}
+
+unsigned int jameslib::PostProcessChain::blurKawase(unsigned int source, unsigned int width, unsigned int height, const BlurSettings& settings)
+{
+	int levels = settings.kawaseLevels < 1 ? 1 : (settings.kawaseLevels > MAX_KAWASE_LEVELS ? MAX_KAWASE_LEVELS : settings.kawaseLevels);
+
+	//Level i is width >> i. Each level is read once by the next pass, then goes back to the pool.
+	Framebuffer input;
+	input.colorBuffers[0] = source;
+	input.width = width;
+	input.height = height;
+	m_kawaseDownShader.use();
+	for (int i = 1; i <= levels; i++)
+	{
+		m_kawaseDownShader.setVec2("_HalfTexel", 0.5f / input.width, 0.5f / input.height);
+		Framebuffer output = draw(input.colorBuffers[0], levelSize(width, i), levelSize(height, i));
+		if (i > 1) {
+			m_pool.releaseFramebuffer(input);
+		}
+		input = output;
+	}
+
+	m_kawaseUpShader.use();
+	for (int i = levels - 1; i >= 0; i--)
+	{
+		m_kawaseUpShader.setVec2("_HalfTexel", 0.5f / input.width, 0.5f / input.height);
+		Framebuffer output = draw(input.colorBuffers[0], levelSize(width, i), levelSize(height, i));
+		m_pool.releaseFramebuffer(input);
+		input = output;
+	}
+	return input.colorBuffers[0];
+}
+
+jameslib::Framebuffer jameslib::PostProcessChain::draw(unsigned int source, unsigned int width, unsigned int height)
+{
+	FramebufferDesc desc;
+	desc.width = width;
+	desc.height = height;
+	desc.colorFormats[0] = m_colorFormat;
+	desc.numColorBuffers = 1;
+	Framebuffer target = m_pool.acquireFramebuffer(desc);
+	glBindFramebuffer(GL_FRAMEBUFFER, target.fbo);
+	glViewport(0, 0, target.width, target.height);
+	glBindTextureUnit(0, source);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	return target;
+}
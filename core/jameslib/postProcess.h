@@ -0,0 +1,78 @@
+#pragma once
+
+#include "../ew/shader.h"
+#include "framebuffer.h"
+#include "renderTargetPool.h"
+#include <string>
+
+namespace jameslib
+{
+	//Bilinear fetches per side of a separable pass, including the center. Mirrored by blurSeparable.frag.
+	const int MAX_BLUR_TAPS = 16;
+	const int MAX_KAWASE_LEVELS = 5;
+
+	//BOX_5X5 is the original nested loop in postprocess.frag and stays there as the reference.
+	//The other modes run in PostProcessChain and hand the composite pass a blurred texture.
+	enum class BlurMode
+	{
+		NONE,
+		BOX_5X5,
+		SEPARABLE_BOX,
+		SEPARABLE_GAUSSIAN,
+		DUAL_KAWASE
+	};
+
+	struct BlurSettings
+	{
+		BlurMode mode = BlurMode::NONE;
+		float radius = 8.0f; //Separable kernel half width in full resolution pixels
+		int downsample = 1; //Separable passes run at 1 = full or 2 = half resolution
+		int kawaseLevels = 3; //Each level halves the resolution and roughly doubles the radius
+	};
+
+	//One side of a symmetric kernel with neighbouring texels merged into a single bilinear fetch.
+	//offsets[0] is the center. Offsets are in texels. Returns the number of taps written, radius is
+	//clamped so they fit in maxTaps.
+	int computeLinearTaps(float radius, bool gaussian, float* offsets, float* weights, int maxTaps);
+
+	//Texture fetches per full resolution pixel, summed over every pass. The final composite read is not counted.
+	float getBlurTapsPerPixel(const BlurSettings& settings);
+
+	//Runs the blur modes with intermediate targets from a RenderTargetPool. Each intermediate is released as
+	//soon as the next pass has read it, so the ping pong and pyramid levels alias earlier targets of the frame.
+	//Targets are sampled through a linear, clamp to edge sampler on unit 0 so any source texture can be passed in.
+	class PostProcessChain
+	{
+	public:
+		//Loads postprocess.vert, blurSeparable.frag, kawaseDown.frag and kawaseUp.frag from shaderDirectory
+		PostProcessChain(RenderTargetPool& pool, const std::string& shaderDirectory, int colorFormat = GL_RGB16F);
+		~PostProcessChain();
+		PostProcessChain(const PostProcessChain&) = delete;
+		PostProcessChain& operator=(const PostProcessChain&) = delete;
+
+		//Returns a pool texture holding the blurred source, which is width x height. Release it to the pool once
+		//it has been read. NONE and BOX_5X5 return source itself.
+		//Changes the framebuffer, viewport, program, vertex array and texture unit 0.
+		unsigned int blur(unsigned int source, unsigned int width, unsigned int height, const BlurSettings& settings);
+		//Pool targets filter with GL_NEAREST, so bind this before sampling blur()'s result at full resolution, e.g.
+		//in the composite. Otherwise half resolution results upsample in 2x2 blocks. Undo with glBindSampler(unit, 0).
+		inline unsigned int getLinearSampler()const { return m_sampler; }
+	private:
+		unsigned int blurSeparable(unsigned int source, unsigned int width, unsigned int height, const BlurSettings& settings);
+		unsigned int blurKawase(unsigned int source, unsigned int width, unsigned int height, const BlurSettings& settings);
+		//Draws a fullscreen pass with the current program into a new pool target and returns it
+		Framebuffer draw(unsigned int source, unsigned int width, unsigned int height);
+
+		RenderTargetPool& m_pool;
+		int m_colorFormat;
+
+		ew::Shader m_separableShader;
+		ew::Shader m_kawaseDownShader;
+		ew::Shader m_kawaseUpShader;
+		unsigned int m_vao = 0;
+		unsigned int m_sampler = 0;
+
+		float m_offsets[MAX_BLUR_TAPS];
+		float m_weights[MAX_BLUR_TAPS];
+	};
+}
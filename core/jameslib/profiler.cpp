@@ -0,0 +1,228 @@
+#include "profiler.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+#include <chrono>
+
+namespace
+{
+	void writeJsonString(FILE* file, const std::string& s)
+	{
+		fputc('"', file);
+		for (size_t i = 0; i < s.size(); i++)
+		{
+			char c = s[i];
+			if (c == '"' || c == '\\') {
+				fputc('\\', file);
+				fputc(c, file);
+			}
+			else if ((unsigned char)c >= 0x20) {
+				fputc(c, file);
+			}
+		}
+		fputc('"', file);
+	}
+}
+
+jameslib::Profiler::Profiler()
+	: m_startTicks(std::chrono::steady_clock::now().time_since_epoch().count())
+{
+}
+
+jameslib::Profiler::~Profiler()
+{
+	//CPU only users never create queries, so never need GL loaded
+	for (unsigned int i = 0; i < PROFILER_QUERY_LATENCY; i++)
+	{
+		if (!m_queryFrames[i].queries.empty()) {
+			glDeleteQueries((GLsizei)m_queryFrames[i].queries.size(), m_queryFrames[i].queries.data());
+		}
+	}
+}
+
+void jameslib::Profiler::beginFrame()
+{
+	//The queries in this ring slot were issued PROFILER_QUERY_LATENCY frames ago. Results that still
+	//aren't available are dropped rather than waited on.
+	QueryFrame& queryFrame = m_queryFrames[m_frameIndex % PROFILER_QUERY_LATENCY];
+	if (!queryFrame.pending.empty()) {
+		unsigned int slot = (unsigned int)(queryFrame.frameIndex % PROFILER_HISTORY_FRAMES);
+		ProfilerFrame& frame = m_frames[slot];
+		for (size_t i = 0; i < queryFrame.pending.size(); i++)
+		{
+			const PendingQuery& pending = queryFrame.pending[i];
+			int available = 0;
+			glGetQueryObjectiv(pending.query, GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				continue;
+			}
+			GLuint64 elapsedNs = 0;
+			glGetQueryObjectui64v(pending.query, GL_QUERY_RESULT, &elapsedNs);
+			float ms = (float)(elapsedNs / 1e6);
+			m_zones[pending.zone].gpuMs[slot] += ms;
+			if (frame.index == queryFrame.frameIndex && pending.event < frame.events.size()) {
+				frame.events[pending.event].gpuMs = ms;
+			}
+		}
+		for (size_t i = 0; i < m_zones.size(); i++)
+		{
+			ProfilerZone& zone = m_zones[i];
+			if (zone.hasGpu) {
+				zone.avgGpuMs = zone.avgGpuMs * 0.95f + zone.gpuMs[slot] * 0.05f;
+			}
+		}
+		queryFrame.pending.clear();
+	}
+	queryFrame.frameIndex = m_frameIndex;
+
+	unsigned int slot = (unsigned int)(m_frameIndex % PROFILER_HISTORY_FRAMES);
+	for (size_t i = 0; i < m_zones.size(); i++)
+	{
+		m_zones[i].cpuMs[slot] = 0.0f;
+		m_zones[i].gpuMs[slot] = 0.0f;
+	}
+	ProfilerFrame& frame = m_frames[slot];
+	frame.index = m_frameIndex;
+	frame.startMs = nowMs();
+	frame.endMs = frame.startMs;
+	frame.events.clear();
+	m_depth = 0;
+}
+
+void jameslib::Profiler::endFrame()
+{
+	unsigned int slot = (unsigned int)(m_frameIndex % PROFILER_HISTORY_FRAMES);
+	m_frames[slot].endMs = nowMs();
+	for (size_t i = 0; i < m_zones.size(); i++)
+	{
+		ProfilerZone& zone = m_zones[i];
+		zone.avgCpuMs = zone.avgCpuMs * 0.95f + zone.cpuMs[slot] * 0.05f;
+	}
+	m_frameIndex++;
+}
+
+uint32_t jameslib::Profiler::beginZone(const char* name, bool gpu)
+{
+	ProfilerFrame& frame = m_frames[m_frameIndex % PROFILER_HISTORY_FRAMES];
+	ProfilerEvent event;
+	event.zone = getZoneIndex(name);
+	event.depth = m_depth++;
+	event.startMs = nowMs();
+	event.endMs = event.startMs;
+	event.gpuMs = -1.0f;
+	uint32_t eventIndex = (uint32_t)frame.events.size();
+	frame.events.push_back(event);
+
+	if (gpu && !m_gpuZoneOpen) {
+		QueryFrame& queryFrame = m_queryFrames[m_frameIndex % PROFILER_QUERY_LATENCY];
+		if (queryFrame.pending.size() == queryFrame.queries.size()) {
+			unsigned int query = 0;
+			glGenQueries(1, &query);
+			queryFrame.queries.push_back(query);
+		}
+		PendingQuery pending;
+		pending.query = queryFrame.queries[queryFrame.pending.size()];
+		pending.zone = event.zone;
+		pending.event = eventIndex;
+		queryFrame.pending.push_back(pending);
+		glBeginQuery(GL_TIME_ELAPSED, pending.query);
+		m_zones[event.zone].hasGpu = true;
+		m_gpuZoneOpen = true;
+		m_openGpuEvent = eventIndex;
+	}
+	return eventIndex;
+}
+
+void jameslib::Profiler::endZone(uint32_t event)
+{
+	if (m_gpuZoneOpen && m_openGpuEvent == event) {
+		glEndQuery(GL_TIME_ELAPSED);
+		m_gpuZoneOpen = false;
+	}
+	m_depth = m_depth > 0 ? m_depth - 1 : 0;
+
+	//Zones left open across beginFrame belong to a frame that was already reset
+	ProfilerFrame& frame = m_frames[m_frameIndex % PROFILER_HISTORY_FRAMES];
+	if (event >= frame.events.size()) {
+		return;
+	}
+	ProfilerEvent& e = frame.events[event];
+	e.endMs = nowMs();
+	m_zones[e.zone].cpuMs[m_frameIndex % PROFILER_HISTORY_FRAMES] += (float)(e.endMs - e.startMs);
+}
+
+const jameslib::ProfilerZone* jameslib::Profiler::findZone(const char* name)const
+{
+	for (size_t i = 0; i < m_zones.size(); i++)
+	{
+		if (m_zones[i].name == name) {
+			return &m_zones[i];
+		}
+	}
+	return nullptr;
+}
+
+bool jameslib::Profiler::writeChromeTrace(const char* filePath)const
+{
+	FILE* file = fopen(filePath, "w");
+	if (!file) {
+		printf("Failed to open %s for writing\n", filePath);
+		return false;
+	}
+	fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n");
+	fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}");
+
+	//Oldest retained frame first, skipping the one in progress
+	for (unsigned int i = 1; i < PROFILER_HISTORY_FRAMES; i++)
+	{
+		const ProfilerFrame& frame = m_frames[(m_frameIndex + i) % PROFILER_HISTORY_FRAMES];
+		if (frame.endMs <= frame.startMs || frame.index >= m_frameIndex) {
+			continue;
+		}
+		//Chrome traces are in microseconds
+		fprintf(file, ",\n{\"name\":\"Frame %llu\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+			(unsigned long long)frame.index, frame.startMs * 1000.0, (frame.endMs - frame.startMs) * 1000.0);
+		for (size_t j = 0; j < frame.events.size(); j++)
+		{
+			const ProfilerEvent& e = frame.events[j];
+			fprintf(file, ",\n{\"name\":");
+			writeJsonString(file, m_zones[e.zone].name);
+			fprintf(file, ",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":%.3f,\"dur\":%.3f}",
+				e.startMs * 1000.0, (e.endMs - e.startMs) * 1000.0);
+			if (e.gpuMs >= 0.0f) {
+				fprintf(file, ",\n{\"name\":");
+				writeJsonString(file, m_zones[e.zone].name);
+				fprintf(file, ",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":%.3f,\"dur\":%.3f}",
+					e.startMs * 1000.0, e.gpuMs * 1000.0);
+			}
+		}
+	}
+	fprintf(file, "\n]}\n");
+	fclose(file);
+	return true;
+}
+
+double jameslib::Profiler::nowMs()const
+{
+	std::chrono::steady_clock::duration elapsed(std::chrono::steady_clock::now().time_since_epoch().count() - m_startTicks);
+	return std::chrono::duration<double, std::milli>(elapsed).count();
+}
+
+uint32_t jameslib::Profiler::getZoneIndex(const char* name)
+{
+	for (size_t i = 0; i < m_zones.size(); i++)
+	{
+		if (m_zones[i].name == name) {
+			return (uint32_t)i;
+		}
+	}
+	m_zones.push_back(ProfilerZone());
+	m_zones.back().name = name;
+	return (uint32_t)(m_zones.size() - 1);
+}
+
+jameslib::Profiler& jameslib::getProfiler()
+{
+	static Profiler profiler;
+	return profiler;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace jameslib
+{
+	//Frames of zone timings and CPU events kept for the charts and trace export
+	const unsigned int PROFILER_HISTORY_FRAMES = 128;
+	//GPU zones are read back this many frames after they were issued so the queries never stall
+	const unsigned int PROFILER_QUERY_LATENCY = 4;
+
+	//Per frame totals of every zone with the same name. GPU times land PROFILER_QUERY_LATENCY frames late.
+	struct ProfilerZone
+	{
+		std::string name;
+		float cpuMs[PROFILER_HISTORY_FRAMES] = {};
+		float gpuMs[PROFILER_HISTORY_FRAMES] = {};
+		float avgCpuMs = 0.0f; //Smoothed over recent frames
+		float avgGpuMs = 0.0f;
+		bool hasGpu = false;
+	};
+
+	//One scope on the CPU timeline, relative to the profiler's start
+	struct ProfilerEvent
+	{
+		uint32_t zone;
+		uint32_t depth;
+		double startMs;
+		double endMs;
+		float gpuMs; //Negative until the GPU time is known, or for CPU only zones
+	};
+
+	struct ProfilerFrame
+	{
+		uint64_t index = 0;
+		double startMs = 0.0;
+		double endMs = 0.0;
+		std::vector<ProfilerEvent> events;
+	};
+
+	//CPU zones nest freely. GPU zones wrap GL_TIME_ELAPSED queries, which cannot nest, so a GPU zone
+	//opened inside another is timed on the CPU only. Queries come from a ring of per frame pools and are
+	//only read once GL reports them available, so the profiler never waits on the GPU. Record from the render thread only.
+	class Profiler
+	{
+	public:
+		Profiler();
+		~Profiler();
+		Profiler(const Profiler&) = delete;
+		Profiler& operator=(const Profiler&) = delete;
+
+		//Collects GPU results issued PROFILER_QUERY_LATENCY frames ago and starts a new frame
+		void beginFrame();
+		void endFrame();
+
+		//Returns an event id for endZone
+		uint32_t beginZone(const char* name, bool gpu);
+		void endZone(uint32_t event);
+
+		inline const std::vector<ProfilerZone>& getZones()const { return m_zones; }
+		const ProfilerZone* findZone(const char* name)const;
+		//History slot of the last completed frame
+		inline unsigned int getLastFrameSlot()const { return (unsigned int)((m_frameIndex + PROFILER_HISTORY_FRAMES - 1) % PROFILER_HISTORY_FRAMES); }
+		inline const ProfilerFrame& getFrame(unsigned int slot)const { return m_frames[slot]; }
+		inline uint64_t getFrameIndex()const { return m_frameIndex; }
+
+		//Writes every retained frame as Chrome trace events (chrome://tracing, Perfetto). CPU zones go on
+		//thread 1. GPU zones go on thread 2, placed at their CPU start since elapsed queries carry no timestamp.
+		bool writeChromeTrace(const char* filePath)const;
+	private:
+		struct PendingQuery
+		{
+			unsigned int query;
+			uint32_t zone;
+			uint32_t event;
+		};
+		struct QueryFrame
+		{
+			uint64_t frameIndex = 0;
+			std::vector<unsigned int> queries; //Pooled query objects
+			std::vector<PendingQuery> pending;
+		};
+		double nowMs()const;
+		uint32_t getZoneIndex(const char* name);
+
+		std::vector<ProfilerZone> m_zones;
+		ProfilerFrame m_frames[PROFILER_HISTORY_FRAMES];
+		QueryFrame m_queryFrames[PROFILER_QUERY_LATENCY];
+		uint64_t m_frameIndex = 0;
+		uint32_t m_depth = 0;
+		bool m_gpuZoneOpen = false;
+		uint32_t m_openGpuEvent = 0;
+		int64_t m_startTicks;
+	};
+
+	//The profiler the zone macros record into
+	Profiler& getProfiler();
+
+	class ScopedProfileZone
+	{
+	public:
+		ScopedProfileZone(const char* name, bool gpu = false) : m_event(getProfiler().beginZone(name, gpu)) {}
+		~ScopedProfileZone() { getProfiler().endZone(m_event); }
+	private:
+		uint32_t m_event;
+	};
+}
+
+#define JAMESLIB_PROFILE_CONCAT_INNER(a, b) a##b
+#define JAMESLIB_PROFILE_CONCAT(a, b) JAMESLIB_PROFILE_CONCAT_INNER(a, b)
+//Times the rest of the enclosing scope on the CPU
+#define PROFILE_ZONE(name) jameslib::ScopedProfileZone JAMESLIB_PROFILE_CONCAT(profileZone, __LINE__)(name)
+//Times the rest of the enclosing scope on the CPU and the GPU
+#define PROFILE_GPU_ZONE(name) jameslib::ScopedProfileZone JAMESLIB_PROFILE_CONCAT(profileZone, __LINE__)(name, true)
@@ -0,0 +1,222 @@
+#include "renderQueue.h"
+#include "../ew/external/glad.h"
+#include <algorithm>
+
+static const unsigned int UNKNOWN_BINDING = 0xFFFFFFFF;
+
+jameslib::GLStateCache::GLStateCache()
+{
+	invalidate();
+}
+
+void jameslib::GLStateCache::useProgram(unsigned int program)
+{
+	if (program == m_program) {
+		m_stats.programBindsElided++;
+		return;
+	}
+	glUseProgram(program);
+	m_program = program;
+	m_stats.programBinds++;
+}
+
+void jameslib::GLStateCache::bindVertexArray(unsigned int vao)
+{
+	if (vao == m_vertexArray) {
+		m_stats.vertexArrayBindsElided++;
+		return;
+	}
+	glBindVertexArray(vao);
+	m_vertexArray = vao;
+	m_stats.vertexArrayBinds++;
+}
+
+void jameslib::GLStateCache::bindTexture(unsigned int unit, unsigned int texture)
+{
+	if (unit < MAX_TEXTURE_UNITS && texture == m_textures[unit]) {
+		m_stats.textureBindsElided++;
+		return;
+	}
+	glBindTextureUnit(unit, texture);
+	if (unit < MAX_TEXTURE_UNITS) {
+		m_textures[unit] = texture;
+	}
+	m_stats.textureBinds++;
+}
+
+void jameslib::GLStateCache::invalidate()
+{
+	m_program = UNKNOWN_BINDING;
+	m_vertexArray = UNKNOWN_BINDING;
+	for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+	{
+		m_textures[i] = UNKNOWN_BINDING;
+	}
+}
+
+uint64_t jameslib::makeSortKey(unsigned int pass, unsigned int shader, unsigned int texture, unsigned int mesh, float depth01)
+{
+	uint64_t depth = (uint64_t)(glm::clamp(depth01, 0.0f, 1.0f) * 0xFFFFF);
+	return ((uint64_t)(pass & 0xF) << 60)
+		| ((uint64_t)(shader & 0xFFF) << 48)
+		| ((uint64_t)(texture & 0xFFF) << 36)
+		| ((uint64_t)(mesh & 0xFFFF) << 20)
+		| depth;
+}
+
+jameslib::DrawItem jameslib::makeDrawItem(const ew::Mesh& mesh, unsigned int program, const glm::mat4& modelMatrix)
+{
+	DrawItem item;
+	item.program = program;
+	item.vao = mesh.getVAO();
+	item.numIndices = mesh.getNumIndices();
+	item.firstIndex = mesh.getFirstIndex();
+	item.baseVertex = (int)mesh.getBaseVertex();
+	item.arena = mesh.getArena();
+	item.quantization = mesh.getPositionQuantization();
+	item.modelMatrix = modelMatrix;
+	return item;
+}
+
+void jameslib::RenderQueue::clear()
+{
+	m_items.clear();
+	m_keys.clear();
+	m_order.clear();
+}
+
+void jameslib::RenderQueue::submit(const DrawItem& item)
+{
+	m_items.push_back(item);
+}
+
+/// <summary>
+/// LSD radix sort of (key, index) pairs, 8 bits per pass. Byte positions where every key
+/// agrees (e.g. the pass bits of a single pass frame) are skipped.
+/// </summary>
+void jameslib::RenderQueue::sort()
+{
+	size_t count = m_items.size();
+	m_keys.resize(count);
+	m_order.resize(count);
+	m_scratchKeys.resize(count);
+	m_scratchOrder.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		m_keys[i] = m_items[i].key;
+		m_order[i] = (uint32_t)i;
+	}
+
+	uint32_t histograms[8][256] = {};
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t key = m_keys[i];
+		for (int b = 0; b < 8; b++)
+		{
+			histograms[b][(key >> (b * 8)) & 0xFF]++;
+		}
+	}
+	for (int b = 0; b < 8; b++)
+	{
+		uint32_t* histogram = histograms[b];
+		if (count == 0 || histogram[(m_keys[0] >> (b * 8)) & 0xFF] == count) {
+			continue;
+		}
+		uint32_t offset = 0;
+		for (int i = 0; i < 256; i++)
+		{
+			uint32_t n = histogram[i];
+			histogram[i] = offset;
+			offset += n;
+		}
+		for (size_t i = 0; i < count; i++)
+		{
+			uint32_t dst = histogram[(m_keys[i] >> (b * 8)) & 0xFF]++;
+			m_scratchKeys[dst] = m_keys[i];
+			m_scratchOrder[dst] = m_order[i];
+		}
+		m_keys.swap(m_scratchKeys);
+		m_order.swap(m_scratchOrder);
+	}
+}
+
+static jameslib::ArenaMesh toArenaMesh(const jameslib::DrawItem& item)
+{
+	jameslib::ArenaMesh mesh;
+	mesh.baseVertex = (unsigned int)item.baseVertex;
+	mesh.firstIndex = item.firstIndex;
+	mesh.numIndices = (unsigned int)item.numIndices;
+	return mesh;
+}
+
+//Whether next can join a multi-draw started by item
+static bool canBatch(const jameslib::DrawItem& item, const jameslib::DrawItem& next)
+{
+	if (next.arena != item.arena || next.instanceBuffer != 0 || next.program != item.program) {
+		return false;
+	}
+	for (unsigned int t = 0; t < jameslib::MAX_DRAW_TEXTURES; t++)
+	{
+		if (next.textures[t] != item.textures[t]) {
+			return false;
+		}
+	}
+	return true;
+}
+
+void jameslib::RenderQueue::execute(unsigned int pass, GLStateCache& stateCache, DrawBatch* batch) const
+{
+	//Keys are sorted, so a pass is one contiguous range
+	uint64_t passBegin = (uint64_t)pass << 60;
+	auto first = std::lower_bound(m_keys.begin(), m_keys.end(), passBegin);
+	auto it = first;
+	while (it != m_keys.end() && getSortKeyPass(*it) == pass) {
+		const DrawItem& item = m_items[m_order[it - m_keys.begin()]];
+		++it;
+		stateCache.useProgram(item.program);
+		for (unsigned int t = 0; t < MAX_DRAW_TEXTURES; t++)
+		{
+			if (item.textures[t]) {
+				stateCache.bindTexture(t, item.textures[t]);
+			}
+		}
+		stateCache.bindVertexArray(item.vao);
+		glVertexAttrib3f(ew::VERTEX_ATTRIB_POS_OFFSET, item.quantization.offset.x, item.quantization.offset.y, item.quantization.offset.z);
+		glVertexAttrib3f(ew::VERTEX_ATTRIB_POS_SCALE, item.quantization.scale.x, item.quantization.scale.y, item.quantization.scale.z);
+		const void* indexOffset = (const void*)(sizeof(unsigned int) * item.firstIndex);
+		if (batch && item.arena && item.instanceBuffer == 0) {
+			//Each merged draw reads its model matrix from the batch's instance stream
+			batch->clear();
+			batch->add(toArenaMesh(item), item.modelMatrix);
+			while (it != m_keys.end() && getSortKeyPass(*it) == pass) {
+				const DrawItem& next = m_items[m_order[it - m_keys.begin()]];
+				if (!canBatch(item, next)) {
+					break;
+				}
+				batch->add(toArenaMesh(next), next.modelMatrix);
+				++it;
+			}
+			batch->draw(*item.arena);
+			continue;
+		}
+		if (item.instanceBuffer == 0) {
+			ew::setModelMatrix(item.modelMatrix);
+			glDrawElementsBaseVertex(GL_TRIANGLES, item.numIndices, GL_UNSIGNED_INT, indexOffset, item.baseVertex);
+			continue;
+		}
+		if (item.instanceCount <= 0) {
+			continue;
+		}
+		//Same instance stream setup as ew::Mesh::drawInstanced
+		glBindVertexBuffer(ew::VERTEX_BINDING_INSTANCES, item.instanceBuffer, sizeof(glm::mat4) * item.firstInstance, sizeof(glm::mat4));
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			glEnableVertexAttribArray(ew::VERTEX_ATTRIB_MODEL + i);
+		}
+		glDrawElementsInstancedBaseVertex(GL_TRIANGLES, item.numIndices, GL_UNSIGNED_INT, indexOffset, item.instanceCount, item.baseVertex);
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			glDisableVertexAttribArray(ew::VERTEX_ATTRIB_MODEL + i);
+		}
+	}
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "geometryArena.h"
+#include "../ew/mesh.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+namespace jameslib
+{
+	const int MAX_TEXTURE_UNITS = 16;
+
+	//Binds per frame issued to GL vs dropped because the state was already current
+	struct StateCacheStats
+	{
+		int programBinds = 0, programBindsElided = 0;
+		int vertexArrayBinds = 0, vertexArrayBindsElided = 0;
+		int textureBinds = 0, textureBindsElided = 0;
+	};
+
+	//Shadows program, VAO and texture unit bindings so redundant binds never reach the driver.
+	//Call invalidate after any code that binds these behind the cache's back.
+	class GLStateCache
+	{
+	public:
+		GLStateCache();
+		void useProgram(unsigned int program);
+		void bindVertexArray(unsigned int vao);
+		void bindTexture(unsigned int unit, unsigned int texture);
+		void invalidate();
+		inline const StateCacheStats& getStats()const { return m_stats; }
+		inline void resetStats() { m_stats = StateCacheStats(); }
+	private:
+		//0xFFFFFFFF means unknown, so the next bind always goes through
+		unsigned int m_program;
+		unsigned int m_vertexArray;
+		unsigned int m_textures[MAX_TEXTURE_UNITS];
+		StateCacheStats m_stats;
+	};
+
+	//Sort key, most significant first:
+	//pass (4 bits) | shader (12) | texture (12) | mesh (16) | depth (20)
+	//Sorting by it groups draws by pass, then by the most expensive state change.
+	uint64_t makeSortKey(unsigned int pass, unsigned int shader, unsigned int texture, unsigned int mesh, float depth01);
+	inline unsigned int getSortKeyPass(uint64_t key) { return (unsigned int)(key >> 60); }
+
+	const int MAX_DRAW_TEXTURES = 2;
+	struct DrawItem
+	{
+		uint64_t key = 0;
+		unsigned int program = 0;
+		unsigned int vao = 0;
+		unsigned int textures[MAX_DRAW_TEXTURES] = {}; //Bound to units 0..n, 0 leaves the unit alone
+		int numIndices = 0;
+		unsigned int firstIndex = 0;
+		int baseVertex = 0;
+		//Set for arena backed meshes, which execute can merge into one multi-draw
+		const GeometryArena* arena = nullptr;
+		ew::PositionQuantization quantization;
+		glm::mat4 modelMatrix = glm::mat4(1.0f);
+		//Instanced when instanceBuffer != 0, see ew::Mesh::drawInstanced
+		unsigned int instanceBuffer = 0;
+		int instanceCount = 0;
+		int firstInstance = 0;
+	};
+
+	//Fills the geometry fields of a draw item from a mesh
+	DrawItem makeDrawItem(const ew::Mesh& mesh, unsigned int program, const glm::mat4& modelMatrix);
+
+	//Collects a frame's draws, radix sorts them by key and replays one pass at a time through a GLStateCache
+	class RenderQueue
+	{
+	public:
+		void clear();
+		void submit(const DrawItem& item);
+		void sort();
+		//Draws every item whose key has this pass. Call sort first.
+		//With a batch, consecutive non-instanced arena items sharing program and textures go out as one
+		//glMultiDrawElementsIndirect.
+		void execute(unsigned int pass, GLStateCache& stateCache, DrawBatch* batch = nullptr)const;
+		inline size_t getNumItems()const { return m_items.size(); }
+	private:
+		std::vector<DrawItem> m_items;
+		std::vector<uint64_t> m_keys;
+		std::vector<uint32_t> m_order; //Sorted item indices
+		std::vector<uint64_t> m_scratchKeys;
+		std::vector<uint32_t> m_scratchOrder;
+	};
+}
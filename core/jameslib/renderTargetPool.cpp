@@ -0,0 +1,209 @@
+#include "renderTargetPool.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+#include <string.h>
+
+jameslib::RenderTargetPool::~RenderTargetPool()
+{
+	for (size_t i = 0; i < m_framebuffers.size(); i++)
+	{
+		glDeleteFramebuffers(1, &m_framebuffers[i].fbo);
+	}
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		glDeleteTextures(1, &m_textures[i].texture);
+	}
+}
+
+void jameslib::RenderTargetPool::beginFrame()
+{
+	m_frame++;
+	for (size_t i = m_textures.size(); i-- > 0;)
+	{
+		if (!m_textures[i].inUse && m_frame - m_textures[i].lastUsedFrame > RENDER_TARGET_MAX_IDLE_FRAMES) {
+			deleteTexture(i);
+		}
+	}
+	m_stats.requestedBytes = 0;
+	m_stats.peakBytesInUse = m_bytesInUse;
+}
+
+unsigned int jameslib::RenderTargetPool::acquireTexture(unsigned int width, unsigned int height, int format)
+{
+	//Minimized windows report a size of 0
+	width = width > 0 ? width : 1;
+	height = height > 0 ? height : 1;
+
+	size_t index = m_textures.size();
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		const Texture& t = m_textures[i];
+		if (!t.inUse && t.width == width && t.height == height && t.format == format) {
+			index = i;
+			break;
+		}
+	}
+	if (index == m_textures.size()) {
+		Texture t;
+		glCreateTextures(GL_TEXTURE_2D, 1, &t.texture);
+		glTextureStorage2D(t.texture, 1, format, width, height);
+		glTextureParameteri(t.texture, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTextureParameteri(t.texture, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTextureParameteri(t.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTextureParameteri(t.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		t.width = width;
+		t.height = height;
+		t.format = format;
+		t.bytes = (size_t)width * height * getFormatBytesPerPixel(format);
+		t.inUse = false;
+		m_textures.push_back(t);
+		m_stats.numTextures++;
+		m_stats.allocatedBytes += t.bytes;
+		m_stats.texturesCreated++;
+	}
+
+	Texture& t = m_textures[index];
+	t.inUse = true;
+	t.lastUsedFrame = m_frame;
+	m_bytesInUse += t.bytes;
+	m_stats.requestedBytes += t.bytes;
+	if (m_bytesInUse > m_stats.peakBytesInUse) {
+		m_stats.peakBytesInUse = m_bytesInUse;
+	}
+	return t.texture;
+}
+
+void jameslib::RenderTargetPool::releaseTexture(unsigned int texture)
+{
+	for (size_t i = 0; i < m_textures.size(); i++)
+	{
+		Texture& t = m_textures[i];
+		if (t.texture == texture && t.inUse) {
+			t.inUse = false;
+			t.lastUsedFrame = m_frame;
+			m_bytesInUse -= t.bytes;
+			return;
+		}
+	}
+	printf("Released a texture the render target pool does not own: %u\n", texture);
+}
+
+jameslib::Framebuffer jameslib::RenderTargetPool::acquireFramebuffer(const FramebufferDesc& desc)
+{
+	Framebuffer framebuffer;
+	framebuffer.width = desc.width > 0 ? desc.width : 1;
+	framebuffer.height = desc.height > 0 ? desc.height : 1;
+	for (unsigned int i = 0; i < desc.numColorBuffers; i++)
+	{
+		framebuffer.colorBuffers[i] = acquireTexture(desc.width, desc.height, desc.colorFormats[i]);
+	}
+	if (desc.depthFormat != 0) {
+		framebuffer.depthBuffer = acquireTexture(desc.width, desc.height, desc.depthFormat);
+	}
+	framebuffer.fbo = getFramebuffer(framebuffer.colorBuffers, desc.numColorBuffers, framebuffer.depthBuffer);
+	return framebuffer;
+}
+
+unsigned int jameslib::RenderTargetPool::getFramebuffer(const unsigned int* colorTextures, unsigned int numColorTextures, unsigned int depthTexture)
+{
+	unsigned int attachments[9] = {};
+	for (unsigned int i = 0; i < numColorTextures; i++)
+	{
+		attachments[i] = colorTextures[i];
+	}
+	attachments[8] = depthTexture;
+
+	for (size_t i = 0; i < m_framebuffers.size(); i++)
+	{
+		if (memcmp(m_framebuffers[i].attachments, attachments, sizeof(attachments)) == 0) {
+			return m_framebuffers[i].fbo;
+		}
+	}
+
+	CachedFramebuffer cached;
+	memcpy(cached.attachments, attachments, sizeof(attachments));
+	glCreateFramebuffers(1, &cached.fbo);
+	GLenum drawBuffers[8];
+	for (unsigned int i = 0; i < numColorTextures; i++)
+	{
+		glNamedFramebufferTexture(cached.fbo, GL_COLOR_ATTACHMENT0 + i, attachments[i], 0);
+		drawBuffers[i] = GL_COLOR_ATTACHMENT0 + i;
+	}
+	if (numColorTextures > 0) {
+		glNamedFramebufferDrawBuffers(cached.fbo, numColorTextures, drawBuffers);
+	}
+	else {
+		glNamedFramebufferDrawBuffer(cached.fbo, GL_NONE);
+		glNamedFramebufferReadBuffer(cached.fbo, GL_NONE);
+	}
+	if (depthTexture) {
+		int depthFormat = 0;
+		for (size_t i = 0; i < m_textures.size(); i++)
+		{
+			if (m_textures[i].texture == depthTexture) {
+				depthFormat = m_textures[i].format;
+			}
+		}
+		bool stencil = depthFormat == GL_DEPTH24_STENCIL8 || depthFormat == GL_DEPTH32F_STENCIL8;
+		glNamedFramebufferTexture(cached.fbo, stencil ? GL_DEPTH_STENCIL_ATTACHMENT : GL_DEPTH_ATTACHMENT, depthTexture, 0);
+	}
+
+	GLenum fboStatus = glCheckNamedFramebufferStatus(cached.fbo, GL_FRAMEBUFFER);
+	if (fboStatus != GL_FRAMEBUFFER_COMPLETE) {
+		printf("Framebuffer incomplete: %d", fboStatus);
+	}
+	m_framebuffers.push_back(cached);
+	m_stats.numFramebuffers = m_framebuffers.size();
+	return cached.fbo;
+}
+
+void jameslib::RenderTargetPool::releaseFramebuffer(Framebuffer& framebuffer)
+{
+	for (size_t i = 0; i < 8; i++)
+	{
+		if (framebuffer.colorBuffers[i]) {
+			releaseTexture(framebuffer.colorBuffers[i]);
+		}
+	}
+	if (framebuffer.depthBuffer) {
+		releaseTexture(framebuffer.depthBuffer);
+	}
+	framebuffer = Framebuffer();
+}
+
+void jameslib::RenderTargetPool::trim()
+{
+	for (size_t i = m_textures.size(); i-- > 0;)
+	{
+		if (!m_textures[i].inUse) {
+			deleteTexture(i);
+		}
+	}
+}
+
+void jameslib::RenderTargetPool::deleteTexture(size_t index)
+{
+	unsigned int texture = m_textures[index].texture;
+	//Cached framebuffers that attach the texture can never match again
+	for (size_t i = m_framebuffers.size(); i-- > 0;)
+	{
+		const CachedFramebuffer& cached = m_framebuffers[i];
+		bool attached = false;
+		for (size_t j = 0; j < 9; j++)
+		{
+			attached = attached || cached.attachments[j] == texture;
+		}
+		if (attached) {
+			glDeleteFramebuffers(1, &m_framebuffers[i].fbo);
+			m_framebuffers[i] = m_framebuffers.back();
+			m_framebuffers.pop_back();
+		}
+	}
+	m_stats.numFramebuffers = m_framebuffers.size();
+
+	glDeleteTextures(1, &texture);
+	m_stats.numTextures--;
+	m_stats.allocatedBytes -= m_textures[index].bytes;
+	m_textures[index] = m_textures.back();
+	m_textures.pop_back();
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "framebuffer.h"
+#include <stddef.h>
+#include <vector>
+
+namespace jameslib
+{
+	//Frames a released texture stays in the pool before it is deleted
+	const unsigned int RENDER_TARGET_MAX_IDLE_FRAMES = 3;
+
+	struct RenderTargetStats
+	{
+		size_t numTextures = 0;
+		size_t numFramebuffers = 0;
+		size_t allocatedBytes = 0; //Everything the pool holds, in use or idle
+		size_t requestedBytes = 0; //Sum of every acquire this frame. Above allocatedBytes when targets were reused.
+		size_t peakBytesInUse = 0; //Most bytes acquired at once this frame
+		size_t texturesCreated = 0; //Since the pool was created
+	};
+
+	//Render targets keyed by size and format. Acquire targets when a pass needs them and release them as
+	//soon as their last reader is done: a later acquire with the same size and format gets the same texture,
+	//so transient targets whose lifetimes don't overlap alias one allocation. Targets requested at a new size
+	//(window resize, layout change) are allocated on demand and the old ones are deleted once idle.
+	//Textures use nearest filtering and clamp to edge; bind a sampler for anything else.
+	class RenderTargetPool
+	{
+	public:
+		RenderTargetPool() = default;
+		~RenderTargetPool();
+		RenderTargetPool(const RenderTargetPool&) = delete;
+		RenderTargetPool& operator=(const RenderTargetPool&) = delete;
+
+		//Deletes textures idle for RENDER_TARGET_MAX_IDLE_FRAMES and resets the per frame stats
+		void beginFrame();
+		unsigned int acquireTexture(unsigned int width, unsigned int height, int format);
+		void releaseTexture(unsigned int texture);
+		//Framebuffer objects are cached by attachments, so reacquiring the same textures reuses the fbo
+		Framebuffer acquireFramebuffer(const FramebufferDesc& desc);
+		//Cached fbo for textures acquired from this pool. depthTexture may be 0.
+		unsigned int getFramebuffer(const unsigned int* colorTextures, unsigned int numColorTextures, unsigned int depthTexture);
+		//Releases every attachment and clears framebuffer
+		void releaseFramebuffer(Framebuffer& framebuffer);
+		//Deletes every idle texture now
+		void trim();
+
+		inline const RenderTargetStats& getStats()const { return m_stats; }
+	private:
+		struct Texture
+		{
+			unsigned int texture;
+			unsigned int width;
+			unsigned int height;
+			int format;
+			size_t bytes;
+			bool inUse;
+			unsigned int lastUsedFrame;
+		};
+		struct CachedFramebuffer
+		{
+			unsigned int fbo;
+			unsigned int attachments[9]; //Color 0-7, depth
+		};
+		void deleteTexture(size_t index);
+
+		std::vector<Texture> m_textures;
+		std::vector<CachedFramebuffer> m_framebuffers;
+		unsigned int m_frame = 0;
+		size_t m_bytesInUse = 0;
+		RenderTargetStats m_stats;
+	};
+}
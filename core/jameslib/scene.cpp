@@ -0,0 +1,117 @@
+#include "scene.h"
+
+jameslib::Entity jameslib::Scene::createEntity()
+{
+	m_numAlive++;
+	if (!m_freeEntities.empty()) {
+		Entity entity = m_freeEntities.back();
+		m_freeEntities.pop_back();
+		return entity;
+	}
+	return m_nextEntity++;
+}
+
+void jameslib::Scene::destroyEntity(Entity entity)
+{
+	if (m_transforms.has(entity)) {
+		TransformNode node = m_transforms.get(entity);
+		m_hierarchy.setParent(node, INVALID_TRANSFORM_NODE);
+		m_freeNodes.push_back(node);
+		m_transforms.remove(entity);
+	}
+	m_renderables.remove(entity);
+	m_bounds.remove(entity);
+	m_freeEntities.push_back(entity);
+	m_numAlive--;
+}
+
+jameslib::TransformNode jameslib::Scene::addTransform(Entity entity, const ew::Transform& local, Entity parent)
+{
+	TransformNode parentNode = parent == INVALID_ENTITY ? INVALID_TRANSFORM_NODE : m_transforms.get(parent);
+	TransformNode node;
+	if (!m_freeNodes.empty()) {
+		node = m_freeNodes.back();
+		m_freeNodes.pop_back();
+		m_hierarchy.setLocal(node, local);
+		m_hierarchy.setParent(node, parentNode);
+	}
+	else {
+		node = m_hierarchy.create(local, parentNode);
+	}
+	m_transforms.add(entity, node);
+	return node;
+}
+
+uint32_t jameslib::Scene::addMaterial(const Material& material)
+{
+	m_materials.push_back(material);
+	return (uint32_t)(m_materials.size() - 1);
+}
+
+void jameslib::Scene::updateTransforms()
+{
+	ScopedSystemTimer timer(getTiming("Transforms"));
+	m_hierarchy.update();
+}
+
+/// <summary>
+/// Keeps the world bounds SoA in step with the bounds pool. A structural change rebuilds it,
+/// otherwise only entities whose world matrix changed this frame are re-transformed.
+/// </summary>
+void jameslib::Scene::updateBounds()
+{
+	ScopedSystemTimer timer(getTiming("Bounds"));
+	const BoundsComponent* bounds = m_bounds.data();
+	const Entity* entities = m_bounds.getEntities();
+	size_t count = m_bounds.size();
+	bool rebuild = m_bounds.getVersion() != m_worldBoundsVersion;
+	if (rebuild) {
+		m_worldBounds.clear();
+		m_worldBounds.reserve(count);
+		m_worldBoundsVersion = m_bounds.getVersion();
+	}
+	for (size_t i = 0; i < count; i++)
+	{
+		Entity entity = entities[i];
+		bool hasTransform = m_transforms.has(entity);
+		if (rebuild) {
+			m_worldBounds.add(hasTransform ? transformBounds(bounds[i].local, getWorldMatrix(entity)) : bounds[i].local);
+		}
+		else if (hasTransform && m_hierarchy.wasUpdated(m_transforms.get(entity))) {
+			m_worldBounds.set(i, transformBounds(bounds[i].local, getWorldMatrix(entity)));
+		}
+	}
+}
+
+size_t jameslib::Scene::cull(const Frustum& frustum, std::vector<Entity>* visible, const char* timingName)
+{
+	ScopedSystemTimer timer(getTiming(timingName));
+	m_visibleScratch.resize(m_worldBounds.count);
+	size_t numVisible = cullSpheres(frustum, m_worldBounds, m_visibleScratch.data());
+	visible->resize(numVisible);
+	const Entity* entities = m_bounds.getEntities();
+	for (size_t i = 0; i < numVisible; i++)
+	{
+		(*visible)[i] = entities[m_visibleScratch[i]];
+	}
+	return numVisible;
+}
+
+size_t jameslib::Scene::getAll(std::vector<Entity>* entities)const
+{
+	entities->assign(m_bounds.getEntities(), m_bounds.getEntities() + m_bounds.size());
+	return entities->size();
+}
+
+jameslib::SystemTiming& jameslib::Scene::getTiming(const char* name)
+{
+	for (size_t i = 0; i < m_timings.size(); i++)
+	{
+		if (m_timings[i].name == name) {
+			return m_timings[i];
+		}
+	}
+	m_timings.emplace_back();
+	m_timings.back().name = name;
+	return m_timings.back();
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "../ew/model.h"
+#include "culling.h"
+#include "profiler.h"
+#include "transformHierarchy.h"
+#include <chrono>
+#include <deque>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace jameslib
+{
+	typedef uint32_t Entity;
+	const Entity INVALID_ENTITY = 0xFFFFFFFF;
+
+	//Sparse set: components live densely packed in insertion order (swap-removed), with a sparse
+	//entity -> dense index table for O(1) lookup. Iterate data()/getEntities() for cache friendly passes.
+	template<typename T>
+	class ComponentPool
+	{
+	public:
+		T& add(Entity entity, const T& component = T())
+		{
+			if (entity >= m_sparse.size()) {
+				m_sparse.resize(entity + 1, INVALID_ENTITY);
+			}
+			if (m_sparse[entity] != INVALID_ENTITY) {
+				return m_components[m_sparse[entity]] = component;
+			}
+			m_sparse[entity] = (uint32_t)m_dense.size();
+			m_dense.push_back(entity);
+			m_components.push_back(component);
+			m_version++;
+			return m_components.back();
+		}
+		void remove(Entity entity)
+		{
+			if (!has(entity)) {
+				return;
+			}
+			uint32_t index = m_sparse[entity];
+			Entity last = m_dense.back();
+			m_dense[index] = last;
+			m_components[index] = m_components.back();
+			m_sparse[last] = index;
+			m_sparse[entity] = INVALID_ENTITY;
+			m_dense.pop_back();
+			m_components.pop_back();
+			m_version++;
+		}
+		inline bool has(Entity entity)const { return entity < m_sparse.size() && m_sparse[entity] != INVALID_ENTITY; }
+		inline T& get(Entity entity) { return m_components[m_sparse[entity]]; }
+		inline const T& get(Entity entity)const { return m_components[m_sparse[entity]]; }
+		inline T* tryGet(Entity entity) { return has(entity) ? &m_components[m_sparse[entity]] : nullptr; }
+		inline uint32_t getIndex(Entity entity)const { return m_sparse[entity]; }
+		inline size_t size()const { return m_dense.size(); }
+		inline T* data() { return m_components.data(); }
+		inline const T* data()const { return m_components.data(); }
+		inline const Entity* getEntities()const { return m_dense.data(); }
+		//Changes whenever the dense order changes, so dependent caches know to rebuild
+		inline uint32_t getVersion()const { return m_version; }
+	private:
+		std::vector<uint32_t> m_sparse;
+		std::vector<Entity> m_dense;
+		std::vector<T> m_components;
+		uint32_t m_version = 0;
+	};
+
+	struct Material
+	{
+		unsigned int texture = 0;
+		float ka = 1.0f;
+		float kd = 0.5f;
+		float ks = 0.5f;
+		float shininess = 128.0f;
+	};
+
+	//Exactly one of model or mesh is set. Neither is owned by the scene.
+	struct RenderComponent
+	{
+		const ew::Model* model = nullptr;
+		const ew::Mesh* mesh = nullptr;
+		uint32_t material = 0; //Index into Scene::getMaterials
+		bool castsShadow = true;
+	};
+
+	//Object space bounds. World space copies are kept in Scene's culling SoA.
+	struct BoundsComponent
+	{
+		ew::Bounds local;
+	};
+
+	struct SystemTiming
+	{
+		std::string name;
+		double ms = 0.0;
+	};
+
+	//Entities with transform, render and bounds components. Transforms live in a TransformHierarchy,
+	//world bounds in a CullingBounds SoA that mirrors the bounds pool's dense order.
+	class Scene
+	{
+	public:
+		Entity createEntity();
+		//Entity ids and transform nodes are recycled, so don't hold on to destroyed ones.
+		//Destroy children before their parent.
+		void destroyEntity(Entity entity);
+		inline size_t getNumEntities()const { return m_numAlive; }
+
+		//Components
+		TransformNode addTransform(Entity entity, const ew::Transform& local = ew::Transform(), Entity parent = INVALID_ENTITY);
+		inline bool hasTransform(Entity entity)const { return m_transforms.has(entity); }
+		inline TransformNode getTransformNode(Entity entity)const { return m_transforms.get(entity); }
+		inline const glm::mat4& getWorldMatrix(Entity entity)const { return m_hierarchy.getWorldMatrix(m_transforms.get(entity)); }
+		inline TransformHierarchy& getHierarchy() { return m_hierarchy; }
+		inline ComponentPool<RenderComponent>& getRenderables() { return m_renderables; }
+		inline ComponentPool<BoundsComponent>& getBounds() { return m_bounds; }
+
+		uint32_t addMaterial(const Material& material);
+		inline std::vector<Material>& getMaterials() { return m_materials; }
+
+		//Systems, each timed under its own name
+		void updateTransforms();
+		void updateBounds();
+		//World bounding sphere (center, radius) as of the last updateBounds. Entity must have bounds.
+		inline glm::vec4 getWorldSphere(Entity entity)const
+		{
+			uint32_t i = m_bounds.getIndex(entity);
+			return glm::vec4(m_worldBounds.centerX[i], m_worldBounds.centerY[i], m_worldBounds.centerZ[i], m_worldBounds.radius[i]);
+		}
+		//Every entity with bounds, in dense order
+		size_t getAll(std::vector<Entity>* entities)const;
+		//Visible entities with bounds, in dense order
+		size_t cull(const Frustum& frustum, std::vector<Entity>* visible, const char* timingName = "Cull");
+
+		//Calls fn(entity, RenderComponent&, worldMatrix) for each entity in list that is renderable
+		template<typename Fn>
+		void forEachRenderable(const std::vector<Entity>& entities, size_t count, Fn fn)
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				Entity entity = entities[i];
+				RenderComponent* renderable = m_renderables.tryGet(entity);
+				if (renderable && m_transforms.has(entity)) {
+					fn(entity, *renderable, getWorldMatrix(entity));
+				}
+			}
+		}
+
+		SystemTiming& getTiming(const char* name);
+		inline const std::deque<SystemTiming>& getTimings()const { return m_timings; }
+	private:
+		TransformHierarchy m_hierarchy;
+		ComponentPool<TransformNode> m_transforms;
+		ComponentPool<RenderComponent> m_renderables;
+		ComponentPool<BoundsComponent> m_bounds;
+		std::vector<Material> m_materials;
+
+		std::vector<Entity> m_freeEntities;
+		std::vector<TransformNode> m_freeNodes; //Nodes of destroyed entities, reused by addTransform
+		Entity m_nextEntity = 0;
+		size_t m_numAlive = 0;
+
+		CullingBounds m_worldBounds;
+		uint32_t m_worldBoundsVersion = 0xFFFFFFFF;
+		std::vector<uint32_t> m_visibleScratch;
+
+		std::deque<SystemTiming> m_timings; //Deque so references stay valid as timings are added
+	};
+
+	//Records the scope's duration into a SystemTiming, e.g. { ScopedSystemTimer t(scene.getTiming("Submit")); ... }
+	//Also opens a CPU profiler zone with the timing's name.
+	class ScopedSystemTimer
+	{
+	public:
+		ScopedSystemTimer(SystemTiming& timing) : m_timing(timing), m_zone(timing.name.c_str()), m_start(std::chrono::steady_clock::now()) {}
+		~ScopedSystemTimer()
+		{
+			std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - m_start;
+			m_timing.ms = elapsed.count();
+		}
+	private:
+		SystemTiming& m_timing;
+		ScopedProfileZone m_zone;
+		std::chrono::steady_clock::time_point m_start;
+	};
+}
@@ -0,0 +1,200 @@
+#include "shaderBatch.h"
+#include "shaderCache.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+#include <string.h>
+
+//Our glad has no extension loader, so the KHR_parallel_shader_compile enum is defined here.
+//glMaxShaderCompilerThreadsKHR is never called: the default lets the driver pick the thread count.
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+namespace
+{
+	double getElapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+	{
+		std::chrono::duration<double, std::milli> elapsed = end - start;
+		return elapsed.count();
+	}
+}
+
+bool jameslib::isParallelShaderCompileSupported()
+{
+	static int supported = -1;
+	if (supported < 0) {
+		supported = 0;
+		int numExtensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
+		for (int i = 0; i < numExtensions; i++)
+		{
+			const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+			if (extension && (strcmp(extension, "GL_KHR_parallel_shader_compile") == 0 || strcmp(extension, "GL_ARB_parallel_shader_compile") == 0)) {
+				supported = 1;
+				break;
+			}
+		}
+	}
+	return supported == 1;
+}
+
+void jameslib::ShaderBatch::add(ew::Shader* target, const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines)
+{
+	const unsigned int stageTypes[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+	std::string sources[2] = {
+		ew::addShaderDefines(ew::loadShaderSourceFromFile(vertexShader), defines),
+		ew::addShaderDefines(ew::loadShaderSourceFromFile(fragmentShader), defines)
+	};
+	addSources(target, vertexShader + " + " + fragmentShader, stageTypes, sources, 2);
+}
+
+void jameslib::ShaderBatch::addCompute(ew::Shader* target, const std::string& computeShader, const std::vector<std::string>& defines)
+{
+	const unsigned int stageTypes[1] = { GL_COMPUTE_SHADER };
+	std::string source = ew::addShaderDefines(ew::loadShaderSourceFromFile(computeShader), defines);
+	addSources(target, computeShader, stageTypes, &source, 1);
+}
+
+void jameslib::ShaderBatch::addSources(ew::Shader* target, const std::string& name, const unsigned int* stageTypes, const std::string* sources, int numStages)
+{
+	PendingProgram pending;
+	pending.target = target;
+	pending.name = name;
+	pending.numStages = numStages;
+	for (int s = 0; s < numStages; s++)
+	{
+		pending.stageTypes[s] = stageTypes[s];
+		pending.sources[s] = sources[s];
+	}
+	m_programs.push_back(pending);
+}
+
+void jameslib::ShaderBatch::submit()
+{
+	if (m_submitted) {
+		return;
+	}
+	m_submitted = true;
+	m_parallel = isParallelShaderCompileSupported();
+	m_submitTime = std::chrono::steady_clock::now();
+	m_doneTime = m_submitTime;
+
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		PendingProgram& pending = m_programs[i];
+		const char* sources[2] = { pending.sources[0].c_str(), pending.sources[1].c_str() };
+		pending.program = loadCachedProgram(pending.stageTypes, sources, pending.numStages, &pending.key);
+		if (pending.program) {
+			pending.cached = true;
+			complete(&pending);
+			continue;
+		}
+		//No status queries here: any of them would wait for the compile to finish
+		pending.program = glCreateProgram();
+		for (int s = 0; s < pending.numStages; s++)
+		{
+			pending.shaders[s] = glCreateShader(pending.stageTypes[s]);
+			glShaderSource(pending.shaders[s], 1, &sources[s], NULL);
+			glCompileShader(pending.shaders[s]);
+			glAttachShader(pending.program, pending.shaders[s]);
+		}
+		glProgramParameteri(pending.program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		glLinkProgram(pending.program);
+	}
+	//GL copied the sources
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		m_programs[i].sources[0].clear();
+		m_programs[i].sources[1].clear();
+	}
+}
+
+bool jameslib::ShaderBatch::poll()
+{
+	if (!m_submitted) {
+		submit();
+	}
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		PendingProgram& pending = m_programs[i];
+		if (pending.finished) {
+			continue;
+		}
+		if (m_parallel) {
+			int completed = 0;
+			glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &completed);
+			if (completed) {
+				complete(&pending);
+			}
+		}
+		else {
+			complete(&pending);
+			break;
+		}
+	}
+	return isDone();
+}
+
+void jameslib::ShaderBatch::finish()
+{
+	if (!m_submitted) {
+		submit();
+	}
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		if (!m_programs[i].finished) {
+			complete(&m_programs[i]);
+		}
+	}
+}
+
+double jameslib::ShaderBatch::getElapsedMs()const
+{
+	if (!m_submitted) {
+		return 0.0;
+	}
+	return ::getElapsedMs(m_submitTime, isDone() ? m_doneTime : std::chrono::steady_clock::now());
+}
+
+void jameslib::ShaderBatch::complete(PendingProgram* pending)
+{
+	pending->finished = true;
+	int success = 0;
+	glGetProgramiv(pending->program, GL_LINK_STATUS, &success);
+	if (!success && !pending->cached) {
+		//512 matches ew::Shader's error messages
+		char infoLog[512];
+		for (int s = 0; s < pending->numStages; s++)
+		{
+			int compiled = 0;
+			glGetShaderiv(pending->shaders[s], GL_COMPILE_STATUS, &compiled);
+			if (!compiled) {
+				glGetShaderInfoLog(pending->shaders[s], 512, NULL, infoLog);
+				printf("Failed to compile shader %s: %s", pending->name.c_str(), infoLog);
+			}
+		}
+		glGetProgramInfoLog(pending->program, 512, NULL, infoLog);
+		printf("Failed to link shader program %s: %s", pending->name.c_str(), infoLog);
+	}
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	if (!pending->cached) {
+		for (int s = 0; s < pending->numStages; s++)
+		{
+			glDeleteShader(pending->shaders[s]);
+		}
+		storeCachedProgram(pending->key, pending->program, ::getElapsedMs(m_submitTime, now));
+	}
+
+	if (success) {
+		pending->target->setProgram(pending->program);
+		m_numReady++;
+	}
+	else {
+		//The target keeps its fallback
+		glDeleteProgram(pending->program);
+		m_numFailed++;
+	}
+	if (isDone()) {
+		m_doneTime = now;
+	}
+}
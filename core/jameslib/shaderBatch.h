@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../ew/shader.h"
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace jameslib
+{
+	//True when the driver exposes KHR_parallel_shader_compile (or the ARB version), so compile and link
+	//status can be polled with GL_COMPLETION_STATUS_KHR without waiting. Needs a current GL context.
+	bool isParallelShaderCompileSupported();
+
+	//Builds a set of programs together instead of one blocking compile at a time. submit() issues every compile
+	//and link up front so a driver with compiler threads can work on all of them at once, then poll() picks up
+	//finished programs without blocking and writes them over their targets. Targets should hold a working
+	//fallback program until then. Without the extension poll() finishes one program per call, which spreads
+	//the stall over several frames instead of removing it. Programs found in the shader cache are ready at submit.
+	class ShaderBatch
+	{
+	public:
+		void add(ew::Shader* target, const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines = {});
+		void addCompute(ew::Shader* target, const std::string& computeShader, const std::vector<std::string>& defines = {});
+		//Sources already loaded, e.g. by ShaderWatcher. At most two stages. name is used in error messages.
+		void addSources(ew::Shader* target, const std::string& name, const unsigned int* stageTypes, const std::string* sources, int numStages);
+
+		void submit();
+		//Returns true once every program has finished, whether it linked or not
+		bool poll();
+		//Blocks until every program has finished
+		void finish();
+
+		inline bool isDone()const { return m_numReady + m_numFailed == (int)m_programs.size(); }
+		inline bool isParallel()const { return m_parallel; }
+		inline int getNumPrograms()const { return (int)m_programs.size(); }
+		inline int getNumReady()const { return m_numReady; }
+		inline int getNumFailed()const { return m_numFailed; }
+		//Submit to the last program finishing, or to now while still building
+		double getElapsedMs()const;
+	private:
+		struct PendingProgram
+		{
+			ew::Shader* target;
+			std::string name; //Shader paths for error messages
+			unsigned int stageTypes[2];
+			std::string sources[2];
+			unsigned int shaders[2];
+			int numStages;
+			unsigned int program = 0;
+			uint64_t key = 0;
+			bool cached = false; //Loaded from the shader cache, no shader objects
+			bool finished = false;
+		};
+		void complete(PendingProgram* pending);
+
+		std::vector<PendingProgram> m_programs;
+		bool m_submitted = false;
+		bool m_parallel = false;
+		int m_numReady = 0;
+		int m_numFailed = 0;
+		std::chrono::steady_clock::time_point m_submitTime;
+		std::chrono::steady_clock::time_point m_doneTime;
+	};
+}
@@ -0,0 +1,209 @@
+#include "shaderCache.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <direct.h>
+#endif
+
+namespace
+{
+	std::string cacheDirectory = "shadercache";
+	jameslib::ShaderCacheStats stats;
+
+	//FNV-1a
+	uint64_t hashBytes(uint64_t hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = (const unsigned char*)data;
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ull;
+		}
+		return hash;
+	}
+
+	uint64_t hashString(uint64_t hash, const char* s)
+	{
+		//Include the terminator so "ab"+"c" and "a"+"bc" differ
+		return s ? hashBytes(hash, s, strlen(s) + 1) : hashBytes(hash, "", 1);
+	}
+
+	std::string getCachePath(uint64_t key)
+	{
+		char name[32];
+		snprintf(name, sizeof(name), "%016llx.ewprog", (unsigned long long)key);
+		return cacheDirectory + "/" + name;
+	}
+
+	double getElapsedMs(std::chrono::steady_clock::time_point start)
+	{
+		std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+		return elapsed.count();
+	}
+
+	bool isCacheUsable()
+	{
+		int numBinaryFormats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+		return !cacheDirectory.empty() && numBinaryFormats > 0;
+	}
+
+	//Returns a linked program, or 0 on a miss. Sets rejected when a binary was found but the driver refused it.
+	unsigned int loadProgramBinary(uint64_t key, bool* rejected)
+	{
+		FILE* file = fopen(getCachePath(key).c_str(), "rb");
+		if (!file) {
+			return 0;
+		}
+		jameslib::ShaderCacheHeader header;
+		std::vector<char> binary;
+		bool valid = fread(&header, sizeof(header), 1, file) == 1
+			&& memcmp(header.magic, jameslib::SHADER_CACHE_MAGIC, 4) == 0
+			&& header.version == jameslib::SHADER_CACHE_VERSION
+			&& header.key == key;
+		if (valid) {
+			binary.resize(header.binarySize);
+			valid = header.binarySize > 0 && fread(binary.data(), 1, binary.size(), file) == binary.size();
+		}
+		fclose(file);
+		if (!valid) {
+			*rejected = true;
+			return 0;
+		}
+
+		unsigned int program = glCreateProgram();
+		glProgramBinary(program, header.binaryFormat, binary.data(), (GLsizei)binary.size());
+		int success = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &success);
+		if (!success) {
+			//Binary formats are allowed to go stale, e.g. after a driver update with the same version string
+			glDeleteProgram(program);
+			*rejected = true;
+			return 0;
+		}
+		return program;
+	}
+
+	void saveProgramBinary(uint64_t key, unsigned int program)
+	{
+		int binarySize = 0;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+		if (binarySize <= 0) {
+			return;
+		}
+		std::vector<char> binary(binarySize);
+		GLenum binaryFormat = 0;
+		glGetProgramBinary(program, binarySize, &binarySize, &binaryFormat, binary.data());
+
+#ifdef _WIN32
+		_mkdir(cacheDirectory.c_str());
+#else
+		mkdir(cacheDirectory.c_str(), 0755);
+#endif
+		//Written under a temporary name so a crash never leaves a truncated binary under the real one
+		std::string path = getCachePath(key);
+		std::string tempPath = path + ".tmp";
+		FILE* file = fopen(tempPath.c_str(), "wb");
+		if (!file) {
+			printf("Failed to write shader cache %s\n", path.c_str());
+			return;
+		}
+		jameslib::ShaderCacheHeader header;
+		memcpy(header.magic, jameslib::SHADER_CACHE_MAGIC, 4);
+		header.version = jameslib::SHADER_CACHE_VERSION;
+		header.key = key;
+		header.binaryFormat = binaryFormat;
+		header.binarySize = (uint32_t)binarySize;
+		fwrite(&header, sizeof(header), 1, file);
+		fwrite(binary.data(), 1, binarySize, file);
+		bool succeeded = ferror(file) == 0;
+		fclose(file);
+		remove(path.c_str());
+		if (!succeeded || rename(tempPath.c_str(), path.c_str()) != 0) {
+			remove(tempPath.c_str());
+		}
+	}
+}
+
+void jameslib::setShaderCacheDirectory(const std::string& directory)
+{
+	cacheDirectory = directory;
+}
+
+const std::string& jameslib::getShaderCacheDirectory()
+{
+	return cacheDirectory;
+}
+
+uint64_t jameslib::getShaderCacheKey(const unsigned int* stageTypes, const char* const* sources, int numStages)
+{
+	uint64_t hash = 14695981039346656037ull;
+	hash = hashBytes(hash, &SHADER_CACHE_VERSION, sizeof(SHADER_CACHE_VERSION));
+	hash = hashString(hash, (const char*)glGetString(GL_VENDOR));
+	hash = hashString(hash, (const char*)glGetString(GL_RENDERER));
+	hash = hashString(hash, (const char*)glGetString(GL_VERSION));
+	for (int i = 0; i < numStages; i++)
+	{
+		hash = hashBytes(hash, &stageTypes[i], sizeof(stageTypes[i]));
+		hash = hashString(hash, sources[i]);
+	}
+	return hash;
+}
+
+unsigned int jameslib::createCachedProgram(const unsigned int* stageTypes, const char* const* sources, int numStages, LinkProgramFn linkProgram)
+{
+	uint64_t key = 0;
+	unsigned int program = loadCachedProgram(stageTypes, sources, numStages, &key);
+	if (program) {
+		return program;
+	}
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	program = linkProgram(stageTypes, sources, numStages);
+	storeCachedProgram(key, program, getElapsedMs(start));
+	return program;
+}
+
+unsigned int jameslib::loadCachedProgram(const unsigned int* stageTypes, const char* const* sources, int numStages, uint64_t* key)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	*key = 0;
+	if (!isCacheUsable()) {
+		stats.misses++;
+		return 0;
+	}
+	*key = getShaderCacheKey(stageTypes, sources, numStages);
+	bool rejected = false;
+	unsigned int program = loadProgramBinary(*key, &rejected);
+	if (program) {
+		stats.hits++;
+		stats.loadMs += getElapsedMs(start);
+		return program;
+	}
+	stats.misses++;
+	stats.rejected += rejected ? 1 : 0;
+	//Time spent on a failed lookup belongs to the compile that follows
+	stats.compileMs += getElapsedMs(start);
+	return 0;
+}
+
+void jameslib::storeCachedProgram(uint64_t key, unsigned int program, double compileMs)
+{
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	int success = 0;
+	glGetProgramiv(program, GL_LINK_STATUS, &success);
+	if (success && isCacheUsable()) {
+		saveProgramBinary(key, program);
+	}
+	stats.compileMs += compileMs + getElapsedMs(start);
+}
+
+const jameslib::ShaderCacheStats& jameslib::getShaderCacheStats()
+{
+	return stats;
+}
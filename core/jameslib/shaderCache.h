@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdint.h>
+#include <string>
+
+namespace jameslib
+{
+	//Linked program binaries (.ewprog), one file per program named after its key. Layout on disk:
+	//  ShaderCacheHeader | binary[binarySize]
+	//The key hashes every stage's final source (defines included) with the driver's vendor, renderer and
+	//version strings, so an edited shader or a driver update misses instead of loading a stale binary.
+	const char SHADER_CACHE_MAGIC[4] = { 'E', 'W', 'S', 'C' };
+	const uint32_t SHADER_CACHE_VERSION = 1;
+
+	struct ShaderCacheHeader
+	{
+		char magic[4];
+		uint32_t version;
+		uint64_t key;
+		uint32_t binaryFormat;
+		uint32_t binarySize;
+	};
+
+	//Totals since startup. A warm start has no misses.
+	struct ShaderCacheStats
+	{
+		unsigned int hits = 0;
+		unsigned int misses = 0;
+		unsigned int rejected = 0; //Found on disk but refused by the driver, then compiled. Also counted as misses.
+		double loadMs = 0.0; //Creating programs from binaries
+		double compileMs = 0.0; //Compiling, linking and saving on misses. Summed per program, so programs built in parallel overlap.
+	};
+
+	//Relative to the working directory and created on first save. Empty disables the cache. Defaults to "shadercache".
+	void setShaderCacheDirectory(const std::string& directory);
+	const std::string& getShaderCacheDirectory();
+
+	typedef unsigned int (*LinkProgramFn)(const unsigned int* stageTypes, const char* const* sources, int numStages);
+
+	//Loads the program from the cache when the sources and driver match, otherwise links it with linkProgram and
+	//saves the binary. linkProgram must set GL_PROGRAM_BINARY_RETRIEVABLE_HINT before linking. stageTypes are
+	//GL_VERTEX_SHADER etc. Needs a current GL context.
+	unsigned int createCachedProgram(const unsigned int* stageTypes, const char* const* sources, int numStages, LinkProgramFn linkProgram);
+	uint64_t getShaderCacheKey(const unsigned int* stageTypes, const char* const* sources, int numStages);
+
+	//The two halves of createCachedProgram for callers that link asynchronously, like ShaderBatch.
+	//Returns a linked program and counts a hit, or returns 0 and counts a miss. Sets key for storeCachedProgram.
+	unsigned int loadCachedProgram(const unsigned int* stageTypes, const char* const* sources, int numStages, uint64_t* key);
+	//Saves a program that linked successfully and adds compileMs to the stats
+	void storeCachedProgram(uint64_t key, unsigned int program, double compileMs);
+	const ShaderCacheStats& getShaderCacheStats();
+}
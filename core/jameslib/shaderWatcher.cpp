@@ -0,0 +1,266 @@
+#include "shaderWatcher.h"
+#include "../ew/external/glad.h"
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	struct WatchedFile
+	{
+		std::string path;
+		long long modifiedTime;
+	};
+
+	//Seconds since the epoch, or 0 while the file is missing, e.g. mid-save
+	long long getModifiedTime(const std::string& path)
+	{
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0) {
+			return 0;
+		}
+		return (long long)info.st_mtime;
+	}
+
+	//Including the trailing slash, so directory + name gives back the path
+	std::string getDirectory(const std::string& path)
+	{
+		size_t slash = path.find_last_of("/\\");
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
+
+	std::string getProgramName(const std::string* paths, int numStages)
+	{
+		return numStages == 2 ? paths[0] + " + " + paths[1] : paths[0];
+	}
+}
+
+jameslib::ShaderWatcher::~ShaderWatcher()
+{
+	stop();
+}
+
+void jameslib::ShaderWatcher::watch(ew::Shader* shader, const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines)
+{
+	WatchedProgram program;
+	program.shader = shader;
+	program.paths[0] = vertexShader;
+	program.paths[1] = fragmentShader;
+	program.numStages = 2;
+	program.defines = defines;
+	m_programs.push_back(program);
+	loadSources((int)m_programs.size() - 1);
+}
+
+void jameslib::ShaderWatcher::watchCompute(ew::Shader* shader, const std::string& computeShader, const std::vector<std::string>& defines)
+{
+	WatchedProgram program;
+	program.shader = shader;
+	program.paths[0] = computeShader;
+	program.numStages = 1;
+	program.defines = defines;
+	m_programs.push_back(program);
+	loadSources((int)m_programs.size() - 1);
+}
+
+void jameslib::ShaderWatcher::start()
+{
+	if (isRunning()) {
+		return;
+	}
+	m_stopping = false;
+	m_thread = std::thread(&ShaderWatcher::watcherLoop, this);
+}
+
+void jameslib::ShaderWatcher::stop()
+{
+	if (!isRunning()) {
+		return;
+	}
+	m_stopping = true;
+	m_thread.join();
+}
+
+int jameslib::ShaderWatcher::update()
+{
+	int numSwapped = 0;
+	if (!m_batchPrograms.empty()) {
+		if (!m_batch.poll()) {
+			return 0;
+		}
+		for (size_t i = 0; i < m_batchPrograms.size(); i++)
+		{
+			WatchedProgram& program = m_programs[m_batchPrograms[i]];
+			std::string name = getProgramName(program.paths, program.numStages);
+			unsigned int current = program.shader->getProgram();
+			if (current == m_replacedPrograms[i]) {
+				printf("Keeping the last good program for %s\n", name.c_str());
+				m_numErrors++;
+				continue;
+			}
+			//Programs from before the first reload may be shared by other shaders, so only ours are deleted
+			if (program.ownedProgram) {
+				glDeleteProgram(program.ownedProgram);
+			}
+			program.ownedProgram = current;
+			printf("Reloaded %s\n", name.c_str());
+			m_numReloads++;
+			numSwapped++;
+		}
+		m_batchPrograms.clear();
+		m_replacedPrograms.clear();
+	}
+
+	std::vector<Reload> reloads;
+	{
+		std::lock_guard<std::mutex> lock(m_reloadMutex);
+		reloads.swap(m_reloads);
+	}
+	if (reloads.empty()) {
+		return numSwapped;
+	}
+	m_batch = ShaderBatch();
+	for (size_t i = 0; i < reloads.size(); i++)
+	{
+		WatchedProgram& program = m_programs[reloads[i].program];
+		const unsigned int graphicsStages[2] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER };
+		const unsigned int computeStage[1] = { GL_COMPUTE_SHADER };
+		m_batchPrograms.push_back(reloads[i].program);
+		m_replacedPrograms.push_back(program.shader->getProgram());
+		m_batch.addSources(program.shader, getProgramName(program.paths, program.numStages),
+			program.numStages == 2 ? graphicsStages : computeStage, reloads[i].sources, program.numStages);
+	}
+	//Cache hits, e.g. an undone edit, swap in here. The rest are picked up by later updates.
+	m_batch.submit();
+	return numSwapped;
+}
+
+jameslib::ShaderWatcher::Reload jameslib::ShaderWatcher::loadSources(int program)
+{
+	WatchedProgram& watched = m_programs[program];
+	Reload reload;
+	reload.program = program;
+	watched.dependencies.clear();
+	for (int s = 0; s < watched.numStages; s++)
+	{
+		std::vector<std::string> dependencies;
+		reload.sources[s] = ew::addShaderDefines(ew::loadShaderSourceFromFile(watched.paths[s], &dependencies), watched.defines);
+		watched.dependencies.insert(watched.dependencies.end(), dependencies.begin(), dependencies.end());
+	}
+	return reload;
+}
+
+void jameslib::ShaderWatcher::watcherLoop()
+{
+	std::vector<WatchedFile> files;
+	std::vector<std::string> directories;
+	int inotifyFd = -1;
+#ifdef __linux__
+	std::vector<int> watchDescriptors; //Parallel to directories
+	inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+	//New #includes can bring in files and directories that weren't watched before
+	auto addDependencies = [&](const std::vector<std::string>& dependencies) {
+		for (size_t i = 0; i < dependencies.size(); i++)
+		{
+			const std::string& path = dependencies[i];
+			auto sameFile = [&](const WatchedFile& file) { return file.path == path; };
+			if (std::find_if(files.begin(), files.end(), sameFile) == files.end()) {
+				files.push_back({ path, getModifiedTime(path) });
+			}
+			std::string directory = getDirectory(path);
+			if (std::find(directories.begin(), directories.end(), directory) != directories.end()) {
+				continue;
+			}
+			directories.push_back(directory);
+#ifdef __linux__
+			//Editors that save by renaming a temporary file only show up as IN_MOVED_TO
+			int wd = inotifyFd >= 0 ? inotify_add_watch(inotifyFd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) : -1;
+			watchDescriptors.push_back(wd);
+#endif
+		}
+	};
+	for (size_t i = 0; i < m_programs.size(); i++)
+	{
+		addDependencies(m_programs[i].dependencies);
+	}
+
+	while (!m_stopping) {
+		std::vector<std::string> changed;
+#ifdef __linux__
+		if (inotifyFd >= 0) {
+			//Short timeout so stop() never waits long
+			pollfd pollInfo = { inotifyFd, POLLIN, 0 };
+			if (poll(&pollInfo, 1, 100) <= 0) {
+				continue;
+			}
+			//Saves often come in several writes, let them finish before reading
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+			alignas(inotify_event) char buffer[4096];
+			ssize_t length;
+			while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+				for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + ((inotify_event*)p)->len)
+				{
+					const inotify_event* event = (const inotify_event*)p;
+					size_t index = std::find(watchDescriptors.begin(), watchDescriptors.end(), event->wd) - watchDescriptors.begin();
+					if (event->len > 0 && index < directories.size()) {
+						changed.push_back(directories[index] + event->name);
+					}
+				}
+			}
+		}
+		else
+#endif
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+			for (size_t i = 0; i < files.size(); i++)
+			{
+				long long modifiedTime = getModifiedTime(files[i].path);
+				if (modifiedTime != files[i].modifiedTime) {
+					files[i].modifiedTime = modifiedTime;
+					changed.push_back(files[i].path);
+				}
+			}
+		}
+		if (changed.empty()) {
+			continue;
+		}
+
+		for (size_t i = 0; i < m_programs.size(); i++)
+		{
+			const std::vector<std::string>& dependencies = m_programs[i].dependencies;
+			bool affected = false;
+			for (size_t c = 0; c < changed.size() && !affected; c++)
+			{
+				affected = std::find(dependencies.begin(), dependencies.end(), changed[c]) != dependencies.end();
+			}
+			if (!affected) {
+				continue;
+			}
+			Reload reload = loadSources((int)i);
+			addDependencies(m_programs[i].dependencies);
+			std::lock_guard<std::mutex> lock(m_reloadMutex);
+			auto sameProgram = [&](const Reload& pending) { return pending.program == reload.program; };
+			auto pending = std::find_if(m_reloads.begin(), m_reloads.end(), sameProgram);
+			if (pending != m_reloads.end()) {
+				*pending = reload;
+			}
+			else {
+				m_reloads.push_back(reload);
+			}
+		}
+	}
+#ifdef __linux__
+	if (inotifyFd >= 0) {
+		close(inotifyFd);
+	}
+#endif
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "shaderBatch.h"
+#include "../ew/shader.h"
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace jameslib
+{
+	//Hot reloads shader programs when any file they were built from changes, #includes included. A background
+	//thread waits on inotify (other platforms check modification times every 250 ms), finds the programs that
+	//use the changed file and reads their new sources. update() builds only those programs in a ShaderBatch and
+	//swaps each into its ew::Shader between frames once it has linked. A program that fails to compile or link
+	//prints its log and the shader keeps its last good program.
+	class ShaderWatcher
+	{
+	public:
+		ShaderWatcher() = default;
+		~ShaderWatcher();
+		ShaderWatcher(const ShaderWatcher&) = delete;
+		ShaderWatcher& operator=(const ShaderWatcher&) = delete;
+
+		//Register everything before start(). shader must outlive the watcher.
+		void watch(ew::Shader* shader, const std::string& vertexShader, const std::string& fragmentShader, const std::vector<std::string>& defines = {});
+		void watchCompute(ew::Shader* shader, const std::string& computeShader, const std::vector<std::string>& defines = {});
+		void start();
+		void stop();
+		inline bool isRunning()const { return m_thread.joinable(); }
+
+		//Call once per frame on the render thread. Returns how many programs were swapped in,
+		//so uniform handles resolved from those shaders can be resolved again.
+		int update();
+
+		inline int getNumReloads()const { return m_numReloads; }
+		inline int getNumErrors()const { return m_numErrors; }
+	private:
+		struct WatchedProgram
+		{
+			ew::Shader* shader;
+			std::string paths[2];
+			int numStages;
+			std::vector<std::string> defines;
+			std::vector<std::string> dependencies; //Watcher thread only once started
+			unsigned int ownedProgram = 0; //Last program a reload swapped in, deleted when replaced. Render thread only.
+		};
+		struct Reload
+		{
+			int program;
+			std::string sources[2];
+		};
+
+		void watcherLoop();
+		//Rereads the program's sources and dependencies on the watcher thread
+		Reload loadSources(int program);
+
+		std::vector<WatchedProgram> m_programs;
+		std::thread m_thread;
+		std::atomic<bool> m_stopping{ false };
+
+		std::mutex m_reloadMutex;
+		std::vector<Reload> m_reloads; //At most one per program, newest sources win
+
+		//Render thread only
+		ShaderBatch m_batch;
+		std::vector<int> m_batchPrograms; //Watched program of each batch entry
+		std::vector<unsigned int> m_replacedPrograms; //Each shader's program when the batch was submitted
+		int m_numReloads = 0;
+		int m_numErrors = 0;
+	};
+}
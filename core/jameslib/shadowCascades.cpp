@@ -0,0 +1,68 @@
+#include "shadowCascades.h"
+#include <math.h>
+
+void jameslib::computeCascadeSplits(float nearPlane, float farPlane, int numCascades, float lambda, float* splitDistances)
+{
+	for (int i = 1; i <= numCascades; i++)
+	{
+		float p = (float)i / numCascades;
+		float logSplit = nearPlane * powf(farPlane / nearPlane, p);
+		float uniformSplit = nearPlane + (farPlane - nearPlane) * p;
+		splitDistances[i - 1] = glm::mix(uniformSplit, logSplit, lambda);
+	}
+}
+
+jameslib::ShadowCascades jameslib::fitShadowCascades(const ew::Camera& camera, const glm::vec3& lightDirection, int numCascades, float lambda,
+	float shadowDistance, unsigned int resolution, float casterDistance)
+{
+	ShadowCascades cascades;
+	cascades.numCascades = glm::clamp(numCascades, 1, MAX_SHADOW_CASCADES);
+	float farPlane = glm::min(camera.farPlane, shadowDistance);
+	computeCascadeSplits(camera.nearPlane, farPlane, cascades.numCascades, lambda, cascades.splitDistances);
+
+	glm::mat4 inverseView = glm::inverse(camera.viewMatrix());
+	float tanHalfFov = tanf(glm::radians(camera.fov) * 0.5f);
+	glm::vec3 direction = glm::normalize(lightDirection);
+	glm::vec3 up = glm::abs(direction.y) > 0.99f ? glm::vec3(0, 0, 1) : glm::vec3(0, 1, 0);
+	for (int c = 0; c < cascades.numCascades; c++)
+	{
+		float splitNear = c == 0 ? camera.nearPlane : cascades.splitDistances[c - 1];
+		float splitFar = cascades.splitDistances[c];
+
+		//Slice corners in view space (looking down -Z), then world space
+		glm::vec3 corners[8];
+		float distances[2] = { splitNear, splitFar };
+		glm::vec3 center = glm::vec3(0.0f);
+		for (int i = 0; i < 8; i++)
+		{
+			float distance = distances[i / 4];
+			float halfHeight = camera.orthographic ? camera.orthoHeight * 0.5f : distance * tanHalfFov;
+			float halfWidth = halfHeight * camera.aspectRatio;
+			glm::vec3 viewCorner = glm::vec3((i & 1) ? halfWidth : -halfWidth, (i & 2) ? halfHeight : -halfHeight, -distance);
+			corners[i] = glm::vec3(inverseView * glm::vec4(viewCorner, 1.0f));
+			center += corners[i];
+		}
+		center /= 8.0f;
+		float radius = 0.0f;
+		for (int i = 0; i < 8; i++)
+		{
+			radius = glm::max(radius, glm::length(corners[i] - center));
+		}
+		//Quantized so the projection size only changes in steps
+		radius = ceilf(radius * 16.0f) / 16.0f;
+
+		glm::mat4 lightView = glm::lookAt(center - direction * (radius + casterDistance), center, up);
+		glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, 0.0f, radius * 2.0f + casterDistance);
+
+		//Move the projection so the world origin lands on a texel corner. Every cascade position is then a whole number of texels away.
+		glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+		float texelsPerUnit = resolution * 0.5f;
+		glm::vec2 originTexels = glm::vec2(origin.x, origin.y) * texelsPerUnit;
+		glm::vec2 offset = (glm::round(originTexels) - originTexels) / texelsPerUnit;
+		lightProjection[3][0] += offset.x;
+		lightProjection[3][1] += offset.y;
+
+		cascades.viewProjections[c] = lightProjection * lightView;
+	}
+	return cascades;
+}
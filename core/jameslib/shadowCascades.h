@@ -0,0 +1,26 @@
+#pragma once
+
+#include "../ew/camera.h"
+#include <glm/glm.hpp>
+
+namespace jameslib
+{
+	const int MAX_SHADOW_CASCADES = 4;
+
+	struct ShadowCascades
+	{
+		int numCascades = 0;
+		glm::mat4 viewProjections[MAX_SHADOW_CASCADES];
+		float splitDistances[MAX_SHADOW_CASCADES] = {}; //View space far distance of each cascade
+	};
+
+	//Blend of uniform and logarithmic splits, lambda 0 is fully uniform and 1 fully logarithmic.
+	//Writes the far distance of each of the numCascades splits.
+	void computeCascadeSplits(float nearPlane, float farPlane, int numCascades, float lambda, float* splitDistances);
+
+	//Fits an orthographic light projection around each split of the camera frustum, out to shadowDistance.
+	//Fits are bounding spheres snapped to whole shadow map texels, so shadows don't shimmer as the camera
+	//moves or turns. casterDistance pulls every cascade's near plane toward the light to catch casters outside the view.
+	ShadowCascades fitShadowCascades(const ew::Camera& camera, const glm::vec3& lightDirection, int numCascades, float lambda,
+		float shadowDistance, unsigned int resolution, float casterDistance = 20.0f);
+}
@@ -0,0 +1,160 @@
+#include "tiledLighting.h"
+#include "../ew/external/glad.h"
+#include <math.h>
+
+namespace
+{
+	ew::Bounds getLightBounds(const jameslib::Light& light)
+	{
+		glm::vec3 center = glm::vec3(light.positionRadius);
+		float radius = light.positionRadius.w;
+		ew::Bounds bounds;
+		bounds.min = center - glm::vec3(radius);
+		bounds.max = center + glm::vec3(radius);
+		bounds.center = center;
+		bounds.radius = radius;
+		return bounds;
+	}
+}
+
+jameslib::Light jameslib::makePointLight(const glm::vec3& position, float radius, const glm::vec3& color)
+{
+	Light light;
+	light.positionRadius = glm::vec4(position, radius);
+	light.color = glm::vec4(color, -1.0f);
+	light.direction = glm::vec4(0.0f, -1.0f, 0.0f, -2.0f);
+	return light;
+}
+
+jameslib::Light jameslib::makeSpotLight(const glm::vec3& position, const glm::vec3& direction, float radius, const glm::vec3& color, float innerAngle, float outerAngle)
+{
+	Light light;
+	light.positionRadius = glm::vec4(position, radius);
+	light.color = glm::vec4(color, cosf(glm::radians(innerAngle)));
+	light.direction = glm::vec4(glm::normalize(direction), cosf(glm::radians(outerAngle)));
+	return light;
+}
+
+bool jameslib::isComputeBinningSupported()
+{
+	return GLAD_GL_VERSION_4_3 != 0;
+}
+
+jameslib::TiledLighting::TiledLighting(unsigned int width, unsigned int height)
+{
+	glCreateBuffers(1, &m_lightBuffer);
+	glCreateBuffers(1, &m_tileLightBuffer);
+	glCreateBuffers(1, &m_tileRangeBuffer);
+	m_lightCapacity = 64;
+	glNamedBufferData(m_lightBuffer, sizeof(Light) * m_lightCapacity, NULL, GL_STREAM_DRAW);
+	resize(width, height);
+}
+
+jameslib::TiledLighting::~TiledLighting()
+{
+	glDeleteBuffers(1, &m_lightBuffer);
+	glDeleteBuffers(1, &m_tileLightBuffer);
+	glDeleteBuffers(1, &m_tileRangeBuffer);
+}
+
+void jameslib::TiledLighting::resize(unsigned int width, unsigned int height)
+{
+	if (width == m_width && height == m_height) {
+		return;
+	}
+	m_width = width;
+	m_height = height;
+	m_numTilesX = (width + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	m_numTilesY = (height + LIGHT_TILE_SIZE - 1) / LIGHT_TILE_SIZE;
+	size_t numTiles = (size_t)m_numTilesX * m_numTilesY;
+	//Compute binning gives every tile a fixed slot of MAX_LIGHTS_PER_TILE indices
+	glNamedBufferData(m_tileLightBuffer, sizeof(uint32_t) * numTiles * MAX_LIGHTS_PER_TILE, NULL, GL_DYNAMIC_DRAW);
+	glNamedBufferData(m_tileRangeBuffer, sizeof(glm::uvec2) * numTiles, NULL, GL_DYNAMIC_DRAW);
+	m_tileRanges.assign(numTiles, glm::uvec2(0));
+	glNamedBufferSubData(m_tileRangeBuffer, 0, sizeof(glm::uvec2) * numTiles, m_tileRanges.data());
+}
+
+void jameslib::TiledLighting::uploadLights(const Light* lights, size_t count)
+{
+	m_lights.assign(lights, lights + count);
+	m_lightBounds.clear();
+	m_lightBounds.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		m_lightBounds.add(getLightBounds(lights[i]));
+	}
+	if (count == 0) {
+		return;
+	}
+	//Grow by doubling, otherwise orphan at the same size
+	if (count > m_lightCapacity) {
+		while (m_lightCapacity < count) {
+			m_lightCapacity *= 2;
+		}
+	}
+	glNamedBufferData(m_lightBuffer, sizeof(Light) * m_lightCapacity, NULL, GL_STREAM_DRAW);
+	glNamedBufferSubData(m_lightBuffer, 0, sizeof(Light) * count, lights);
+}
+
+void jameslib::TiledLighting::binCompute(const ew::Shader& binShader, unsigned int depthTexture)
+{
+	binShader.use();
+	binShader.setInt("_Depth", 0);
+	binShader.setInt("_NumLights", (int)m_lights.size());
+	binShader.setVec2("_ScreenSize", (float)m_width, (float)m_height);
+	glBindTextureUnit(0, depthTexture);
+	bind();
+	glDispatchCompute(m_numTilesX, m_numTilesY, 1);
+}
+
+void jameslib::TiledLighting::binCpu(const glm::mat4& viewProjection)
+{
+	size_t numLights = m_lights.size();
+	m_rowLights.resize(numLights);
+	m_tileVisible.resize(numLights);
+	m_rowBounds.reserve(numLights);
+	m_tileLights.clear();
+	glm::vec2 tileNdcSize = glm::vec2(2.0f * LIGHT_TILE_SIZE / m_width, 2.0f * LIGHT_TILE_SIZE / m_height);
+	for (unsigned int ty = 0; ty < m_numTilesY; ty++)
+	{
+		float rowMinY = -1.0f + ty * tileNdcSize.y;
+		float rowMaxY = glm::min(rowMinY + tileNdcSize.y, 1.0f);
+		Frustum rowFrustum = extractFrustum(viewProjection, glm::vec2(-1.0f, rowMinY), glm::vec2(1.0f, rowMaxY));
+		size_t numRowLights = cullSpheres(rowFrustum, m_lightBounds, m_rowLights.data());
+		m_rowBounds.clear();
+		for (size_t i = 0; i < numRowLights; i++)
+		{
+			m_rowBounds.add(getLightBounds(m_lights[m_rowLights[i]]));
+		}
+		for (unsigned int tx = 0; tx < m_numTilesX; tx++)
+		{
+			glm::uvec2& range = m_tileRanges[ty * m_numTilesX + tx];
+			range = glm::uvec2((unsigned int)m_tileLights.size(), 0);
+			if (numRowLights == 0) {
+				continue;
+			}
+			float tileMinX = -1.0f + tx * tileNdcSize.x;
+			float tileMaxX = glm::min(tileMinX + tileNdcSize.x, 1.0f);
+			Frustum tileFrustum = extractFrustum(viewProjection, glm::vec2(tileMinX, rowMinY), glm::vec2(tileMaxX, rowMaxY));
+			size_t numTileLights = cullSpheres(tileFrustum, m_rowBounds, m_tileVisible.data());
+			numTileLights = glm::min(numTileLights, (size_t)MAX_LIGHTS_PER_TILE);
+			for (size_t i = 0; i < numTileLights; i++)
+			{
+				m_tileLights.push_back(m_rowLights[m_tileVisible[i]]);
+			}
+			range.y = (unsigned int)numTileLights;
+		}
+	}
+	m_numCpuTileLights = m_tileLights.size();
+	glNamedBufferSubData(m_tileRangeBuffer, 0, sizeof(glm::uvec2) * m_tileRanges.size(), m_tileRanges.data());
+	if (!m_tileLights.empty()) {
+		glNamedBufferSubData(m_tileLightBuffer, 0, sizeof(uint32_t) * m_tileLights.size(), m_tileLights.data());
+	}
+}
+
+void jameslib::TiledLighting::bind()const
+{
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, LIGHT_BUFFER_BINDING, m_lightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TILE_LIGHTS_BINDING, m_tileLightBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, TILE_RANGES_BINDING, m_tileRangeBuffer);
+}
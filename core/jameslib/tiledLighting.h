@@ -0,0 +1,87 @@
+#pragma once
+
+#include "../ew/shader.h"
+#include "culling.h"
+#include <glm/glm.hpp>
+#include <stdint.h>
+#include <vector>
+
+namespace jameslib
+{
+	//Screen tile edge in pixels and the most lights one tile can reference.
+	//Mirrored by tiledLights.comp and deferredLit.frag.
+	const unsigned int LIGHT_TILE_SIZE = 16;
+	const unsigned int MAX_LIGHTS_PER_TILE = 256;
+
+	//Shader storage bindings shared by the binning and lighting shaders
+	const unsigned int LIGHT_BUFFER_BINDING = 1;
+	const unsigned int TILE_LIGHTS_BINDING = 2;
+	const unsigned int TILE_RANGES_BINDING = 3;
+
+	//std430 mirror of the Light struct in the shaders. Point lights use cone angles of -1 (inner)
+	//and -2 (outer) so the spot falloff is always 1.
+	struct Light
+	{
+		glm::vec4 positionRadius; //World position, range
+		glm::vec4 color; //Color * intensity, cos of the spot inner angle
+		glm::vec4 direction; //Spot direction, cos of the spot outer angle
+	};
+	Light makePointLight(const glm::vec3& position, float radius, const glm::vec3& color);
+	Light makeSpotLight(const glm::vec3& position, const glm::vec3& direction, float radius, const glm::vec3& color, float innerAngle, float outerAngle);
+
+	//Compute binning needs GL 4.3. Otherwise use TiledLighting::binCpu.
+	bool isComputeBinningSupported();
+
+	//Bins lights into screen tiles so the lighting pass only shades each pixel with the lights
+	//that can reach its tile. Each tile gets an (offset, count) range into a shared index list.
+	class TiledLighting
+	{
+	public:
+		TiledLighting(unsigned int width, unsigned int height);
+		~TiledLighting();
+		TiledLighting(const TiledLighting&) = delete;
+		TiledLighting& operator=(const TiledLighting&) = delete;
+
+		void resize(unsigned int width, unsigned int height);
+		void uploadLights(const Light* lights, size_t count);
+
+		//One work group per tile. Tiles are tightened to the depth range of the G-buffer depth,
+		//so lights in front of or behind everything in a tile are skipped. Changes the current program.
+		//The lighting pass needs glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT) first, which a FrameGraph
+		//issues when the tile buffers are declared as a storage write.
+		void binCompute(const ew::Shader& binShader, unsigned int depthTexture);
+		//Fallback: culls lights against each tile row, then each tile of the row, with the SIMD culling
+		//kernels. Tiles span the whole depth range since the depth buffer stays on the GPU.
+		void binCpu(const glm::mat4& viewProjection);
+
+		//Binds the light, tile index and tile range buffers for the lighting pass
+		void bind()const;
+
+		inline unsigned int getNumTilesX()const { return m_numTilesX; }
+		inline unsigned int getNumTilesY()const { return m_numTilesY; }
+		inline size_t getNumLights()const { return m_lights.size(); }
+		inline unsigned int getTileRangeBuffer()const { return m_tileRangeBuffer; }
+		//Total tile references written by the last binCpu
+		inline size_t getNumCpuTileLights()const { return m_numCpuTileLights; }
+	private:
+		unsigned int m_width = 0;
+		unsigned int m_height = 0;
+		unsigned int m_numTilesX = 0;
+		unsigned int m_numTilesY = 0;
+
+		unsigned int m_lightBuffer = 0;
+		unsigned int m_tileLightBuffer = 0;
+		unsigned int m_tileRangeBuffer = 0;
+		size_t m_lightCapacity = 0;
+
+		std::vector<Light> m_lights;
+		//CPU binning scratch
+		CullingBounds m_lightBounds;
+		CullingBounds m_rowBounds;
+		std::vector<uint32_t> m_rowLights;
+		std::vector<uint32_t> m_tileVisible;
+		std::vector<uint32_t> m_tileLights;
+		std::vector<glm::uvec2> m_tileRanges;
+		size_t m_numCpuTileLights = 0;
+	};
+}
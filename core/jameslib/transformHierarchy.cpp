@@ -0,0 +1,229 @@
+#include "transformHierarchy.h"
+#include <stdio.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define TRANSFORM_SSE
+#endif
+
+void jameslib::multiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4* out)
+{
+#if defined(TRANSFORM_SSE)
+	//glm matrices are 16 contiguous column major floats
+	const float* pa = reinterpret_cast<const float*>(&a);
+	const float* pb = reinterpret_cast<const float*>(&b);
+	float* po = reinterpret_cast<float*>(out);
+	__m128 a0 = _mm_loadu_ps(pa);
+	__m128 a1 = _mm_loadu_ps(pa + 4);
+	__m128 a2 = _mm_loadu_ps(pa + 8);
+	__m128 a3 = _mm_loadu_ps(pa + 12);
+	for (int j = 0; j < 4; j++)
+	{
+		const float* column = pb + j * 4;
+		__m128 result = _mm_mul_ps(a0, _mm_set1_ps(column[0]));
+		result = _mm_add_ps(result, _mm_mul_ps(a1, _mm_set1_ps(column[1])));
+		result = _mm_add_ps(result, _mm_mul_ps(a2, _mm_set1_ps(column[2])));
+		result = _mm_add_ps(result, _mm_mul_ps(a3, _mm_set1_ps(column[3])));
+		_mm_storeu_ps(po + j * 4, result);
+	}
+#else
+	*out = a * b;
+#endif
+}
+
+jameslib::TransformNode jameslib::TransformHierarchy::create(const ew::Transform& local, TransformNode parent)
+{
+	TransformNode node = (TransformNode)m_nodeToIndex.size();
+	uint32_t index = (uint32_t)m_parents.size();
+	m_positions.push_back(local.position);
+	m_rotations.push_back(local.rotation);
+	m_scales.push_back(local.scale);
+	m_parents.push_back(parent == INVALID_TRANSFORM_NODE ? INVALID_TRANSFORM_NODE : m_nodeToIndex[parent]);
+	m_dirty.push_back(1);
+	m_updated.push_back(0);
+	m_localMatrices.push_back(glm::mat4(1.0f));
+	m_worldMatrices.push_back(glm::mat4(1.0f));
+	m_nodeToIndex.push_back(index);
+	m_indexToNode.push_back(node);
+	//Appending keeps parents first but can split a depth level
+	m_needsSort = true;
+	return node;
+}
+
+bool jameslib::TransformHierarchy::setParent(TransformNode node, TransformNode parent)
+{
+	uint32_t index = m_nodeToIndex[node];
+	uint32_t parentIndex = parent == INVALID_TRANSFORM_NODE ? INVALID_TRANSFORM_NODE : m_nodeToIndex[parent];
+	for (uint32_t ancestor = parentIndex; ancestor != INVALID_TRANSFORM_NODE; ancestor = m_parents[ancestor])
+	{
+		if (ancestor == index) {
+			printf("Can't parent a transform to itself or its descendant\n");
+			return false;
+		}
+	}
+	m_parents[index] = parentIndex;
+	m_dirty[index] = 1;
+	m_needsSort = true;
+	return true;
+}
+
+void jameslib::TransformHierarchy::setLocal(TransformNode node, const ew::Transform& local)
+{
+	uint32_t index = m_nodeToIndex[node];
+	m_positions[index] = local.position;
+	m_rotations[index] = local.rotation;
+	m_scales[index] = local.scale;
+	m_dirty[index] = 1;
+}
+
+void jameslib::TransformHierarchy::setPosition(TransformNode node, const glm::vec3& position)
+{
+	uint32_t index = m_nodeToIndex[node];
+	m_positions[index] = position;
+	m_dirty[index] = 1;
+}
+
+void jameslib::TransformHierarchy::setRotation(TransformNode node, const glm::quat& rotation)
+{
+	uint32_t index = m_nodeToIndex[node];
+	m_rotations[index] = rotation;
+	m_dirty[index] = 1;
+}
+
+void jameslib::TransformHierarchy::setScale(TransformNode node, const glm::vec3& scale)
+{
+	uint32_t index = m_nodeToIndex[node];
+	m_scales[index] = scale;
+	m_dirty[index] = 1;
+}
+
+ew::Transform jameslib::TransformHierarchy::getLocal(TransformNode node) const
+{
+	uint32_t index = m_nodeToIndex[node];
+	ew::Transform local;
+	local.position = m_positions[index];
+	local.rotation = m_rotations[index];
+	local.scale = m_scales[index];
+	return local;
+}
+
+jameslib::TransformNode jameslib::TransformHierarchy::getParent(TransformNode node) const
+{
+	uint32_t parentIndex = m_parents[m_nodeToIndex[node]];
+	return parentIndex == INVALID_TRANSFORM_NODE ? INVALID_TRANSFORM_NODE : m_indexToNode[parentIndex];
+}
+
+/// <summary>
+/// Stable counting sort of storage by depth so each level is contiguous and follows its parents.
+/// Only runs after nodes are created or reparented.
+/// </summary>
+void jameslib::TransformHierarchy::sortByDepth()
+{
+	size_t count = m_parents.size();
+	//Depths are resolved by walking up to the first ancestor with a known depth
+	const uint32_t UNKNOWN = 0xFFFFFFFF;
+	std::vector<uint32_t> depths(count, UNKNOWN);
+	std::vector<uint32_t> chain;
+	uint32_t maxDepth = 0;
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t current = i;
+		while (current != INVALID_TRANSFORM_NODE && depths[current] == UNKNOWN) {
+			chain.push_back(current);
+			current = m_parents[current];
+		}
+		uint32_t depth = current == INVALID_TRANSFORM_NODE ? 0 : depths[current] + 1;
+		while (!chain.empty()) {
+			depths[chain.back()] = depth++;
+			chain.pop_back();
+		}
+		maxDepth = glm::max(maxDepth, depths[i]);
+	}
+
+	m_levelStart.assign(count > 0 ? maxDepth + 2 : 1, 0);
+	for (size_t i = 0; i < count; i++)
+	{
+		m_levelStart[depths[i] + 1]++;
+	}
+	for (size_t i = 1; i < m_levelStart.size(); i++)
+	{
+		m_levelStart[i] += m_levelStart[i - 1];
+	}
+	std::vector<uint32_t> next(m_levelStart.begin(), m_levelStart.end() - 1);
+	std::vector<uint32_t> oldToNew(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		oldToNew[i] = next[depths[i]]++;
+	}
+
+	//Permute every stream into depth order
+	std::vector<glm::vec3> positions(count), scales(count);
+	std::vector<glm::quat> rotations(count);
+	std::vector<uint32_t> parents(count);
+	std::vector<uint8_t> dirty(count), updated(count);
+	std::vector<glm::mat4> localMatrices(count), worldMatrices(count);
+	std::vector<TransformNode> indexToNode(count);
+	for (uint32_t i = 0; i < count; i++)
+	{
+		uint32_t dst = oldToNew[i];
+		positions[dst] = m_positions[i];
+		rotations[dst] = m_rotations[i];
+		scales[dst] = m_scales[i];
+		parents[dst] = m_parents[i] == INVALID_TRANSFORM_NODE ? INVALID_TRANSFORM_NODE : oldToNew[m_parents[i]];
+		dirty[dst] = m_dirty[i];
+		updated[dst] = m_updated[i];
+		localMatrices[dst] = m_localMatrices[i];
+		worldMatrices[dst] = m_worldMatrices[i];
+		indexToNode[dst] = m_indexToNode[i];
+		m_nodeToIndex[m_indexToNode[i]] = dst;
+	}
+	m_positions.swap(positions);
+	m_rotations.swap(rotations);
+	m_scales.swap(scales);
+	m_parents.swap(parents);
+	m_dirty.swap(dirty);
+	m_updated.swap(updated);
+	m_localMatrices.swap(localMatrices);
+	m_worldMatrices.swap(worldMatrices);
+	m_indexToNode.swap(indexToNode);
+	m_needsSort = false;
+}
+
+void jameslib::TransformHierarchy::update()
+{
+	if (m_needsSort) {
+		sortByDepth();
+	}
+	m_numUpdated = 0;
+	size_t numLevels = getNumLevels();
+	for (size_t level = 0; level < numLevels; level++)
+	{
+		uint32_t begin = m_levelStart[level];
+		uint32_t end = m_levelStart[level + 1];
+		//Locals first as their own tight loop, then worlds. Every parent in this level's
+		//world pass was finished by the previous level.
+		for (uint32_t i = begin; i < end; i++)
+		{
+			if (m_dirty[i]) {
+				m_localMatrices[i] = ew::composeTransform(m_positions[i], m_rotations[i], m_scales[i]);
+			}
+		}
+		for (uint32_t i = begin; i < end; i++)
+		{
+			uint32_t parent = m_parents[i];
+			bool changed = m_dirty[i] || (parent != INVALID_TRANSFORM_NODE && m_updated[parent]);
+			m_updated[i] = changed;
+			if (!changed) {
+				continue;
+			}
+			if (parent == INVALID_TRANSFORM_NODE) {
+				m_worldMatrices[i] = m_localMatrices[i];
+			}
+			else {
+				multiplyMatrices(m_worldMatrices[parent], m_localMatrices[i], &m_worldMatrices[i]);
+			}
+			m_dirty[i] = 0;
+			m_numUpdated++;
+		}
+	}
+}
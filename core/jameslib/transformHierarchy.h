@@ -0,0 +1,61 @@
+#pragma once
+
+#include "../ew/transform.h"
+#include <stdint.h>
+#include <vector>
+
+namespace jameslib
+{
+	typedef uint32_t TransformNode;
+	const TransformNode INVALID_TRANSFORM_NODE = 0xFFFFFFFF;
+
+	//Parent/child transforms with cached world matrices. Nodes are stored as structure of arrays
+	//sorted by depth, so update walks one level at a time with every parent already resolved.
+	//Only nodes whose local transform (or an ancestor's) changed since the last update are recomputed.
+	class TransformHierarchy
+	{
+	public:
+		TransformNode create(const ew::Transform& local = ew::Transform(), TransformNode parent = INVALID_TRANSFORM_NODE);
+		//Fails (returns false) if parent is node itself or one of its descendants
+		bool setParent(TransformNode node, TransformNode parent);
+		void setLocal(TransformNode node, const ew::Transform& local);
+		void setPosition(TransformNode node, const glm::vec3& position);
+		void setRotation(TransformNode node, const glm::quat& rotation);
+		void setScale(TransformNode node, const glm::vec3& scale);
+		ew::Transform getLocal(TransformNode node)const;
+		TransformNode getParent(TransformNode node)const;
+
+		//Recomputes dirty local and world matrices breadth first
+		void update();
+		//Valid after update
+		inline const glm::mat4& getWorldMatrix(TransformNode node)const { return m_worldMatrices[m_nodeToIndex[node]]; }
+		//True if the node's world matrix changed during the last update
+		inline bool wasUpdated(TransformNode node)const { return m_updated[m_nodeToIndex[node]] != 0; }
+		inline size_t size()const { return m_parents.size(); }
+		inline size_t getNumLevels()const { return m_levelStart.empty() ? 0 : m_levelStart.size() - 1; }
+		inline size_t getNumUpdated()const { return m_numUpdated; }
+	private:
+		void markDirty(TransformNode node);
+		void sortByDepth();
+
+		//Indexed by storage position, parents always precede children
+		std::vector<glm::vec3> m_positions;
+		std::vector<glm::quat> m_rotations;
+		std::vector<glm::vec3> m_scales;
+		std::vector<uint32_t> m_parents; //Storage index or INVALID_TRANSFORM_NODE
+		std::vector<uint8_t> m_dirty;
+		std::vector<uint8_t> m_updated;
+		std::vector<glm::mat4> m_localMatrices;
+		std::vector<glm::mat4> m_worldMatrices;
+		std::vector<uint32_t> m_levelStart; //First storage index of each depth, plus the end
+
+		//Stable handles survive reordering
+		std::vector<uint32_t> m_nodeToIndex;
+		std::vector<TransformNode> m_indexToNode;
+		bool m_needsSort = false;
+		size_t m_numUpdated = 0;
+	};
+
+	//out = a * b, one column per SSE operation when available. out must not alias a.
+	void multiplyMatrices(const glm::mat4& a, const glm::mat4& b, glm::mat4* out);
+}
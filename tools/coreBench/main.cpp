@@ -0,0 +1,299 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include <ew/camera.h>
+#include <ew/mesh.h>
+#include <jameslib/culling.h>
+#include <jameslib/renderQueue.h>
+#include <jameslib/scene.h>
+#include <jameslib/transformHierarchy.h>
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+//Runs fn iterations times and returns the average milliseconds per call
+template<typename Fn>
+static double timeMs(int iterations, Fn fn) {
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < iterations; i++)
+	{
+		fn();
+	}
+	return elapsedMs(start) / iterations;
+}
+
+static void printTiming(const char* name, double ms, size_t count, size_t numVisible) {
+	printf("  %-22s %9.3f ms  %7.2f ns/object  %zu visible\n", name, ms, ms * 1e6 / count, numVisible);
+}
+
+/// <summary>
+/// Scatters numObjects randomly rotated and scaled boxes through a 200m cube and culls them against
+/// a perspective camera and an orthographic light, comparing the scalar and SIMD kernels.
+/// </summary>
+static int benchCulling(size_t numObjects, int iterations) {
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+	ew::Vertex cubeCorners[2];
+	cubeCorners[0].pos = glm::vec3(-0.5f);
+	cubeCorners[1].pos = glm::vec3(0.5f);
+	ew::Bounds objectBounds = ew::computeBounds(cubeCorners, 2);
+
+	std::vector<glm::mat4> transforms(numObjects);
+	for (size_t i = 0; i < numObjects; i++)
+	{
+		glm::mat4 m = glm::translate(glm::mat4(1.0f), glm::vec3(position(random), position(random), position(random)));
+		m = glm::rotate(m, unit(random) * 6.283f, glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + 0.01f));
+		transforms[i] = glm::scale(m, glm::vec3(0.5f + unit(random) * 3.0f));
+	}
+
+	jameslib::CullingBounds bounds;
+	double buildMs = timeMs(iterations, [&]() {
+		bounds.clear();
+		bounds.reserve(numObjects);
+		for (size_t i = 0; i < numObjects; i++)
+		{
+			bounds.add(jameslib::transformBounds(objectBounds, transforms[i]));
+		}
+	});
+
+	ew::Camera camera;
+	camera.position = glm::vec3(0.0f, 10.0f, -60.0f);
+	camera.target = glm::vec3(0.0f);
+	camera.farPlane = 150.0f;
+	ew::Camera light;
+	light.orthographic = true;
+	light.position = glm::vec3(50.0f, 50.0f, 50.0f);
+	light.target = glm::vec3(0.0f);
+	light.orthoHeight = 60.0f;
+	light.aspectRatio = 1.0f;
+	light.farPlane = 200.0f;
+
+	std::vector<uint32_t> visible(numObjects);
+	printf("Culling %zu objects, %d iterations, batched kernel: %s\n", numObjects, iterations, jameslib::getCullingKernelName());
+	printf("  %-22s %9.3f ms  %7.2f ns/object\n", "Transform bounds", buildMs, buildMs * 1e6 / numObjects);
+	const ew::Camera* cameras[2] = { &camera, &light };
+	const char* cameraNames[2] = { "Main camera", "Directional light" };
+	for (int c = 0; c < 2; c++)
+	{
+		jameslib::Frustum frustum = jameslib::extractFrustum(*cameras[c]);
+		printf("%s\n", cameraNames[c]);
+		size_t numVisible = 0, reference = 0;
+		double ms = timeMs(iterations, [&]() { reference = jameslib::cullSpheresScalar(frustum, bounds, visible.data()); });
+		printTiming("Spheres (scalar)", ms, numObjects, reference);
+		ms = timeMs(iterations, [&]() { numVisible = jameslib::cullSpheres(frustum, bounds, visible.data()); });
+		printTiming("Spheres (batched)", ms, numObjects, numVisible);
+		if (numVisible != reference) {
+			printf("  Mismatch between sphere kernels!\n");
+			return 1;
+		}
+		ms = timeMs(iterations, [&]() { reference = jameslib::cullBoxesScalar(frustum, bounds, visible.data()); });
+		printTiming("Boxes (scalar)", ms, numObjects, reference);
+		ms = timeMs(iterations, [&]() { numVisible = jameslib::cullBoxes(frustum, bounds, visible.data()); });
+		printTiming("Boxes (batched)", ms, numObjects, numVisible);
+		if (numVisible != reference) {
+			printf("  Mismatch between box kernels!\n");
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/// <summary>
+/// Builds a numNodes hierarchy (100 roots, 4 children per node) and compares recomputing every
+/// world matrix from its ancestors' Transforms against TransformHierarchy::update with everything,
+/// 1% or nothing dirty.
+/// </summary>
+static int benchTransforms(size_t numNodes, int iterations) {
+	const size_t numRoots = 100;
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+	std::vector<ew::Transform> locals(numNodes);
+	std::vector<uint32_t> parents(numNodes);
+	jameslib::TransformHierarchy hierarchy;
+	std::vector<jameslib::TransformNode> nodes(numNodes);
+	for (size_t i = 0; i < numNodes; i++)
+	{
+		locals[i].position = glm::vec3(unit(random), unit(random), unit(random)) * 2.0f;
+		locals[i].rotation = glm::angleAxis(unit(random) * 3.14f, glm::normalize(glm::vec3(unit(random), unit(random), unit(random)) + 0.01f));
+		locals[i].scale = glm::vec3(0.9f + unit(random) * 0.1f);
+		parents[i] = i < numRoots ? jameslib::INVALID_TRANSFORM_NODE : (uint32_t)((i - numRoots) / 4);
+		nodes[i] = hierarchy.create(locals[i], parents[i] == jameslib::INVALID_TRANSFORM_NODE ? jameslib::INVALID_TRANSFORM_NODE : nodes[parents[i]]);
+	}
+
+	//What every caller of Transform::modelMatrix pays without caching
+	std::vector<glm::mat4> naiveWorld(numNodes);
+	double naiveMs = timeMs(iterations, [&]() {
+		for (size_t i = 0; i < numNodes; i++)
+		{
+			glm::mat4 world = locals[i].modelMatrix();
+			for (uint32_t p = parents[i]; p != jameslib::INVALID_TRANSFORM_NODE; p = parents[p])
+			{
+				world = locals[p].modelMatrix() * world;
+			}
+			naiveWorld[i] = world;
+		}
+	});
+
+	hierarchy.update();
+	float maxError = 0.0f;
+	for (size_t i = 0; i < numNodes; i++)
+	{
+		const glm::mat4& world = hierarchy.getWorldMatrix(nodes[i]);
+		for (int c = 0; c < 4; c++)
+		{
+			glm::vec4 difference = glm::abs(world[c] - naiveWorld[i][c]);
+			maxError = glm::max(maxError, glm::max(glm::max(difference.x, difference.y), glm::max(difference.z, difference.w)));
+		}
+	}
+
+	double fullMs = timeMs(iterations, [&]() {
+		for (size_t i = 0; i < numNodes; i++)
+		{
+			hierarchy.setLocal(nodes[i], locals[i]);
+		}
+		hierarchy.update();
+	});
+	size_t fullUpdated = hierarchy.getNumUpdated();
+	double partialMs = timeMs(iterations, [&]() {
+		for (size_t i = 0; i < numNodes; i += 100)
+		{
+			hierarchy.setPosition(nodes[i], locals[i].position);
+		}
+		hierarchy.update();
+	});
+	size_t partialUpdated = hierarchy.getNumUpdated();
+	double cleanMs = timeMs(iterations, [&]() { hierarchy.update(); });
+
+	printf("Transform hierarchy: %zu nodes, %zu levels, %d iterations (max error vs naive %g)\n", numNodes, hierarchy.getNumLevels(), iterations, maxError);
+	printf("  %-28s %9.3f ms\n", "Naive recompute from root", naiveMs);
+	printf("  %-28s %9.3f ms  %zu world matrices\n", "Update, all dirty", fullMs, fullUpdated);
+	printf("  %-28s %9.3f ms  %zu world matrices\n", "Update, 1% of nodes dirty", partialMs, partialUpdated);
+	printf("  %-28s %9.3f ms\n", "Update, nothing dirty", cleanMs);
+	return maxError < 1e-3f ? 0 : 1;
+}
+
+/// <summary>
+/// Fills a Scene with numEntities boxes (100 roots with the rest parented in a grid) and runs the per-frame
+/// systems a render loop would: transforms, bounds, camera culling and queue submission plus sort.
+/// Draw items use fake GL names since nothing is executed.
+/// </summary>
+static int benchScene(size_t numEntities, int iterations) {
+	const size_t numRoots = 100;
+	std::mt19937 random(1234);
+	std::uniform_real_distribution<float> position(-100.0f, 100.0f);
+	ew::Vertex cubeCorners[2];
+	cubeCorners[0].pos = glm::vec3(-0.5f);
+	cubeCorners[1].pos = glm::vec3(0.5f);
+	jameslib::BoundsComponent cubeBounds;
+	cubeBounds.local = ew::computeBounds(cubeCorners, 2);
+
+	jameslib::Scene scene;
+	jameslib::Material material;
+	material.texture = 1;
+	scene.addMaterial(material);
+	std::vector<jameslib::Entity> entities(numEntities);
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < numEntities; i++)
+	{
+		jameslib::Entity entity = scene.createEntity();
+		ew::Transform local;
+		local.position = i < numRoots ? glm::vec3(position(random), 0.0f, position(random)) : glm::vec3(position(random), position(random), position(random)) * 0.05f;
+		scene.addTransform(entity, local, i < numRoots ? jameslib::INVALID_ENTITY : entities[i % numRoots]);
+		scene.getRenderables().add(entity);
+		scene.getBounds().add(entity, cubeBounds);
+		entities[i] = entity;
+	}
+	double createMs = elapsedMs(start);
+
+	ew::Camera camera;
+	camera.position = glm::vec3(0.0f, 10.0f, -60.0f);
+	camera.target = glm::vec3(0.0f);
+	camera.farPlane = 150.0f;
+	jameslib::Frustum frustum = jameslib::extractFrustum(camera);
+
+	std::vector<jameslib::Entity> visible;
+	jameslib::RenderQueue queue;
+	size_t numVisible = 0;
+	double total[5] = {};
+	//First frame rebuilds the world bounds, later frames move 1% of the scene
+	for (int frame = 0; frame <= iterations; frame++)
+	{
+		if (frame > 0) {
+			for (size_t i = 0; i < numEntities; i += 100)
+			{
+				scene.getHierarchy().setPosition(scene.getTransformNode(entities[i]), glm::vec3(position(random), 0.0f, position(random)));
+			}
+		}
+		scene.updateTransforms();
+		scene.updateBounds();
+		numVisible = scene.cull(frustum, &visible);
+		{
+			jameslib::ScopedSystemTimer timer(scene.getTiming("Submit"));
+			queue.clear();
+			scene.forEachRenderable(visible, numVisible, [&](jameslib::Entity entity, const jameslib::RenderComponent& renderable, const glm::mat4& worldMatrix) {
+				jameslib::DrawItem item;
+				item.program = 1;
+				item.vao = 1 + entity % 64;
+				item.numIndices = 36;
+				item.modelMatrix = worldMatrix;
+				item.textures[0] = scene.getMaterials()[renderable.material].texture;
+				glm::vec4 sphere = scene.getWorldSphere(entity);
+				float depth01 = glm::min(glm::length(glm::vec3(sphere) - camera.position) / camera.farPlane, 1.0f);
+				item.key = jameslib::makeSortKey(0, item.program, item.textures[0], item.vao, depth01);
+				queue.submit(item);
+			});
+		}
+		{
+			jameslib::ScopedSystemTimer timer(scene.getTiming("Sort"));
+			queue.sort();
+		}
+		const char* names[5] = { "Transforms", "Bounds", "Cull", "Submit", "Sort" };
+		for (int s = 0; s < 5; s++)
+		{
+			double ms = scene.getTiming(names[s]).ms;
+			if (frame == 0) {
+				printf("  %-28s %9.3f ms  (first frame)\n", names[s], ms);
+			}
+			else {
+				total[s] += ms;
+			}
+		}
+		if (frame == 0) {
+			printf("Scene: %zu entities created in %.3f ms, %zu visible, %d iterations with 1%% moving\n", scene.getNumEntities(), createMs, numVisible, iterations);
+		}
+	}
+	const char* names[5] = { "Transforms", "Bounds", "Cull", "Submit", "Sort" };
+	double frameMs = 0.0;
+	for (int s = 0; s < 5; s++)
+	{
+		printf("  %-28s %9.3f ms\n", names[s], total[s] / iterations);
+		frameMs += total[s] / iterations;
+	}
+	printf("  %-28s %9.3f ms  %zu draw items\n", "Frame total", frameMs, queue.getNumItems());
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if (argc >= 2 && strcmp(argv[1], "--cull") == 0) {
+		return benchCulling(argc >= 3 ? (size_t)atoll(argv[2]) : 100000, argc >= 4 ? atoi(argv[3]) : 20);
+	}
+	if (argc >= 2 && strcmp(argv[1], "--transforms") == 0) {
+		return benchTransforms(argc >= 3 ? (size_t)atoll(argv[2]) : 100000, argc >= 4 ? atoi(argv[3]) : 20);
+	}
+	if (argc >= 2 && strcmp(argv[1], "--scene") == 0) {
+		return benchScene(argc >= 3 ? (size_t)atoll(argv[2]) : 100000, argc >= 4 ? atoi(argv[3]) : 20);
+	}
+	printf("Usage:\n");
+	printf("  coreBench --cull [objects] [iterations]    Frustum cull a random scene with scalar and SIMD kernels\n");
+	printf("  coreBench --transforms [nodes] [iterations]    Update a transform hierarchy vs recomputing from Transforms\n");
+	printf("  coreBench --scene [entities] [iterations]    Per-system frame timings for a large scene\n");
+	return 1;
+}
@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include <ew/model.h>
+#include <jameslib/meshCache.h>
+#include <jameslib/meshOptimizer.h>
+#include <jameslib/meshSimplifier.h>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+static double elapsedMs(std::chrono::steady_clock::time_point start) {
+	std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+	return elapsed.count();
+}
+
+//Peak resident set size of this process in megabytes
+static double getPeakRSSMB() {
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return counters.PeakWorkingSetSize / (1024.0 * 1024.0);
+#elif defined(__APPLE__)
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss / (1024.0 * 1024.0);
+#else
+	struct rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return usage.ru_maxrss / 1024.0;
+#endif
+}
+
+/// <summary>
+/// Writes a subdivided grid OBJ with at least numTriangles triangles, for import regression tests.
+/// </summary>
+static int generateGrid(long long numTriangles, const std::string& outputPath) {
+	FILE* file = fopen(outputPath.c_str(), "w");
+	if (file == NULL) {
+		printf("Failed to open %s for writing\n", outputPath.c_str());
+		return 1;
+	}
+	int subdivisions = 1;
+	while ((long long)subdivisions * subdivisions * 2 < numTriangles) {
+		subdivisions++;
+	}
+	int columns = subdivisions + 1;
+	for (int row = 0; row <= subdivisions; row++)
+	{
+		for (int col = 0; col <= subdivisions; col++)
+		{
+			float u = (float)col / subdivisions;
+			float v = (float)row / subdivisions;
+			fprintf(file, "v %f %f %f\n", u * 2.0f - 1.0f, 0.05f * sinf(u * 40.0f) * cosf(v * 40.0f), v * 2.0f - 1.0f);
+			fprintf(file, "vt %f %f\n", u, v);
+		}
+	}
+	fprintf(file, "vn 0 1 0\n");
+	for (int row = 0; row < subdivisions; row++)
+	{
+		for (int col = 0; col < subdivisions; col++)
+		{
+			//OBJ indices are 1-based
+			int a = row * columns + col + 1;
+			int b = a + 1;
+			int c = a + columns + 1;
+			int d = a + columns;
+			fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, c, c, b, b);
+			fprintf(file, "f %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, d, d, c, c);
+		}
+	}
+	fclose(file);
+	printf("Wrote %s (%lld triangles)\n", outputPath.c_str(), (long long)subdivisions * subdivisions * 2);
+	return 0;
+}
+
+/// <summary>
+/// Imports a model once and reports wall time and process peak memory, to catch import regressions.
+/// </summary>
+static int benchImport(const std::string& sourcePath) {
+	double rssBeforeMB = getPeakRSSMB();
+	auto start = std::chrono::steady_clock::now();
+	std::vector<ew::MeshData> meshes;
+	if (!ew::loadModelData(sourcePath, &meshes)) {
+		return 1;
+	}
+	double importMs = elapsedMs(start);
+
+	size_t numTriangles = 0, meshBytes = 0;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		numTriangles += meshes[i].indices.size() / 3;
+		meshBytes += meshes[i].vertices.capacity() * sizeof(ew::Vertex) + meshes[i].indices.capacity() * sizeof(unsigned int);
+	}
+	printf("%s (%zu triangles)\n", sourcePath.c_str(), numTriangles);
+	printf("  Import time:     %10.3f ms\n", importMs);
+	printf("  MeshData size:   %10.1f MB\n", meshBytes / (1024.0 * 1024.0));
+	printf("  Peak RSS:        %10.1f MB (%.1f MB before import)\n", getPeakRSSMB(), rssBeforeMB);
+	return 0;
+}
+
+/// <summary>
+/// Packs every vertex with ew::VertexFormat::PACKED, decodes it again and reports the error against the size saved.
+/// </summary>
+static int reportPacking(const std::string& sourcePath) {
+	std::vector<ew::MeshData> meshes;
+	if (!ew::loadModelData(sourcePath, &meshes)) {
+		return 1;
+	}
+	size_t numVertices = 0;
+	double maxPosError = 0.0, sumPosError = 0.0, maxExtent = 0.0;
+	double maxNormalDegrees = 0.0, sumNormalDegrees = 0.0;
+	double maxUVError = 0.0, sumUVError = 0.0;
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const std::vector<ew::Vertex>& vertices = meshes[i].vertices;
+		ew::PositionQuantization quantization = ew::computePositionQuantization(vertices.data(), vertices.size());
+		maxExtent = fmax(maxExtent, fmax(quantization.scale.x, fmax(quantization.scale.y, quantization.scale.z)));
+		for (size_t j = 0; j < vertices.size(); j++)
+		{
+			ew::Vertex decoded = ew::unpackVertex(ew::packVertex(vertices[j], quantization), quantization);
+			double posError = glm::length(decoded.pos - vertices[j].pos);
+			maxPosError = fmax(maxPosError, posError);
+			sumPosError += posError;
+
+			float cosAngle = glm::dot(glm::normalize(decoded.normal), glm::normalize(vertices[j].normal));
+			double normalDegrees = glm::degrees(acosf(glm::clamp(cosAngle, -1.0f, 1.0f)));
+			maxNormalDegrees = fmax(maxNormalDegrees, normalDegrees);
+			sumNormalDegrees += normalDegrees;
+
+			double uvError = glm::length(decoded.uv - vertices[j].uv);
+			maxUVError = fmax(maxUVError, uvError);
+			sumUVError += uvError;
+		}
+		numVertices += vertices.size();
+	}
+	if (numVertices == 0) {
+		printf("%s has no vertices\n", sourcePath.c_str());
+		return 1;
+	}
+
+	printf("%s (%zu vertices)\n", sourcePath.c_str(), numVertices);
+	printf("  Size:           %zu -> %zu bytes per vertex, %.1f KB -> %.1f KB\n", sizeof(ew::Vertex), sizeof(ew::PackedVertex),
+		numVertices * sizeof(ew::Vertex) / 1024.0, numVertices * sizeof(ew::PackedVertex) / 1024.0);
+	printf("  Position error: max %.6f avg %.6f (%.5f%% of largest extent)\n", maxPosError, sumPosError / numVertices, 100.0 * maxPosError / fmax(maxExtent, 1e-6));
+	printf("  Normal error:   max %.4f avg %.4f degrees\n", maxNormalDegrees, sumNormalDegrees / numVertices);
+	printf("  UV error:       max %.6f avg %.6f\n", maxUVError, sumUVError / numVertices);
+	return 0;
+}
+
+static void printCacheStats(const char* label, const ew::MeshData& mesh) {
+	jameslib::VertexCacheStats fifo16 = jameslib::analyzeVertexCache(mesh, 16);
+	jameslib::VertexCacheStats fifo32 = jameslib::analyzeVertexCache(mesh, 32);
+	printf("  %-16s ACMR %.3f / %.3f   ATVR %.3f / %.3f\n", label, fifo16.acmr, fifo32.acmr, fifo16.atvr, fifo32.atvr);
+}
+
+/// <summary>
+/// Reports simulated post-transform cache efficiency (FIFO 16 / FIFO 32) after each optimization stage.
+/// Lower is better for both; ACMR bottoms out near 0.5 and ATVR at 1.0.
+/// </summary>
+static int reportCache(const std::string& sourcePath) {
+	std::vector<ew::MeshData> meshes;
+	if (!ew::loadModelData(sourcePath, &meshes)) {
+		return 1;
+	}
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		ew::MeshData& mesh = meshes[i];
+		printf("%s mesh %zu (%zu triangles, %zu vertices)\n", sourcePath.c_str(), i, mesh.indices.size() / 3, mesh.vertices.size());
+		printCacheStats("Imported", mesh);
+		jameslib::optimizeVertexCache(&mesh);
+		printCacheStats("Vertex cache", mesh);
+		jameslib::optimizeOverdraw(&mesh);
+		printCacheStats("Overdraw", mesh);
+		jameslib::optimizeVertexFetch(&mesh);
+		printCacheStats("Vertex fetch", mesh);
+	}
+	return 0;
+}
+
+/// <summary>
+/// Simplifies each mesh into a LOD chain and reports triangle counts, geometric error and time per level.
+/// </summary>
+static int reportLods(const std::string& sourcePath, int numLevels) {
+	std::vector<ew::MeshData> meshes;
+	if (!ew::loadModelData(sourcePath, &meshes)) {
+		return 1;
+	}
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		const ew::MeshData& mesh = meshes[i];
+		printf("%s mesh %zu\n", sourcePath.c_str(), i);
+		size_t targetIndexCount = mesh.indices.size();
+		for (int level = 0; level < numLevels; level++)
+		{
+			auto start = std::chrono::steady_clock::now();
+			float error = 0.0f;
+			ew::MeshData lod = level == 0 ? mesh : jameslib::simplifyMesh(mesh, targetIndexCount, 0.05f, &error);
+			double ms = elapsedMs(start);
+			printf("  LOD %d: %8zu triangles %8zu vertices  error %.4f  %8.2f ms\n", level, lod.indices.size() / 3, lod.vertices.size(), error, ms);
+			targetIndexCount = targetIndexCount / 6 * 3;
+		}
+	}
+	return 0;
+}
+
+/// <summary>
+/// Optimizes a model and bakes it with a LOD chain of up to numLevels levels, so loading never simplifies at runtime.
+/// </summary>
+static int bake(const std::string& sourcePath, const std::string& cachePath, int numLevels) {
+	std::vector<ew::MeshData> meshes;
+	if (!ew::loadModelData(sourcePath, &meshes)) {
+		return 1;
+	}
+	for (size_t i = 0; i < meshes.size(); i++)
+	{
+		jameslib::optimizeMesh(&meshes[i]);
+	}
+	std::vector<std::vector<ew::MeshData>> lods;
+	jameslib::generateModelLods(meshes, numLevels, &lods);
+	lods.insert(lods.begin(), std::move(meshes));
+	if (!jameslib::writeMeshCache(cachePath, lods, sourcePath)) {
+		return 1;
+	}
+	printf("Baked %s -> %s (%zu meshes, %zu levels)\n", sourcePath.c_str(), cachePath.c_str(), lods[0].size(), lods.size());
+	for (size_t level = 0; level < lods.size(); level++)
+	{
+		size_t numVertices = 0, numIndices = 0;
+		for (size_t i = 0; i < lods[level].size(); i++)
+		{
+			numVertices += lods[level][i].vertices.size();
+			numIndices += lods[level][i].indices.size();
+		}
+		printf("  LOD %zu: %8zu vertices %8zu indices\n", level, numVertices, numIndices);
+	}
+	return 0;
+}
+
+/// <summary>
+/// Compares CPU load time of an Assimp import against mapping the baked cache.
+/// The cache path touches every vertex and index so page faults are included.
+/// </summary>
+static int bench(const std::string& sourcePath, int iterations) {
+	std::string cachePath = jameslib::getMeshCachePath(sourcePath);
+	jameslib::MeshCache cache;
+	if (!jameslib::openMeshCache(cachePath, sourcePath, &cache)) {
+		if (bake(sourcePath, cachePath, 4) != 0) {
+			return 1;
+		}
+	}
+	else {
+		jameslib::closeMeshCache(&cache);
+	}
+
+	double assimpMs = 0.0;
+	for (int i = 0; i < iterations; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		std::vector<ew::MeshData> meshes;
+		ew::loadModelData(sourcePath, &meshes);
+		assimpMs += elapsedMs(start);
+	}
+
+	double cacheMs = 0.0;
+	unsigned int checksum = 0;
+	for (int i = 0; i < iterations; i++)
+	{
+		auto start = std::chrono::steady_clock::now();
+		if (!jameslib::openMeshCache(cachePath, sourcePath, &cache)) {
+			printf("Failed to open %s during the benchmark\n", cachePath.c_str());
+			return 1;
+		}
+		const float* floats = (const float*)cache.vertices;
+		for (size_t j = 0; j < cache.header->numVertices * sizeof(ew::Vertex) / sizeof(float); j += 1024 / sizeof(float))
+		{
+			checksum += (unsigned int)floats[j];
+		}
+		for (size_t j = 0; j < cache.header->numIndices; j += 1024 / sizeof(unsigned int))
+		{
+			checksum += cache.indices[j];
+		}
+		jameslib::closeMeshCache(&cache);
+		cacheMs += elapsedMs(start);
+	}
+
+	printf("%s (%d iterations, checksum %u)\n", sourcePath.c_str(), iterations, checksum);
+	printf("  Assimp import: %10.3f ms\n", assimpMs / iterations);
+	printf("  .ewmesh map:   %10.3f ms\n", cacheMs / iterations);
+	printf("  Speedup:       %10.1fx\n", assimpMs / (cacheMs > 0.0 ? cacheMs : 1e-6));
+	return 0;
+}
+
+int main(int argc, char** argv) {
+	if (argc >= 3 && strcmp(argv[1], "--bench") == 0) {
+		return bench(argv[2], argc >= 4 ? atoi(argv[3]) : 5);
+	}
+	if (argc >= 3 && strcmp(argv[1], "--bench-import") == 0) {
+		return benchImport(argv[2]);
+	}
+	if (argc >= 3 && strcmp(argv[1], "--report-cache") == 0) {
+		return reportCache(argv[2]);
+	}
+	if (argc >= 3 && strcmp(argv[1], "--report-lods") == 0) {
+		return reportLods(argv[2], argc >= 4 ? atoi(argv[3]) : 4);
+	}
+	if (argc >= 3 && strcmp(argv[1], "--report-packing") == 0) {
+		return reportPacking(argv[2]);
+	}
+	if (argc >= 4 && strcmp(argv[1], "--generate") == 0) {
+		return generateGrid(atoll(argv[2]), argv[3]);
+	}
+	if (argc >= 2 && argv[1][0] != '-') {
+		return bake(argv[1], argc >= 3 ? argv[2] : jameslib::getMeshCachePath(argv[1]), argc >= 4 ? atoi(argv[3]) : 4);
+	}
+	printf("Usage:\n");
+	printf("  meshBaker <model> [output.ewmesh] [levels]    Optimize and bake a model and its LOD chain into a binary mesh cache\n");
+	printf("  meshBaker --bench <model> [iterations]    Compare Assimp import and cache load times\n");
+	printf("  meshBaker --bench-import <model>    Report import time and peak memory\n");
+	printf("  meshBaker --report-cache <model>    Report simulated ACMR/ATVR after each optimization stage\n");
+	printf("  meshBaker --report-lods <model> [levels]    Report triangle count and error of each simplified LOD\n");
+	printf("  meshBaker --report-packing <model>    Report packed vertex accuracy vs size\n");
+	printf("  meshBaker --generate <triangles> <output.obj>    Write a large grid OBJ for benchmarking\n");
+	return 1;
+}
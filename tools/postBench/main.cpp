@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <random>
+#include <vector>
+
+#include <ew/external/glad.h>
+#include <ew/shader.h>
+#include <jameslib/framebuffer.h>
+#include <jameslib/postProcess.h>
+#include <jameslib/renderTargetPool.h>
+
+#include <GLFW/glfw3.h>
+
+#ifndef POST_SHADER_DIR
+#define POST_SHADER_DIR "assets/"
+#endif
+
+const unsigned int BENCH_WIDTH = 3840;
+const unsigned int BENCH_HEIGHT = 2160;
+
+struct BenchCase {
+	const char* name;
+	jameslib::BlurSettings settings;
+};
+
+static jameslib::BlurSettings makeSettings(jameslib::BlurMode mode, float radius, int downsample, int kawaseLevels) {
+	jameslib::BlurSettings settings;
+	settings.mode = mode;
+	settings.radius = radius;
+	settings.downsample = downsample;
+	settings.kawaseLevels = kawaseLevels;
+	return settings;
+}
+
+/// <summary>
+/// Runs fn iterations times inside one GL_TIME_ELAPSED query and returns the average GPU milliseconds per call
+/// </summary>
+template<typename Fn>
+static double timeGpuMs(unsigned int query, int iterations, Fn fn) {
+	//Warm up so target allocation and shader compilation are not measured
+	for (int i = 0; i < 3; i++)
+	{
+		fn();
+	}
+	glFinish();
+	glBeginQuery(GL_TIME_ELAPSED, query);
+	for (int i = 0; i < iterations; i++)
+	{
+		fn();
+	}
+	glEndQuery(GL_TIME_ELAPSED);
+	GLuint64 elapsedNs = 0;
+	glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsedNs);
+	return (double)elapsedNs / 1e6 / iterations;
+}
+
+int main(int argc, char** argv) {
+	int iterations = argc > 1 ? atoi(argv[1]) : 50;
+
+	if (!glfwInit()) {
+		printf("GLFW failed to init!\n");
+		return 1;
+	}
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	GLFWwindow* window = glfwCreateWindow(64, 64, "postBench", NULL, NULL);
+	if (window == NULL) {
+		printf("GLFW failed to create a GL 4.5 context\n");
+		glfwTerminate();
+		return 1;
+	}
+	glfwMakeContextCurrent(window);
+	if (!gladLoadGL(glfwGetProcAddress)) {
+		printf("GLAD Failed to load GL headers\n");
+		glfwTerminate();
+		return 1;
+	}
+	printf("%s\n%ux%u, %d iterations per mode\n\n", (const char*)glGetString(GL_RENDERER), BENCH_WIDTH, BENCH_HEIGHT, iterations);
+
+	{
+		//Noisy HDR source so every fetch matters
+		jameslib::Framebuffer source = jameslib::createFramebuffer(BENCH_WIDTH, BENCH_HEIGHT, GL_RGB16F, false);
+		std::vector<float> pixels((size_t)BENCH_WIDTH * BENCH_HEIGHT * 3);
+		std::mt19937 random(1234);
+		std::uniform_real_distribution<float> unit(0.0f, 4.0f);
+		for (size_t i = 0; i < pixels.size(); i++)
+		{
+			pixels[i] = unit(random);
+		}
+		glTextureSubImage2D(source.colorBuffers[0], 0, 0, 0, BENCH_WIDTH, BENCH_HEIGHT, GL_RGB, GL_FLOAT, pixels.data());
+
+		jameslib::Framebuffer output = jameslib::createFramebuffer(BENCH_WIDTH, BENCH_HEIGHT, GL_RGB16F, false);
+		jameslib::RenderTargetPool pool;
+		jameslib::PostProcessChain chain(pool, POST_SHADER_DIR);
+		ew::Shader boxShader(POST_SHADER_DIR "postprocess.vert", POST_SHADER_DIR "postprocess.frag");
+		unsigned int vao;
+		glCreateVertexArrays(1, &vao);
+		unsigned int query;
+		glGenQueries(1, &query);
+
+		const BenchCase cases[] = {
+			{ "Box 5x5 (reference)", makeSettings(jameslib::BlurMode::BOX_5X5, 2.0f, 1, 0) },
+			{ "Separable box r2", makeSettings(jameslib::BlurMode::SEPARABLE_BOX, 2.0f, 1, 0) },
+			{ "Separable gaussian r8", makeSettings(jameslib::BlurMode::SEPARABLE_GAUSSIAN, 8.0f, 1, 0) },
+			{ "Separable gaussian r16", makeSettings(jameslib::BlurMode::SEPARABLE_GAUSSIAN, 16.0f, 1, 0) },
+			{ "Separable gaussian r16/2", makeSettings(jameslib::BlurMode::SEPARABLE_GAUSSIAN, 16.0f, 2, 0) },
+			{ "Separable gaussian r32/2", makeSettings(jameslib::BlurMode::SEPARABLE_GAUSSIAN, 32.0f, 2, 0) },
+			{ "Dual kawase 2 levels", makeSettings(jameslib::BlurMode::DUAL_KAWASE, 0.0f, 1, 2) },
+			{ "Dual kawase 4 levels", makeSettings(jameslib::BlurMode::DUAL_KAWASE, 0.0f, 1, 4) },
+		};
+		printf("  %-26s %10s %10s\n", "mode", "taps/px", "GPU ms");
+		for (const BenchCase& benchCase : cases)
+		{
+			double ms = 0.0;
+			if (benchCase.settings.mode == jameslib::BlurMode::BOX_5X5) {
+				ms = timeGpuMs(query, iterations, [&]() {
+					glBindFramebuffer(GL_FRAMEBUFFER, output.fbo);
+					glViewport(0, 0, BENCH_WIDTH, BENCH_HEIGHT);
+					boxShader.use();
+					boxShader.setInt("_BlurEnabled", 1);
+					boxShader.setFloat("_BlurStrength", 1.0f);
+					glBindVertexArray(vao);
+					glBindTextureUnit(0, source.colorBuffers[0]);
+					glDrawArrays(GL_TRIANGLES, 0, 6);
+				});
+			}
+			else {
+				ms = timeGpuMs(query, iterations, [&]() {
+					pool.releaseTexture(chain.blur(source.colorBuffers[0], BENCH_WIDTH, BENCH_HEIGHT, benchCase.settings));
+				});
+			}
+			printf("  %-26s %10.2f %10.3f\n", benchCase.name, jameslib::getBlurTapsPerPixel(benchCase.settings), ms);
+		}
+		printf("\nRender target pool: %zu textures, %.1f MB\n", pool.getStats().numTextures, pool.getStats().allocatedBytes / (1024.0 * 1024.0));
+
+		glDeleteQueries(1, &query);
+		glDeleteVertexArrays(1, &vao);
+		jameslib::destroyFramebuffer(output);
+		jameslib::destroyFramebuffer(source);
+	}
+
+	glfwDestroyWindow(window);
+	glfwTerminate();
+	return 0;
+}